@@ -7,9 +7,12 @@ CONFIG_FILE_NAME=installer/lumizedmxengine2.conf
 CONFIG_FILE_INSTALL_PATH=/etc/
 LUMIZE_USERNAME=lumize
 PERSISTENCY_FOLDER=/var/lib/lumizedmxengine2
+CUE_LISTS_FOLDER=$PERSISTENCY_FOLDER/cuelists
 SERVICE_UNIT_FILE_NAME=installer/lumizedmxengine2.service
 SERVICE_NAME=lumizedmxengine2.service
 SERVICE_UNIT_FILE_INSTALL_PATH=/etc/systemd/system/
+SHM_HEADER_FILE_NAME=src/lumizeshm.h
+SHM_HEADER_INSTALL_PATH=/usr/include/
 
 # Colors
 RED_TEXT='\033[0;31m' 
@@ -39,10 +42,17 @@ cp $CONFIG_FILE_NAME $CONFIG_FILE_INSTALL_PATH
 echo "Copying service unit file"
 cp $SERVICE_UNIT_FILE_NAME $SERVICE_UNIT_FILE_INSTALL_PATH
 
+# Copy shared memory reader header
+echo "Copying shared memory reader header to $SHM_HEADER_INSTALL_PATH"
+cp $SHM_HEADER_FILE_NAME $SHM_HEADER_INSTALL_PATH
+
 #################### PERSISTENCY DIRECTORY CREATION
 echo "Creating folder $PERSISTENCY_FOLDER if it doesn't exist" 
 mkdir -p $PERSISTENCY_FOLDER
 
+echo "Creating folder $CUE_LISTS_FOLDER if it doesn't exist"
+mkdir -p $CUE_LISTS_FOLDER
+
 #################### SYSTEMD SERVICE
 systemctl daemon-reload
 if systemctl is-enabled $SERVICE_NAME | grep -q "disabled"; then
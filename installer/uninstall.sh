@@ -5,6 +5,7 @@ CONFIG_FILE_INSTALL_PATH=/etc/lumizedmxengine2.conf
 PERSISTENCY_FOLDER=/var/lib/lumizedmxengine2
 SERVICE_UNIT_FILE_PATH=/etc/systemd/system/lumizedmxengine2.service
 SERVICE_NAME=lumizedmxengine2.service
+SHM_HEADER_PATH=/usr/include/lumizeshm.h
 
 # Colors
 RED_TEXT='\033[0;31m' 
@@ -39,6 +40,10 @@ rm $EXECUTABLE_INSTALL_PATH
 echo "Deleting service unit file"
 rm $SERVICE_UNIT_FILE_PATH
 
+# Delete shared memory reader header
+echo "Deleting shared memory reader header"
+rm $SHM_HEADER_PATH
+
 #################### PERSISTENCY DIRECTORY CREATION
 echo "Deleting folder $PERSISTENCY_FOLDER" 
 rm -r $PERSISTENCY_FOLDER
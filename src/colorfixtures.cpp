@@ -0,0 +1,358 @@
+/*
+ * Filename: colorfixtures.cpp
+ * Description: implementation of the ColorFixtures class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "colorfixtures.h" // Include definition of class to be implemented
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Configure the color fixtures. Must only be called by the rendering
+ * thread, or before it's started
+ * Parameters:
+ *  - int fps: frames per second of the LightRenderer
+ *  - const std::map<std::string, FixtureDefinition> *fixtures: fixtures in the config
+ */
+void ColorFixtures::configure(int fps, const std::map<std::string, FixtureDefinition> *fixtures)
+{
+   std::vector<FixtureFade> configured;
+   std::map<std::string, int>::iterator existing;
+
+   for (std::map<std::string, FixtureDefinition>::const_iterator fixture = fixtures->begin(); fixture != fixtures->end(); fixture++)
+   {
+      const FixtureDefinition &definition = fixture->second;
+      FixtureFade fade;
+
+      // Fades in progress go on, with the same duration, if the fixture didn't change
+      if ((existing = fixture_ids.find(fixture->first)) != fixture_ids.end())
+      {
+         const FixtureDefinition &previous = this->fixtures[existing->second].definition;
+
+         if (previous.type == definition.type && previous.channel == definition.channel &&
+             previous.warm_temperature == definition.warm_temperature && previous.cool_temperature == definition.cool_temperature)
+         {
+            fade = this->fixtures[existing->second];
+            fade.delta = fade.delta * this->fps / fps;
+         }
+      }
+
+      fade.name = fixture->first;
+      fade.definition = definition;
+      configured.push_back(fade);
+   }
+
+   this->fixtures.swap(configured);
+   this->fps = fps;
+
+   // Index fixtures by name and by channel
+   fixture_ids.clear();
+   std::fill(channel_fixture, channel_fixture + 512, -1);
+   for (size_t i = 0; i < this->fixtures.size(); i++)
+   {
+      const FixtureDefinition &definition = this->fixtures[i].definition;
+
+      fixture_ids[this->fixtures[i].name] = i;
+      std::fill(channel_fixture + definition.channel, channel_fixture + definition.channel + definition.channel_count, i);
+   }
+}
+
+/*
+ * Fades a fixture to a new color. Must only be called by the TCPServer
+ * Parameters:
+ *  - const ColorChange &change: fixture, color and transition
+ */
+void ColorFixtures::set_color(const ColorChange &change)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   pending.push_back(change);
+   has_pending.store(true, std::memory_order_release);
+}
+
+/*
+ * Advances color fades and writes the channel values of fading fixtures
+ * into the fade layer. Must only be called by the rendering thread, once
+ * per frame, with light_states_lock held
+ * Parameters:
+ *  - LightStates &light_states: light states to update
+ *  - bool *fade_changed: set for channels whose fade was replaced
+ * Returns: true if a color fade was started
+ */
+bool ColorFixtures::render(LightStates &light_states, bool *fade_changed)
+{
+   bool started = false;
+
+   // Only take the lock when the TCPServer changed something
+   if (has_pending.load(std::memory_order_acquire))
+      started = apply_pending(light_states, fade_changed);
+
+   batch_count = 0;
+
+   for (size_t i = 0; i < fixtures.size(); i++)
+   {
+      FixtureFade &fixture = fixtures[i];
+      double color[3], eased;
+
+      if (!fixture.fading)
+         continue;
+
+      fixture.progress += fixture.delta;
+
+      // Fade is finished
+      if (fixture.progress > 1)
+      {
+         fixture.fading = false;
+         eased = 1;
+      }
+      else
+         eased = ease_in_out_sine(fixture.progress);
+
+      for (int j = 0; j < 3; j++)
+         color[j] = (fixture.end[j] - fixture.start[j]) * eased + fixture.start[j];
+
+      // Whites are cheap, colors are converted together below
+      if (fixture.definition.type == FIXTURE_TYPE_CCT)
+         fixture_color_to_levels(fixture.definition, color, light_states.fade_current + fixture.definition.channel);
+      else
+      {
+         batch_fixture[batch_count] = i;
+         batch_white[batch_count] = fixture.definition.type == FIXTURE_TYPE_RGBW;
+         batch_l[batch_count] = color[0];
+         batch_a[batch_count] = color[1];
+         batch_b[batch_count] = color[2];
+         batch_count++;
+      }
+   }
+
+   if (batch_count > 0)
+      convert_batch(light_states);
+
+   return started;
+}
+
+/*
+ * Stops the color fade of the fixture a channel belongs to, because
+ * the channel was given a command. Must only be called by the rendering thread
+ * Parameters:
+ *  - int channel: channel that changed
+ */
+void ColorFixtures::mark_channel_changed(int channel)
+{
+   if (channel_fixture[channel] >= 0)
+      fixtures[channel_fixture[channel]].fading = false;
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+/*
+ * Starts the color fades requested since last frame, from the color
+ * the channels of each fixture are at
+ * Parameters:
+ *  - LightStates &light_states: light states to update
+ *  - bool *fade_changed: set for channels whose fade was replaced
+ * Returns: true if a color fade was started
+ */
+bool ColorFixtures::apply_pending(LightStates &light_states, bool *fade_changed)
+{
+   std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+   std::map<std::string, int>::iterator id;
+   bool started = false;
+
+   // Keep the lock only for the swap, the vectors keep their capacity
+   {
+      std::lock_guard<std::mutex> lk(lock);
+
+      applying.swap(pending);
+      has_pending.store(false, std::memory_order_relaxed);
+   }
+
+   for (size_t i = 0; i < applying.size(); i++)
+   {
+      const ColorChange &change = applying[i];
+      double levels[4];
+
+      // Fixture was removed by a config reload
+      if ((id = fixture_ids.find(change.fixture)) == fixture_ids.end())
+         continue;
+
+      FixtureFade &fixture = fixtures[id->second];
+      const FixtureDefinition &definition = fixture.definition;
+
+      fixture_levels_to_color(definition, light_states.fade_current + definition.channel, fixture.start);
+      std::copy(change.color, change.color + 3, fixture.end);
+
+      // White that is off has no color temperature to start from
+      if (definition.type == FIXTURE_TYPE_CCT && fixture.start[0] == 0)
+         fixture.start[1] = fixture.end[1];
+
+      fixture.progress = 0;
+      fixture.delta = 1000.0 / (fps * change.transition); // 1 / FPS * transition if transition was in seconds
+      fixture.fading = true;
+
+      // Channel fades are replaced by the color fade
+      fixture_color_to_levels(definition, fixture.end, levels);
+      for (int j = 0; j < definition.channel_count; j++)
+      {
+         const int channel = definition.channel + j;
+
+         light_states.fade_delta[channel] = 0;
+         light_states.fade_progress[channel] = 0;
+         light_states.fade_start[channel] = light_states.fade_current[channel];
+         light_states.fade_end[channel] = levels[j];
+         light_states.fade_duration[channel] = change.transition;
+         light_states.fade_start_time[channel] = now;
+         fade_changed[channel] = true;
+      }
+
+      started = true;
+      LOGGER_DEBUG("[COLOR] Starting color fade, fixture: " + change.fixture + ", transition: " + std::to_string(change.transition) + "ms", LOG_INFO);
+   }
+
+   applying.clear();
+
+   return started;
+}
+
+/*
+ * Converts the OKLab colors of the current frame to channel values and
+ * writes them into the fade layer. Each step is a straight loop over
+ * contiguous arrays, so that the compiler can vectorize it
+ * Parameters:
+ *  - LightStates &light_states: light states to update
+ */
+void ColorFixtures::convert_batch(LightStates &light_states)
+{
+   for (int j = 0; j < batch_count; j++)
+      oklab_to_linear_srgb(batch_l[j], batch_a[j], batch_b[j], batch_red[j], batch_green[j], batch_blue[j]);
+
+   // White channels take the light red, green and blue have in common
+   for (int j = 0; j < batch_count; j++)
+   {
+      batch_white_level[j] = batch_white[j] ? std::min(batch_red[j], std::min(batch_green[j], batch_blue[j])) : 0;
+      batch_red[j] -= batch_white_level[j];
+      batch_green[j] -= batch_white_level[j];
+      batch_blue[j] -= batch_white_level[j];
+   }
+
+   for (int j = 0; j < batch_count; j++)
+   {
+      double *levels = light_states.fade_current + fixtures[batch_fixture[j]].definition.channel;
+
+      levels[0] = linear_to_level(batch_red[j]);
+      levels[1] = linear_to_level(batch_green[j]);
+      levels[2] = linear_to_level(batch_blue[j]);
+      if (batch_white[j])
+         levels[3] = linear_to_level(batch_white_level[j]);
+   }
+}
+
+/*
+ ********** HELPER FUNCTIONS **********
+ */
+
+/*
+ * Converts a HSV color to the color of an RGB or RGBW fixture
+ * Parameters:
+ *  - double hue: 0-360
+ *  - double saturation: 0-100
+ *  - double brightness: 0-255
+ *  - double *color: where to store the OKLab color
+ */
+void hsv_to_fixture_color(double hue, double saturation, double brightness, double *color)
+{
+   const double value = brightness / 255, chroma = value * saturation / 100;
+   const int offsets[3] = {5, 3, 1}; // Where red, green and blue start on the hue circle
+   double rgb[3];
+
+   // Channel values of the color, sRGB encoded
+   for (int i = 0; i < 3; i++)
+   {
+      const double k = std::fmod(offsets[i] + hue / 60, 6);
+
+      rgb[i] = value - chroma * std::max(0.0, std::min(1.0, std::min(k, 4 - k)));
+   }
+
+   linear_srgb_to_oklab(level_to_linear(rgb[0] * 255), level_to_linear(rgb[1] * 255), level_to_linear(rgb[2] * 255), color);
+}
+
+/*
+ * Converts a color temperature to the color of a CCT fixture
+ * Parameters:
+ *  - int temperature: K
+ *  - double brightness: 0-255
+ *  - double *color: where to store brightness and mired
+ */
+void temperature_to_fixture_color(int temperature, double brightness, double *color)
+{
+   // Steps in mired look even, steps in kelvin don't
+   color[0] = brightness;
+   color[1] = 1000000.0 / temperature;
+   color[2] = 0;
+}
+
+/*
+ * Converts the color of a fixture to the values of its channels
+ * Parameters:
+ *  - const FixtureDefinition &fixture: fixture the color is for
+ *  - const double *color: OKLab color, or brightness and mired for CCT fixtures
+ *  - double *levels: where to store the value of each channel, 0-255
+ */
+void fixture_color_to_levels(const FixtureDefinition &fixture, const double *color, double *levels)
+{
+   double red, green, blue, white;
+
+   if (fixture.type == FIXTURE_TYPE_CCT)
+   {
+      const double warm_mired = 1000000.0 / fixture.warm_temperature, cool_mired = 1000000.0 / fixture.cool_temperature;
+      const double cool_share = std::min(1.0, std::max(0.0, (warm_mired - color[1]) / (warm_mired - cool_mired)));
+
+      levels[0] = color[0] * (1 - cool_share);
+      levels[1] = color[0] * cool_share;
+      return;
+   }
+
+   oklab_to_linear_srgb(color[0], color[1], color[2], red, green, blue);
+
+   // White channel takes the light red, green and blue have in common
+   white = fixture.type == FIXTURE_TYPE_RGBW ? std::min(red, std::min(green, blue)) : 0;
+
+   levels[0] = linear_to_level(red - white);
+   levels[1] = linear_to_level(green - white);
+   levels[2] = linear_to_level(blue - white);
+   if (fixture.type == FIXTURE_TYPE_RGBW)
+      levels[3] = linear_to_level(white);
+}
+
+/*
+ * Converts the values of the channels of a fixture to its color
+ * Parameters:
+ *  - const FixtureDefinition &fixture: fixture the channels belong to
+ *  - const double *levels: value of each channel, 0-255
+ *  - double *color: where to store the OKLab color, or brightness and mired for CCT fixtures
+ */
+void fixture_levels_to_color(const FixtureDefinition &fixture, const double *levels, double *color)
+{
+   double white;
+
+   if (fixture.type == FIXTURE_TYPE_CCT)
+   {
+      const double warm_mired = 1000000.0 / fixture.warm_temperature, cool_mired = 1000000.0 / fixture.cool_temperature;
+      const double brightness = levels[0] + levels[1];
+
+      color[0] = std::min(255.0, brightness);
+      color[1] = brightness > 0 ? warm_mired - (warm_mired - cool_mired) * levels[1] / brightness : warm_mired;
+      color[2] = 0;
+      return;
+   }
+
+   white = fixture.type == FIXTURE_TYPE_RGBW ? level_to_linear(levels[3]) : 0;
+
+   linear_srgb_to_oklab(std::min(1.0, level_to_linear(levels[0]) + white), std::min(1.0, level_to_linear(levels[1]) + white), std::min(1.0, level_to_linear(levels[2]) + white), color);
+}
@@ -0,0 +1,153 @@
+/*
+ * Filename: colorfixtures.h
+ * Description: interface for the ColorFixtures class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include "lightstates.h"
+#include "configreader.h"
+
+#define FIXTURES_MAX 256 // Fixtures of two channels fill the universe
+
+// Color change of a fixture requested by the TCPServer. Colors are in
+// the space fades are interpolated in: OKLab lightness, a and b for RGB
+// and RGBW fixtures, brightness and mired for CCT fixtures
+struct ColorChange
+{
+   std::string fixture;
+   double color[3];
+   int transition; // ms
+};
+
+/*
+ * Converts a linear sRGB color to OKLab
+ * Parameters:
+ *  - double red, green, blue: linear light, 0-1
+ *  - double *lab: where to store lightness, a and b
+ */
+inline void linear_srgb_to_oklab(double red, double green, double blue, double *lab)
+{
+   const double l = std::cbrt(0.4122214708 * red + 0.5363325363 * green + 0.0514459929 * blue);
+   const double m = std::cbrt(0.2119034982 * red + 0.6806995451 * green + 0.1073969566 * blue);
+   const double s = std::cbrt(0.0883024619 * red + 0.2817188376 * green + 0.6299787005 * blue);
+
+   lab[0] = 0.2104542553 * l + 0.7936177850 * m - 0.0040720468 * s;
+   lab[1] = 1.9779984951 * l - 2.4285922050 * m + 0.4505937099 * s;
+   lab[2] = 0.0259040371 * l + 0.7827717662 * m - 0.8086757660 * s;
+}
+
+/*
+ * Converts an OKLab color to linear sRGB, clamped to the gamut
+ * Parameters:
+ *  - double lightness, a, b: OKLab color
+ *  - double &red, &green, &blue: where to store linear light, 0-1
+ */
+inline void oklab_to_linear_srgb(double lightness, double a, double b, double &red, double &green, double &blue)
+{
+   const double l_ = lightness + 0.3963377774 * a + 0.2158037573 * b;
+   const double m_ = lightness - 0.1055613458 * a - 0.0638541728 * b;
+   const double s_ = lightness - 0.0894841775 * a - 1.2914855480 * b;
+   const double l = l_ * l_ * l_, m = m_ * m_ * m_, s = s_ * s_ * s_;
+
+   red = std::min(1.0, std::max(0.0, 4.0767416621 * l - 3.3077115913 * m + 0.2309699292 * s));
+   green = std::min(1.0, std::max(0.0, -1.2684380046 * l + 2.6097574011 * m - 0.3413193965 * s));
+   blue = std::min(1.0, std::max(0.0, -0.0041960863 * l - 0.7034186147 * m + 1.7076147010 * s));
+}
+
+/*
+ * Converts a channel value to linear light, channel values are taken as
+ * sRGB encoded
+ * Parameters:
+ *  - double level: channel value, 0-255
+ * Returns: linear light, 0-1
+ */
+inline double level_to_linear(double level)
+{
+   const double value = level / 255;
+
+   return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+}
+
+/*
+ * Converts linear light to a channel value
+ * Parameters:
+ *  - double linear: linear light, 0-1
+ * Returns: channel value, 0-255
+ */
+inline double linear_to_level(double linear)
+{
+   return 255 * (linear <= 0.0031308 ? 12.92 * linear : 1.055 * std::pow(linear, 1 / 2.4) - 0.055);
+}
+
+void hsv_to_fixture_color(double hue, double saturation, double brightness, double *color);
+void temperature_to_fixture_color(int temperature, double brightness, double *color);
+void fixture_color_to_levels(const FixtureDefinition &fixture, const double *color, double *levels);
+void fixture_levels_to_color(const FixtureDefinition &fixture, const double *levels, double *color);
+
+/*
+ * Definition of the ColorFixtures class
+ *
+ * Fades the channels of color fixtures together, interpolating in a
+ * perceptual space instead of channel by channel, so that transitions
+ * don't pass through muddy or wrong colors. Every frame the colors of
+ * all fading fixtures are converted to channel values in one batch and
+ * written into the fade layer of the light states, so channels of a
+ * fixture behave like any other channel once the fade is over. A command
+ * on any channel of a fixture stops its color fade
+ */
+class ColorFixtures
+{
+public:
+   // Methods
+   void configure(int fps, const std::map<std::string, FixtureDefinition> *fixtures);
+   void set_color(const ColorChange &change);
+   bool render(LightStates &light_states, bool *fade_changed);
+   void mark_channel_changed(int channel);
+
+private:
+   // Color fade of a fixture, only used by the rendering thread
+   struct FixtureFade
+   {
+      std::string name;
+      FixtureDefinition definition;
+      bool fading = false;
+      double start[3];
+      double end[3];
+      double progress = 0;
+      double delta = 0;
+   };
+   std::vector<FixtureFade> fixtures;
+   std::map<std::string, int> fixture_ids;
+   int channel_fixture[512]; // Fixture each channel belongs to, -1 if none
+
+   // Changes requested since last frame, taken by the rendering thread
+   std::mutex lock;
+   std::vector<ColorChange> pending, applying;
+   std::atomic<bool> has_pending{false};
+
+   // OKLab colors of the current frame, converted together
+   int batch_count;
+   int batch_fixture[FIXTURES_MAX];
+   bool batch_white[FIXTURES_MAX]; // Fixture has a white channel
+   double batch_l[FIXTURES_MAX], batch_a[FIXTURES_MAX], batch_b[FIXTURES_MAX];
+   double batch_red[FIXTURES_MAX], batch_green[FIXTURES_MAX], batch_blue[FIXTURES_MAX], batch_white_level[FIXTURES_MAX];
+
+   // Config
+   int fps = 0;
+
+   // Internal functions
+   bool apply_pending(LightStates &light_states, bool *fade_changed);
+   void convert_batch(LightStates &light_states);
+};
@@ -0,0 +1,92 @@
+/*
+ * Filename: commandqueue.cpp
+ * Description: implementation of the CommandQueue class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "commandqueue.h" // Include definition of class to be implemented
+
+/*
+ *********** CONSTRUCTOR **********
+ */
+CommandQueue::CommandQueue()
+{
+   for (int i = 0; i < 512; i++)
+      is_pending[i] = false;
+}
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Queues commands for several channels at once, replacing any command
+ * still waiting for the same channels. The LightRenderer takes all of
+ * them in the same frame, so their fades start together
+ * Parameters:
+ *  - int count: number of commands
+ *  - const int *channels: channels the commands target
+ *  - const LightCommand *commands: commands to queue
+ */
+void CommandQueue::push_batch(int count, const int *channels, const LightCommand *commands)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   for (int i = 0; i < count; i++)
+   {
+      if (is_pending[channels[i]])
+         coalesced_counter->increment();
+      else
+      {
+         is_pending[channels[i]] = true;
+         pending_channels[pending_count++] = channels[i];
+      }
+
+      pending[channels[i]] = commands[i];
+   }
+}
+
+/*
+ * Takes all pending commands out of the queue
+ * Parameters:
+ *  - int *channels: array of at least 512 elements to store the channels into
+ *  - LightCommand *commands: array of at least 512 elements to store the commands into
+ * Returns: number of commands taken
+ */
+int CommandQueue::drain(int *channels, LightCommand *commands)
+{
+   std::lock_guard<std::mutex> lk(lock);
+   int count = pending_count;
+
+   for (int i = 0; i < count; i++)
+   {
+      channels[i] = pending_channels[i];
+      commands[i] = pending[channels[i]];
+      is_pending[channels[i]] = false;
+   }
+
+   pending_count = 0;
+
+   return count;
+}
+
+/*
+ * Returns: true if no command is waiting to be applied
+ */
+bool CommandQueue::empty()
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   return pending_count == 0;
+}
+
+/*
+ * Give CommandQueue access to the metrics registry and register its metrics
+ * Parameters:
+ *  - MetricsRegistry &metrics: reference to metrics registry
+ */
+void CommandQueue::set_metrics(MetricsRegistry &metrics)
+{
+   coalesced_counter = &metrics.add_counter("lumize_commands_coalesced_total", "Commands replaced by a newer command for the same channel before being applied");
+}
@@ -0,0 +1,55 @@
+/*
+ * Filename: commandqueue.h
+ * Description: interface for the CommandQueue class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "metrics.h"
+
+// Types of light commands
+#define LIGHT_COMMAND_ON 0
+#define LIGHT_COMMAND_OFF 1
+
+// Fade command waiting to be applied by the LightRenderer
+struct LightCommand
+{
+   int type;
+   double brightness; // Target brightness 0-255, fractional for 16-bit lights. Ignored by LIGHT_COMMAND_OFF
+   int transition; // ms
+   std::chrono::steady_clock::time_point received_time; // When TCPServer received the command
+};
+
+/*
+ * Definition of the CommandQueue class
+ *
+ * Holds at most one pending command per channel. Commands pushed for a
+ * channel that already has one pending replace it (last writer wins), so
+ * the LightRenderer only applies the latest target once per frame.
+ */
+class CommandQueue
+{
+public:
+   // Constructor
+   CommandQueue();
+
+   // Methods
+   void push_batch(int count, const int *channels, const LightCommand *commands);
+   int drain(int *channels, LightCommand *commands);
+   bool empty();
+   void set_metrics(MetricsRegistry &metrics);
+
+private:
+   std::mutex lock;
+   LightCommand pending[512];     // Latest command for each channel
+   bool is_pending[512];          // Channel has a command waiting
+   int pending_channels[512];     // Channels with a command waiting, in arrival order
+   int pending_count = 0;
+   Counter *coalesced_counter; // Commands replaced before being applied
+};
@@ -85,9 +85,52 @@ void recap_config(LumizeConfig &config)
   {
     logger("         Persistency file path: " + config.persistency_file_path, LOG_INFO, false);
     logger("         Persistency write interval: " + std::to_string(config.persistency_write_interval), LOG_INFO, false);
+    logger("         Persistency compact records: " + std::to_string(config.persistency_compact_records), LOG_INFO, false);
+    logger("         Persistency debounce: " + std::to_string(config.persistency_debounce), LOG_INFO, false);
+    logger("         Persistency max delay: " + std::to_string(config.persistency_max_delay), LOG_INFO, false);
   }
 
   logger("         Debug logging: " + humanize_bool(config.log_debug), LOG_INFO, false);
+  logger("         Enable metrics: " + humanize_bool(config.enable_metrics), LOG_INFO, false);
+
+  if (config.enable_metrics)
+    logger("         Metrics port: " + std::to_string(config.metrics_port), LOG_INFO, false);
+
+  logger("         Enable handover: " + humanize_bool(config.enable_handover), LOG_INFO, false);
+
+  if (config.enable_handover)
+    logger("         Handover socket path: " + config.handover_socket_path, LOG_INFO, false);
+
+  logger("         Realtime policy: " + config.realtime_policy, LOG_INFO, false);
+
+  if (config.realtime_policy != REALTIME_POLICY_NONE)
+    logger("         Realtime priority: " + std::to_string(config.realtime_priority), LOG_INFO, false);
+
+  logger("         Render CPU: " + (config.render_cpu < 0 ? std::string("none") : std::to_string(config.render_cpu)), LOG_INFO, false);
+  logger("         Lock memory: " + humanize_bool(config.lock_memory), LOG_INFO, false);
+  logger("         Single thread runtime: " + humanize_bool(config.single_thread_runtime), LOG_INFO, false);
+  logger("         Shared memory export: " + humanize_bool(config.enable_shm_export), LOG_INFO, false);
+
+  if (config.enable_shm_export)
+    logger("         Shared memory name: " + config.shm_export_name, LOG_INFO, false);
+
+  logger("         Scenes file path: " + config.scenes_file_path, LOG_INFO, false);
+  logger("         Cue lists path: " + config.cue_lists_path, LOG_INFO, false);
+
+  for (std::map<std::string, std::vector<int>>::iterator group = config.groups.begin(); group != config.groups.end(); group++)
+    logger("         Group " + group->first + ": " + std::to_string(group->second.size()) + " channels", LOG_INFO, false);
+
+  if (!config.fine_channels.empty())
+    logger("         16-bit channels: " + std::to_string(config.fine_channels.size()), LOG_INFO, false);
+
+  if (config.has_patch)
+    logger("         Patched slots: " + std::to_string(std::count_if(config.patch_table.begin(), config.patch_table.end(), [](uint16_t channel) { return channel != PATCH_UNPATCHED; })), LOG_INFO, false);
+
+  logger("         LTP channels: " + std::to_string(std::count(config.ltp_channels.begin(), config.ltp_channels.end(), true)), LOG_INFO, false);
+  logger("         Main source priority: " + std::to_string(config.main_source_priority), LOG_INFO, false);
+
+  for (std::map<std::string, FixtureDefinition>::iterator fixture = config.fixtures.begin(); fixture != config.fixtures.end(); fixture++)
+    logger("         Fixture " + fixture->first + ": channels " + std::to_string(fixture->second.channel) + "-" + std::to_string(fixture->second.channel + fixture->second.channel_count - 1), LOG_INFO, false);
 }
 
 /*
@@ -531,6 +574,105 @@ bool parse_persistency_write_interval_value(LumizeConfig &config, std::string &v
   return true;
 }
 
+/*
+ * Parse "persistency_compact_records" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_persistency_compact_records_value(LumizeConfig &config, std::string &value_string)
+{
+  int tmp_persistency_compact_records;
+
+  // Check that string contains a number
+  if (!isNumber(value_string))
+  {
+    logger("[CONFIG] Error parsing parameter \"persistency_compact_records\": value is not a number!", LOG_ERR, false);
+    return false;
+  }
+
+  // Convert from string to int
+  tmp_persistency_compact_records = std::stoi(value_string);
+
+  if (tmp_persistency_compact_records <= 0)
+  {
+    logger("[CONFIG] Error parsing parameter \"persistency_compact_records\": Value must be greater than 0!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.persistency_compact_records = tmp_persistency_compact_records;
+
+  return true;
+}
+
+/*
+ * Parse "persistency_debounce" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_persistency_debounce_value(LumizeConfig &config, std::string &value_string)
+{
+  int tmp_persistency_debounce;
+
+  // Check that string contains a number
+  if (!isNumber(value_string))
+  {
+    logger("[CONFIG] Error parsing parameter \"persistency_debounce\": value is not a number!", LOG_ERR, false);
+    return false;
+  }
+
+  // Convert from string to int
+  tmp_persistency_debounce = std::stoi(value_string);
+
+  if (tmp_persistency_debounce < 0)
+  {
+    logger("[CONFIG] Error parsing parameter \"persistency_debounce\": Value must be positive!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.persistency_debounce = tmp_persistency_debounce;
+
+  return true;
+}
+
+/*
+ * Parse "persistency_max_delay" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_persistency_max_delay_value(LumizeConfig &config, std::string &value_string)
+{
+  int tmp_persistency_max_delay;
+
+  // Check that string contains a number
+  if (!isNumber(value_string))
+  {
+    logger("[CONFIG] Error parsing parameter \"persistency_max_delay\": value is not a number!", LOG_ERR, false);
+    return false;
+  }
+
+  // Convert from string to int
+  tmp_persistency_max_delay = std::stoi(value_string);
+
+  if (tmp_persistency_max_delay <= 0)
+  {
+    logger("[CONFIG] Error parsing parameter \"persistency_max_delay\": Value must be greater than 0!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.persistency_max_delay = tmp_persistency_max_delay;
+
+  return true;
+}
+
 /*
  * Parse "log_debug" config parameter
  * Parameters:
@@ -565,112 +707,957 @@ bool parse_log_debug_value(LumizeConfig &config, std::string &value_string)
 }
 
 /*
- * Sets up brightness limits values
+ * Parse "enable_metrics" config parameter
  * Parameters:
- *  LumizeConfig &config: config object
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
  */
-void setup_brightness_limits(LumizeConfig &config)
+bool parse_enable_metrics_value(LumizeConfig &config, std::string &value_string)
 {
-  for (unsigned int i = 0; i < config.brightness_limits.size(); i++)
+  bool tmp_enable_metrics;
+
+  // Differentiate between values
+  if (value_string == "true" || value_string == "yes" || value_string == "on" || value_string == "1")
   {
-    config.brightness_limits[i].min = DEFAULT_MIN_BRIGHTNESS;
-    config.brightness_limits[i].max = DEFAULT_MAX_BRIGHTNESS;
+    tmp_enable_metrics = true;
+  }
+  else if (value_string == "false" || value_string == "no" || value_string == "off" || value_string == "0")
+  {
+    tmp_enable_metrics = false;
+  }
+  else
+  {
+    // Value was not valid
+    logger("[CONFIG] Error parsing parameter \"enable_metrics\": value is not a valid boolean!", LOG_ERR, false);
+    return false;
   }
+
+  // Set config parameter
+  config.enable_metrics = tmp_enable_metrics;
+
+  return true;
 }
 
 /*
- * Reads from configuration file and saves the parameters in LumizeConfig struct
+ * Parse "metrics_port" config parameter
  * Parameters:
- *  - LumizeConfig &config: reference to the LumizeConfig struct to save into
- * Returns: true if succesful
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
  */
-bool read_config(LumizeConfig &config)
+bool parse_metrics_port_value(LumizeConfig &config, std::string &value_string)
 {
-  std::string line;
-  std::vector<std::string> string_split;
-  std::ifstream file(CONFIG_FILE_PATH);
+  int tmp_metrics_port;
 
-  // Initialize brightness limits
-  setup_brightness_limits(config);
+  // Check that string contains a number
+  if (!isNumber(value_string))
+  {
+    logger("[CONFIG] Error parsing parameter \"metrics_port\": value is not a number!", LOG_ERR, false);
+    return false;
+  }
 
-  // Check that file opened succesfully
-  if (file.is_open())
+  // Convert from string to int
+  tmp_metrics_port = std::stoi(value_string);
+
+  if (tmp_metrics_port < 1000 || tmp_metrics_port > 65535)
   {
-    while (getline(file, line))
-    {
-      remove_whitespace(line);
+    logger("[CONFIG] Error parsing parameter \"metrics_port\": Value must be between 1000 and 65535!", LOG_ERR, false);
+    return false;
+  }
 
-      // Check if line is comment
-      if (line[0] == '#')
-        continue;
+  // Set config parameter
+  config.metrics_port = tmp_metrics_port;
 
-      // Split string by = character
-      string_split = configreader_split_string(line, '=');
+  return true;
+}
 
-      // Check that the message is of right format
-      if (string_split.size() > 1)
-        // Iterate over messages
-        for (size_t i = 0; i < string_split.size(); i++)
-        {
-          // Read messages
-          if (string_split[0] == CONFIG_OPTION_PORT)
-          {
-            if (!parse_port_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_CHANNELS)
-          {
-            if (!parse_channels_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_FPS)
-          {
-            if (!parse_fps_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_DEFAULT_TRANSITION)
-          {
-            if (!parse_default_transition_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_BRIGHTNESS_LIMITS)
-          {
-            if (!parse_brightness_limits_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_PUSHBUTTON_FADE_DELTA)
-          {
-            if (!parse_pushbutton_fade_delta_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_PUSHBUTTON_FADE_PAUSE)
-          {
-            if (!parse_pushbutton_fade_pause_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_PUSHBUTTON_FADE_RESET_DELAY)
-          {
-            if (!parse_pushbutton_fade_reset_delay_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_ENABLE_PERSISTENCY)
-          {
-            if (!parse_enable_persistency_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_PERSISTENCY_FILE_PATH)
-          {
-            if (!parse_persistency_file_path_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_PERSISTENCY_WRITE_INTERVAL)
-          {
-            if (!parse_persistency_write_interval_value(config, string_split[1]))
-              return false;
-          }
-          else if (string_split[0] == CONFIG_OPTION_LOG_DEBUG)
-          {
-            if (!parse_log_debug_value(config, string_split[1]))
+/*
+ * Parse "enable_handover" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_enable_handover_value(LumizeConfig &config, std::string &value_string)
+{
+  bool tmp_enable_handover;
+
+  // Differentiate between values
+  if (value_string == "true" || value_string == "yes" || value_string == "on" || value_string == "1")
+  {
+    tmp_enable_handover = true;
+  }
+  else if (value_string == "false" || value_string == "no" || value_string == "off" || value_string == "0")
+  {
+    tmp_enable_handover = false;
+  }
+  else
+  {
+    // Value was not valid
+    logger("[CONFIG] Error parsing parameter \"enable_handover\": value is not a valid boolean!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.enable_handover = tmp_enable_handover;
+
+  return true;
+}
+
+/*
+ * Parse "handover_socket_path" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_handover_socket_path_value(LumizeConfig &config, std::string &value_string)
+{
+  if (value_string == "")
+  {
+    logger("[CONFIG] Error parsing parameter \"handover_socket_path\": value cannot be empty!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.handover_socket_path = value_string;
+
+  return true;
+}
+
+/*
+ * Parse "realtime_policy" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_realtime_policy_value(LumizeConfig &config, std::string &value_string)
+{
+  if (value_string != REALTIME_POLICY_NONE && value_string != REALTIME_POLICY_FIFO && value_string != REALTIME_POLICY_RR)
+  {
+    logger("[CONFIG] Error parsing parameter \"realtime_policy\": value must be one of none, fifo, rr!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.realtime_policy = value_string;
+
+  return true;
+}
+
+/*
+ * Parse "realtime_priority" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_realtime_priority_value(LumizeConfig &config, std::string &value_string)
+{
+  int tmp_realtime_priority;
+
+  // Check that string contains a number
+  if (!isNumber(value_string))
+  {
+    logger("[CONFIG] Error parsing parameter \"realtime_priority\": value is not a number!", LOG_ERR, false);
+    return false;
+  }
+
+  // Convert from string to int
+  tmp_realtime_priority = std::stoi(value_string);
+
+  if (tmp_realtime_priority < 1 || tmp_realtime_priority > 99)
+  {
+    logger("[CONFIG] Error parsing parameter \"realtime_priority\": value must be between 1 and 99!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.realtime_priority = tmp_realtime_priority;
+
+  return true;
+}
+
+/*
+ * Parse "render_cpu" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_render_cpu_value(LumizeConfig &config, std::string &value_string)
+{
+  int tmp_render_cpu;
+
+  // Thread is not pinned
+  if (value_string == "none")
+  {
+    config.render_cpu = -1;
+    return true;
+  }
+
+  // Check that string contains a number
+  if (value_string == "" || !isNumber(value_string))
+  {
+    logger("[CONFIG] Error parsing parameter \"render_cpu\": value is not a number or none!", LOG_ERR, false);
+    return false;
+  }
+
+  // Convert from string to int
+  tmp_render_cpu = std::stoi(value_string);
+
+  if (tmp_render_cpu >= CPU_SETSIZE)
+  {
+    logger("[CONFIG] Error parsing parameter \"render_cpu\": value must be lower than " + std::to_string(CPU_SETSIZE) + "!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.render_cpu = tmp_render_cpu;
+
+  return true;
+}
+
+/*
+ * Parse "lock_memory" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_lock_memory_value(LumizeConfig &config, std::string &value_string)
+{
+  bool tmp_lock_memory;
+
+  // Differentiate between values
+  if (value_string == "true" || value_string == "yes" || value_string == "on" || value_string == "1")
+  {
+    tmp_lock_memory = true;
+  }
+  else if (value_string == "false" || value_string == "no" || value_string == "off" || value_string == "0")
+  {
+    tmp_lock_memory = false;
+  }
+  else
+  {
+    // Value was not valid
+    logger("[CONFIG] Error parsing parameter \"lock_memory\": value is not a valid boolean!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.lock_memory = tmp_lock_memory;
+
+  return true;
+}
+
+/*
+ * Parse "single_thread_runtime" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_single_thread_runtime_value(LumizeConfig &config, std::string &value_string)
+{
+  bool tmp_single_thread_runtime;
+
+  // Differentiate between values
+  if (value_string == "true" || value_string == "yes" || value_string == "on" || value_string == "1")
+  {
+    tmp_single_thread_runtime = true;
+  }
+  else if (value_string == "false" || value_string == "no" || value_string == "off" || value_string == "0")
+  {
+    tmp_single_thread_runtime = false;
+  }
+  else
+  {
+    // Value was not valid
+    logger("[CONFIG] Error parsing parameter \"single_thread_runtime\": value is not a valid boolean!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.single_thread_runtime = tmp_single_thread_runtime;
+
+  return true;
+}
+
+/*
+ * Parse "enable_shm_export" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_enable_shm_export_value(LumizeConfig &config, std::string &value_string)
+{
+  bool tmp_enable_shm_export;
+
+  // Differentiate between values
+  if (value_string == "true" || value_string == "yes" || value_string == "on" || value_string == "1")
+  {
+    tmp_enable_shm_export = true;
+  }
+  else if (value_string == "false" || value_string == "no" || value_string == "off" || value_string == "0")
+  {
+    tmp_enable_shm_export = false;
+  }
+  else
+  {
+    // Value was not valid
+    logger("[CONFIG] Error parsing parameter \"enable_shm_export\": value is not a valid boolean!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.enable_shm_export = tmp_enable_shm_export;
+
+  return true;
+}
+
+/*
+ * Parse "shm_export_name" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_shm_export_name_value(LumizeConfig &config, std::string &value_string)
+{
+  if (value_string == "")
+  {
+    logger("[CONFIG] Error parsing parameter \"shm_export_name\": value cannot be empty!", LOG_ERR, false);
+    return false;
+  }
+
+  // POSIX shared memory names are a single path component
+  if (value_string[0] != '/' || value_string.length() < 2 || value_string.find('/', 1) != std::string::npos)
+  {
+    logger("[CONFIG] Error parsing parameter \"shm_export_name\": value must be a slash followed by a name!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.shm_export_name = value_string;
+
+  return true;
+}
+
+/*
+ * Parse "scenes_file_path" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_scenes_file_path_value(LumizeConfig &config, std::string &value_string)
+{
+  if (value_string == "")
+  {
+    logger("[CONFIG] Error parsing parameter \"scenes_file_path\": value cannot be empty!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.scenes_file_path = value_string;
+
+  return true;
+}
+
+/*
+ * Checks if a string can be used as the name of a group or fixture. Names
+ * must not be mistaken for channel numbers
+ * Parameters:
+ *  - const std::string &name: name to check
+ *  - size_t max_length: longest name allowed
+ * Returns: true if it starts with a letter and only contains letters, digits, '-' and '_'
+ */
+bool is_valid_config_name(const std::string &name, size_t max_length)
+{
+  return !name.empty() && name.length() <= max_length && isalpha((unsigned char)name[0]) &&
+         std::find_if(name.begin(), name.end(), [](char c) { return !isalnum((unsigned char)c) && c != '-' && c != '_'; }) == name.end();
+}
+
+/*
+ * Parses a list of channels and channel ranges separated by commas (e.g. 0-7,12)
+ * Parameters:
+ *  - const std::string &option: name of the config parameter, for error messages
+ *  - const std::string &value_string: list to parse
+ *  - int last_channel: highest channel that can be listed
+ *  - bool *channels: 512 flags, set for every channel in the list
+ * Returns: true if the list was correct
+ */
+bool parse_channel_list(const std::string &option, const std::string &value_string, int last_channel, bool *channels)
+{
+  // Divide into channels and channel ranges
+  std::vector<std::string> settings = configreader_split_string(value_string, ',');
+
+  for (unsigned int i = 0; i < settings.size(); i++)
+  {
+    std::vector<std::string> range_split = configreader_split_string(settings[i], '-');
+    int first, last;
+
+    try
+    {
+      if (range_split.size() < 1 || range_split.size() > 2)
+        throw std::invalid_argument("range");
+
+      first = std::stoi(range_split[0]);
+      last = std::stoi(range_split.back());
+    }
+    catch (const std::exception &e)
+    {
+      logger("[CONFIG] Error parsing parameter \"" + option + "\": channels must be in format channel or first-last!", LOG_ERR, false);
+      return false;
+    }
+
+    if (first < 0 || last > last_channel || first > last)
+    {
+      logger("[CONFIG] Error parsing parameter \"" + option + "\": channel value must be between 0 and " + std::to_string(last_channel) + "!", LOG_ERR, false);
+      return false;
+    }
+
+    for (int channel = first; channel <= last; channel++)
+      channels[channel] = true;
+  }
+
+  return true;
+}
+
+/*
+ * Parse "group" config parameter. Can be given once per group
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_group_value(LumizeConfig &config, std::string &value_string)
+{
+  std::vector<std::string> name_split = configreader_split_string(value_string, ':');
+  bool in_group[512] = {};
+  std::vector<int> channels;
+
+  if (name_split.size() != 2)
+  {
+    logger("[CONFIG] Error parsing parameter \"group\": values must be in format name:channels", LOG_ERR, false);
+    return false;
+  }
+
+  std::string &name = name_split[0];
+
+  if (!is_valid_config_name(name, GROUP_NAME_MAX_LENGTH))
+  {
+    logger("[CONFIG] Error parsing parameter \"group\": name must start with a letter and contain only letters, digits, '-' and '_'!", LOG_ERR, false);
+    return false;
+  }
+
+  if (!parse_channel_list(CONFIG_OPTION_GROUP, name_split[1], 511, in_group))
+    return false;
+
+  // Precompile sorted channel list
+  for (int channel = 0; channel < 512; channel++)
+    if (in_group[channel])
+      channels.push_back(channel);
+
+  if (channels.empty())
+  {
+    logger("[CONFIG] Error parsing parameter \"group\": group " + name + " has no channels!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.groups[name] = channels;
+
+  return true;
+}
+
+/*
+ * Parse "fine_channels" config parameter. Each channel listed is the coarse
+ * byte of a 16-bit light, the following channel is its fine byte
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_fine_channels_value(LumizeConfig &config, std::string &value_string)
+{
+  bool is_coarse[512] = {};
+  std::vector<int> fine_channels;
+
+  // Fine byte must be inside the universe
+  if (!parse_channel_list(CONFIG_OPTION_FINE_CHANNELS, value_string, 510, is_coarse))
+    return false;
+
+  // Precompile sorted channel list
+  for (int channel = 0; channel < 511; channel++)
+  {
+    if (!is_coarse[channel])
+      continue;
+
+    if (channel > 0 && is_coarse[channel - 1])
+    {
+      logger("[CONFIG] Error parsing parameter \"fine_channels\": channel " + std::to_string(channel) + " is already the fine byte of channel " + std::to_string(channel - 1) + "!", LOG_ERR, false);
+      return false;
+    }
+
+    fine_channels.push_back(channel);
+  }
+
+  // Set config parameter
+  config.fine_channels = fine_channels;
+
+  return true;
+}
+
+/*
+ * Parse "ltp_channels" config parameter. Listed channels are merged
+ * latest takes precedence between sources of the same priority
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_ltp_channels_value(LumizeConfig &config, std::string &value_string)
+{
+  bool is_ltp[512] = {};
+
+  if (!parse_channel_list(CONFIG_OPTION_LTP_CHANNELS, value_string, 511, is_ltp))
+    return false;
+
+  // Set config parameter
+  std::copy(is_ltp, is_ltp + 512, config.ltp_channels.begin());
+
+  return true;
+}
+
+/*
+ * Parse "main_source_priority" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_main_source_priority_value(LumizeConfig &config, std::string &value_string)
+{
+  int tmp_main_source_priority;
+
+  // Check that string contains a number
+  if (!isNumber(value_string))
+  {
+    logger("[CONFIG] Error parsing parameter \"main_source_priority\": value is not a number!", LOG_ERR, false);
+    return false;
+  }
+
+  // Convert from string to int
+  tmp_main_source_priority = std::stoi(value_string);
+
+  if (tmp_main_source_priority < 0 || tmp_main_source_priority > 255)
+  {
+    logger("[CONFIG] Error parsing parameter \"main_source_priority\": value must be between 0 and 255!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.main_source_priority = tmp_main_source_priority;
+
+  return true;
+}
+
+/*
+ * Parse "patch" config parameter. Can be given once per logical channel,
+ * and is compiled into the table of the logical channel of each physical slot
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_patch_value(LumizeConfig &config, std::string &value_string)
+{
+  std::vector<std::string> channel_split = configreader_split_string(value_string, ':');
+  bool is_slot[512] = {};
+  int channel;
+
+  if (channel_split.size() != 2)
+  {
+    logger("[CONFIG] Error parsing parameter \"patch\": values must be in format channel:slots", LOG_ERR, false);
+    return false;
+  }
+
+  try
+  {
+    channel = std::stoi(channel_split[0]);
+  }
+  catch (const std::exception &e)
+  {
+    logger("[CONFIG] Error parsing parameter \"patch\": channel value is not a number!", LOG_ERR, false);
+    return false;
+  }
+
+  if (channel < 0 || channel > 511)
+  {
+    logger("[CONFIG] Error parsing parameter \"patch\": channel value must be between 0 and 511!", LOG_ERR, false);
+    return false;
+  }
+
+  if (!parse_channel_list(CONFIG_OPTION_PATCH, channel_split[1], 511, is_slot))
+    return false;
+
+  // A slot can only output one channel
+  for (int slot = 0; slot < 512; slot++)
+  {
+    if (is_slot[slot] && config.patch_table[slot] != PATCH_UNPATCHED && config.patch_table[slot] != channel)
+    {
+      logger("[CONFIG] Error parsing parameter \"patch\": slot " + std::to_string(slot) + " is already patched to channel " + std::to_string(config.patch_table[slot]) + "!", LOG_ERR, false);
+      return false;
+    }
+  }
+
+  // Set config parameter
+  for (int slot = 0; slot < 512; slot++)
+    if (is_slot[slot])
+      config.patch_table[slot] = channel;
+  config.has_patch = true;
+
+  return true;
+}
+
+/*
+ * Parse "fixture" config parameter. Can be given once per fixture
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_fixture_value(LumizeConfig &config, std::string &value_string)
+{
+  std::vector<std::string> fixture_split = configreader_split_string(value_string, ':');
+  const char *type_names[] = {FIXTURE_TYPE_NAMES};
+  const int type_channels[] = {FIXTURE_TYPE_CHANNELS};
+  FixtureDefinition fixture;
+
+  if (fixture_split.size() < 3 || fixture_split.size() > 4)
+  {
+    logger("[CONFIG] Error parsing parameter \"fixture\": values must be in format name:type:channel or name:cct:channel:warm-cool", LOG_ERR, false);
+    return false;
+  }
+
+  std::string &name = fixture_split[0];
+
+  if (!is_valid_config_name(name, FIXTURE_NAME_MAX_LENGTH))
+  {
+    logger("[CONFIG] Error parsing parameter \"fixture\": name must start with a letter and contain only letters, digits, '-' and '_'!", LOG_ERR, false);
+    return false;
+  }
+
+  fixture.type = std::find(type_names, type_names + 3, fixture_split[1]) - type_names;
+  if (fixture.type == 3)
+  {
+    logger("[CONFIG] Error parsing parameter \"fixture\": type must be rgb, rgbw or cct!", LOG_ERR, false);
+    return false;
+  }
+  fixture.channel_count = type_channels[fixture.type];
+
+  if (fixture_split[2].empty() || !isNumber(fixture_split[2]) || fixture_split[2].length() > 9)
+  {
+    logger("[CONFIG] Error parsing parameter \"fixture\": channel value is not a number!", LOG_ERR, false);
+    return false;
+  }
+
+  fixture.channel = std::stoi(fixture_split[2]);
+
+  // All channels of the fixture must be inside the universe
+  if (fixture.channel < 0 || fixture.channel + fixture.channel_count > 512)
+  {
+    logger("[CONFIG] Error parsing parameter \"fixture\": channel value must be between 0 and " + std::to_string(512 - fixture.channel_count) + " for " + fixture_split[1] + " fixtures!", LOG_ERR, false);
+    return false;
+  }
+
+  fixture.warm_temperature = DEFAULT_FIXTURE_WARM_TEMPERATURE;
+  fixture.cool_temperature = DEFAULT_FIXTURE_COOL_TEMPERATURE;
+
+  // Color temperatures of the white channels
+  if (fixture_split.size() == 4)
+  {
+    std::vector<std::string> temperature_split = configreader_split_string(fixture_split[3], '-');
+
+    if (fixture.type != FIXTURE_TYPE_CCT || temperature_split.size() != 2 || temperature_split[0].empty() || temperature_split[1].empty() ||
+        !isNumber(temperature_split[0]) || !isNumber(temperature_split[1]) || temperature_split[0].length() > 9 || temperature_split[1].length() > 9)
+    {
+      logger("[CONFIG] Error parsing parameter \"fixture\": color temperatures must be in format warm-cool and are only valid for cct fixtures!", LOG_ERR, false);
+      return false;
+    }
+
+    fixture.warm_temperature = std::stoi(temperature_split[0]);
+    fixture.cool_temperature = std::stoi(temperature_split[1]);
+
+    if (fixture.warm_temperature < 1000 || fixture.cool_temperature > 20000 || fixture.warm_temperature >= fixture.cool_temperature)
+    {
+      logger("[CONFIG] Error parsing parameter \"fixture\": color temperatures must be between 1000 and 20000 K, warm lower than cool!", LOG_ERR, false);
+      return false;
+    }
+  }
+
+  // A channel can only belong to one fixture
+  for (std::map<std::string, FixtureDefinition>::iterator other = config.fixtures.begin(); other != config.fixtures.end(); other++)
+  {
+    if (other->first != name && fixture.channel < other->second.channel + other->second.channel_count && other->second.channel < fixture.channel + fixture.channel_count)
+    {
+      logger("[CONFIG] Error parsing parameter \"fixture\": fixture " + name + " overlaps with fixture " + other->first + "!", LOG_ERR, false);
+      return false;
+    }
+  }
+
+  // Set config parameter
+  config.fixtures[name] = fixture;
+
+  return true;
+}
+
+/*
+ * Parse "cue_lists_path" config parameter
+ * Parameters:
+ *  - LumizeConfig &config: config struct to update
+ *  - std::string &value_string: reference to input string
+ * Returns: true if parameter was correct
+ */
+bool parse_cue_lists_path_value(LumizeConfig &config, std::string &value_string)
+{
+  if (value_string == "")
+  {
+    logger("[CONFIG] Error parsing parameter \"cue_lists_path\": value cannot be empty!", LOG_ERR, false);
+    return false;
+  }
+
+  // Set config parameter
+  config.cue_lists_path = value_string;
+
+  return true;
+}
+
+/*
+ * Sets up brightness limits values
+ * Parameters:
+ *  LumizeConfig &config: config object
+ */
+void setup_brightness_limits(LumizeConfig &config)
+{
+  for (unsigned int i = 0; i < config.brightness_limits.size(); i++)
+  {
+    config.brightness_limits[i].min = DEFAULT_MIN_BRIGHTNESS;
+    config.brightness_limits[i].max = DEFAULT_MAX_BRIGHTNESS;
+  }
+}
+
+/*
+ * Reads from configuration file and saves the parameters in LumizeConfig struct
+ * Parameters:
+ *  - LumizeConfig &config: reference to the LumizeConfig struct to save into
+ * Returns: true if succesful
+ */
+bool read_config(LumizeConfig &config)
+{
+  std::string line;
+  std::vector<std::string> string_split;
+  std::ifstream file(CONFIG_FILE_PATH);
+
+  // Initialize brightness limits
+  setup_brightness_limits(config);
+
+  // Slots output nothing until they're patched
+  config.patch_table.fill(PATCH_UNPATCHED);
+
+  // Check that file opened succesfully
+  if (file.is_open())
+  {
+    while (getline(file, line))
+    {
+      remove_whitespace(line);
+
+      // Check if line is comment
+      if (line[0] == '#')
+        continue;
+
+      // Split string by = character
+      string_split = configreader_split_string(line, '=');
+
+      // Check that the message is of right format
+      if (string_split.size() > 1)
+        // Iterate over messages
+        for (size_t i = 0; i < string_split.size(); i++)
+        {
+          // Read messages
+          if (string_split[0] == CONFIG_OPTION_PORT)
+          {
+            if (!parse_port_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_CHANNELS)
+          {
+            if (!parse_channels_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_FPS)
+          {
+            if (!parse_fps_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_DEFAULT_TRANSITION)
+          {
+            if (!parse_default_transition_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_BRIGHTNESS_LIMITS)
+          {
+            if (!parse_brightness_limits_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_PUSHBUTTON_FADE_DELTA)
+          {
+            if (!parse_pushbutton_fade_delta_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_PUSHBUTTON_FADE_PAUSE)
+          {
+            if (!parse_pushbutton_fade_pause_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_PUSHBUTTON_FADE_RESET_DELAY)
+          {
+            if (!parse_pushbutton_fade_reset_delay_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_ENABLE_PERSISTENCY)
+          {
+            if (!parse_enable_persistency_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_PERSISTENCY_FILE_PATH)
+          {
+            if (!parse_persistency_file_path_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_PERSISTENCY_WRITE_INTERVAL)
+          {
+            if (!parse_persistency_write_interval_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_PERSISTENCY_COMPACT_RECORDS)
+          {
+            if (!parse_persistency_compact_records_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_PERSISTENCY_DEBOUNCE)
+          {
+            if (!parse_persistency_debounce_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_PERSISTENCY_MAX_DELAY)
+          {
+            if (!parse_persistency_max_delay_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_LOG_DEBUG)
+          {
+            if (!parse_log_debug_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_ENABLE_METRICS)
+          {
+            if (!parse_enable_metrics_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_METRICS_PORT)
+          {
+            if (!parse_metrics_port_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_ENABLE_HANDOVER)
+          {
+            if (!parse_enable_handover_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_HANDOVER_SOCKET_PATH)
+          {
+            if (!parse_handover_socket_path_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_REALTIME_POLICY)
+          {
+            if (!parse_realtime_policy_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_REALTIME_PRIORITY)
+          {
+            if (!parse_realtime_priority_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_RENDER_CPU)
+          {
+            if (!parse_render_cpu_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_LOCK_MEMORY)
+          {
+            if (!parse_lock_memory_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_SINGLE_THREAD_RUNTIME)
+          {
+            if (!parse_single_thread_runtime_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_ENABLE_SHM_EXPORT)
+          {
+            if (!parse_enable_shm_export_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_SHM_EXPORT_NAME)
+          {
+            if (!parse_shm_export_name_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_SCENES_FILE_PATH)
+          {
+            if (!parse_scenes_file_path_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_GROUP)
+          {
+            if (!parse_group_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_FINE_CHANNELS)
+          {
+            if (!parse_fine_channels_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_LTP_CHANNELS)
+          {
+            if (!parse_ltp_channels_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_PATCH)
+          {
+            if (!parse_patch_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_MAIN_SOURCE_PRIORITY)
+          {
+            if (!parse_main_source_priority_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_FIXTURE)
+          {
+            if (!parse_fixture_value(config, string_split[1]))
+              return false;
+          }
+          else if (string_split[0] == CONFIG_OPTION_CUE_LISTS_PATH)
+          {
+            if (!parse_cue_lists_path_value(config, string_split[1]))
               return false;
           }
         }
@@ -13,8 +13,11 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <map>
 #include <array>
+#include <cstdint>
 #include <sstream>
+#include <sched.h>
 
 #include "./logger.h"
 
@@ -32,7 +35,24 @@
 #define DEFAULT_CONFIG_ENABLE_PERSISTENCY false
 #define DEFAULT_CONFIG_PERSISTENCY_FILE_PATH "/var/lib/lumizedmxengine2/persistency"
 #define DEFAULT_CONFIG_PERSISTENCY_WRITE_INTERVAL 600 // s
+#define DEFAULT_CONFIG_PERSISTENCY_COMPACT_RECORDS 256
+#define DEFAULT_CONFIG_PERSISTENCY_DEBOUNCE 500   // ms
+#define DEFAULT_CONFIG_PERSISTENCY_MAX_DELAY 5000 // ms
 #define DEFAULT_CONFIG_LOG_DEBUG false
+#define DEFAULT_CONFIG_ENABLE_METRICS false
+#define DEFAULT_CONFIG_METRICS_PORT 8057
+#define DEFAULT_CONFIG_ENABLE_HANDOVER false
+#define DEFAULT_CONFIG_HANDOVER_SOCKET_PATH "/run/lumizedmxengine2.sock"
+#define DEFAULT_CONFIG_REALTIME_POLICY REALTIME_POLICY_NONE
+#define DEFAULT_CONFIG_REALTIME_PRIORITY 50
+#define DEFAULT_CONFIG_RENDER_CPU -1 // Not pinned
+#define DEFAULT_CONFIG_LOCK_MEMORY false
+#define DEFAULT_CONFIG_SINGLE_THREAD_RUNTIME false
+#define DEFAULT_CONFIG_ENABLE_SHM_EXPORT false
+#define DEFAULT_CONFIG_SHM_EXPORT_NAME "/lumizedmxengine2"
+#define DEFAULT_CONFIG_SCENES_FILE_PATH "/var/lib/lumizedmxengine2/scenes"
+#define DEFAULT_CONFIG_MAIN_SOURCE_PRIORITY 100
+#define DEFAULT_CONFIG_CUE_LISTS_PATH "/var/lib/lumizedmxengine2/cuelists"
 
 // Configuration keys
 #define CONFIG_OPTION_PORT "port"
@@ -46,7 +66,50 @@
 #define CONFIG_OPTION_ENABLE_PERSISTENCY "enable_persistency"
 #define CONFIG_OPTION_PERSISTENCY_FILE_PATH "persistency_file_path"
 #define CONFIG_OPTION_PERSISTENCY_WRITE_INTERVAL "persistency_write_interval"
+#define CONFIG_OPTION_PERSISTENCY_COMPACT_RECORDS "persistency_compact_records"
+#define CONFIG_OPTION_PERSISTENCY_DEBOUNCE "persistency_debounce"
+#define CONFIG_OPTION_PERSISTENCY_MAX_DELAY "persistency_max_delay"
 #define CONFIG_OPTION_LOG_DEBUG "log_debug"
+#define CONFIG_OPTION_ENABLE_METRICS "enable_metrics"
+#define CONFIG_OPTION_METRICS_PORT "metrics_port"
+#define CONFIG_OPTION_ENABLE_HANDOVER "enable_handover"
+#define CONFIG_OPTION_HANDOVER_SOCKET_PATH "handover_socket_path"
+#define CONFIG_OPTION_REALTIME_POLICY "realtime_policy"
+#define CONFIG_OPTION_REALTIME_PRIORITY "realtime_priority"
+#define CONFIG_OPTION_RENDER_CPU "render_cpu"
+#define CONFIG_OPTION_LOCK_MEMORY "lock_memory"
+#define CONFIG_OPTION_SINGLE_THREAD_RUNTIME "single_thread_runtime"
+#define CONFIG_OPTION_ENABLE_SHM_EXPORT "enable_shm_export"
+#define CONFIG_OPTION_SHM_EXPORT_NAME "shm_export_name"
+#define CONFIG_OPTION_SCENES_FILE_PATH "scenes_file_path"
+#define CONFIG_OPTION_GROUP "group"
+#define CONFIG_OPTION_FINE_CHANNELS "fine_channels"
+#define CONFIG_OPTION_LTP_CHANNELS "ltp_channels"
+#define CONFIG_OPTION_PATCH "patch"
+#define CONFIG_OPTION_FIXTURE "fixture"
+#define CONFIG_OPTION_MAIN_SOURCE_PRIORITY "main_source_priority"
+#define CONFIG_OPTION_CUE_LISTS_PATH "cue_lists_path"
+
+// Channel groups
+#define GROUP_NAME_MAX_LENGTH 31
+
+// Physical slot no logical channel is patched to
+#define PATCH_UNPATCHED 512
+
+// Color fixtures, channels in order
+#define FIXTURE_NAME_MAX_LENGTH 31
+#define FIXTURE_TYPE_RGB 0  // red, green, blue
+#define FIXTURE_TYPE_RGBW 1 // red, green, blue, white
+#define FIXTURE_TYPE_CCT 2  // warm white, cool white
+#define FIXTURE_TYPE_NAMES "rgb", "rgbw", "cct"
+#define FIXTURE_TYPE_CHANNELS 3, 4, 2
+#define DEFAULT_FIXTURE_WARM_TEMPERATURE 2700 // K
+#define DEFAULT_FIXTURE_COOL_TEMPERATURE 6500 // K
+
+// Realtime scheduling policies
+#define REALTIME_POLICY_NONE "none"
+#define REALTIME_POLICY_FIFO "fifo"
+#define REALTIME_POLICY_RR "rr"
 
 // Default minimum and maximum value for all lights
 #define DEFAULT_MIN_BRIGHTNESS 0
@@ -59,6 +122,16 @@ struct BrightnessLimits
    int max;
 };
 
+// Color fixture made of consecutive channels
+struct FixtureDefinition
+{
+   int type;             // FIXTURE_TYPE_*
+   int channel;          // First channel
+   int channel_count;    // Channels used by the type
+   int warm_temperature; // K, of the warm white channel of CCT fixtures
+   int cool_temperature; // K, of the cool white channel of CCT fixtures
+};
+
 // Struct that will hold the config
 struct LumizeConfig
 {
@@ -73,7 +146,30 @@ struct LumizeConfig
    bool enable_persistency = DEFAULT_CONFIG_ENABLE_PERSISTENCY;
    std::string persistency_file_path = DEFAULT_CONFIG_PERSISTENCY_FILE_PATH;
    int persistency_write_interval = DEFAULT_CONFIG_PERSISTENCY_WRITE_INTERVAL;
+   int persistency_compact_records = DEFAULT_CONFIG_PERSISTENCY_COMPACT_RECORDS;
+   int persistency_debounce = DEFAULT_CONFIG_PERSISTENCY_DEBOUNCE;
+   int persistency_max_delay = DEFAULT_CONFIG_PERSISTENCY_MAX_DELAY;
    bool log_debug = DEFAULT_CONFIG_LOG_DEBUG;
+   bool enable_metrics = DEFAULT_CONFIG_ENABLE_METRICS;
+   int metrics_port = DEFAULT_CONFIG_METRICS_PORT;
+   bool enable_handover = DEFAULT_CONFIG_ENABLE_HANDOVER;
+   std::string handover_socket_path = DEFAULT_CONFIG_HANDOVER_SOCKET_PATH;
+   std::string realtime_policy = DEFAULT_CONFIG_REALTIME_POLICY;
+   int realtime_priority = DEFAULT_CONFIG_REALTIME_PRIORITY;
+   int render_cpu = DEFAULT_CONFIG_RENDER_CPU;
+   bool lock_memory = DEFAULT_CONFIG_LOCK_MEMORY;
+   bool single_thread_runtime = DEFAULT_CONFIG_SINGLE_THREAD_RUNTIME;
+   bool enable_shm_export = DEFAULT_CONFIG_ENABLE_SHM_EXPORT;
+   std::string shm_export_name = DEFAULT_CONFIG_SHM_EXPORT_NAME;
+   std::string scenes_file_path = DEFAULT_CONFIG_SCENES_FILE_PATH;
+   std::map<std::string, std::vector<int>> groups; // Sorted channels of each group, by name
+   std::vector<int> fine_channels;                 // Sorted coarse channels of 16-bit lights, fine byte follows
+   std::array<bool, 512> ltp_channels = {};        // Channels merged latest takes precedence instead of highest
+   bool has_patch = false;                         // Channels are output through patch_table instead of one to one
+   std::array<uint16_t, 512> patch_table;          // Logical channel output on each physical slot, PATCH_UNPATCHED if none
+   int main_source_priority = DEFAULT_CONFIG_MAIN_SOURCE_PRIORITY;
+   std::map<std::string, FixtureDefinition> fixtures; // Color fixtures, by name
+   std::string cue_lists_path = DEFAULT_CONFIG_CUE_LISTS_PATH;
 };
 
 bool read_config(LumizeConfig &config);
\ No newline at end of file
@@ -0,0 +1,307 @@
+/*
+ * Filename: configwatcher.cpp
+ * Description: implementation of the ConfigWatcher class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "configwatcher.h" // Include definition of class to be implemented
+#include "tcpserver.h"
+
+/*
+ ********** HELPER FUNCTIONS **********
+ */
+
+/*
+ * Lists the options that changed between two configs but are only
+ * applied when the engine is restarted
+ * Parameters:
+ *  - const LumizeConfig &old_config: config currently in use
+ *  - const LumizeConfig &new_config: config just read
+ * Returns: comma separated option names, empty if none changed
+ */
+static std::string get_restart_only_changes(const LumizeConfig &old_config, const LumizeConfig &new_config)
+{
+   std::string changes;
+
+   if (old_config.enable_persistency != new_config.enable_persistency)
+      changes.append(CONFIG_OPTION_ENABLE_PERSISTENCY ", ");
+   if (old_config.persistency_file_path != new_config.persistency_file_path)
+      changes.append(CONFIG_OPTION_PERSISTENCY_FILE_PATH ", ");
+   if (old_config.persistency_write_interval != new_config.persistency_write_interval)
+      changes.append(CONFIG_OPTION_PERSISTENCY_WRITE_INTERVAL ", ");
+   if (old_config.persistency_compact_records != new_config.persistency_compact_records)
+      changes.append(CONFIG_OPTION_PERSISTENCY_COMPACT_RECORDS ", ");
+   if (old_config.persistency_debounce != new_config.persistency_debounce)
+      changes.append(CONFIG_OPTION_PERSISTENCY_DEBOUNCE ", ");
+   if (old_config.persistency_max_delay != new_config.persistency_max_delay)
+      changes.append(CONFIG_OPTION_PERSISTENCY_MAX_DELAY ", ");
+   if (old_config.enable_metrics != new_config.enable_metrics)
+      changes.append(CONFIG_OPTION_ENABLE_METRICS ", ");
+   if (old_config.metrics_port != new_config.metrics_port)
+      changes.append(CONFIG_OPTION_METRICS_PORT ", ");
+   if (old_config.enable_handover != new_config.enable_handover)
+      changes.append(CONFIG_OPTION_ENABLE_HANDOVER ", ");
+   if (old_config.handover_socket_path != new_config.handover_socket_path)
+      changes.append(CONFIG_OPTION_HANDOVER_SOCKET_PATH ", ");
+   if (old_config.realtime_policy != new_config.realtime_policy)
+      changes.append(CONFIG_OPTION_REALTIME_POLICY ", ");
+   if (old_config.realtime_priority != new_config.realtime_priority)
+      changes.append(CONFIG_OPTION_REALTIME_PRIORITY ", ");
+   if (old_config.render_cpu != new_config.render_cpu)
+      changes.append(CONFIG_OPTION_RENDER_CPU ", ");
+   if (old_config.lock_memory != new_config.lock_memory)
+      changes.append(CONFIG_OPTION_LOCK_MEMORY ", ");
+   if (old_config.single_thread_runtime != new_config.single_thread_runtime)
+      changes.append(CONFIG_OPTION_SINGLE_THREAD_RUNTIME ", ");
+   if (old_config.enable_shm_export != new_config.enable_shm_export)
+      changes.append(CONFIG_OPTION_ENABLE_SHM_EXPORT ", ");
+   if (old_config.shm_export_name != new_config.shm_export_name)
+      changes.append(CONFIG_OPTION_SHM_EXPORT_NAME ", ");
+   if (old_config.scenes_file_path != new_config.scenes_file_path)
+      changes.append(CONFIG_OPTION_SCENES_FILE_PATH ", ");
+
+   // Remove trailing separator
+   if (!changes.empty())
+      changes.resize(changes.length() - 2);
+
+   return changes;
+}
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Starts watching the config file
+ * Returns: true if succesful
+ */
+bool ConfigWatcher::start()
+{
+   std::string config_file_path = CONFIG_FILE_PATH;
+   std::string config_dir = config_file_path.substr(0, config_file_path.rfind('/') + 1);
+
+   if (pipe(wake_pipe) < 0)
+   {
+      logger("[CONFIG] Error on pipe() system call!", LOG_ERR, false);
+      return false;
+   }
+
+   // Editors usually replace the file instead of writing to it,
+   // so the directory is watched instead of the file itself
+   if ((inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0 ||
+       inotify_add_watch(inotify_fd, config_dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+   {
+      logger("[CONFIG] Unable to watch " + config_file_path + ", config is only reloaded on SIGHUP", LOG_WARN, false);
+
+      if (inotify_fd >= 0)
+         close(inotify_fd);
+      inotify_fd = -1;
+   }
+
+   running = true;
+   watcher_thread = std::thread(&ConfigWatcher::main_loop, this);
+
+   LOGGER_DEBUG("[CONFIG] Watching " + config_file_path + " for changes", LOG_INFO);
+   return true;
+}
+
+/*
+ * Stops watching the config file
+ */
+void ConfigWatcher::stop()
+{
+   if (!watcher_thread.joinable())
+      return;
+
+   running = false;
+
+   // Wake up poll() in the watcher thread
+   if (wake_pipe[1] >= 0 && write(wake_pipe[1], "s", 1) < 0)
+      LOGGER_DEBUG("[CONFIG] Error waking up watcher thread", LOG_WARN);
+
+   watcher_thread.join();
+
+   close(wake_pipe[0]);
+   close(wake_pipe[1]);
+   wake_pipe[0] = wake_pipe[1] = -1;
+
+   if (inotify_fd >= 0)
+      close(inotify_fd);
+   inotify_fd = -1;
+}
+
+/*
+ * Publishes the config read at startup
+ * Parameters:
+ *  - const LumizeConfig &config: startup config
+ */
+void ConfigWatcher::configure(const LumizeConfig &config)
+{
+   std::atomic_store(&this->config, std::shared_ptr<const LumizeConfig>(new LumizeConfig(config)));
+}
+
+/*
+ * Give ConfigWatcher access to the TCPServer, to wake it up when the config changes
+ * Parameters:
+ *  - TCPServer &tcp_server: reference to TCP server
+ */
+void ConfigWatcher::set_tcp_server(TCPServer &tcp_server)
+{
+   this->tcp_server = &tcp_server;
+}
+
+/*
+ * Register metrics of the config watcher
+ * Parameters:
+ *  - MetricsRegistry &metrics: registry to add the metrics to
+ */
+void ConfigWatcher::set_metrics(MetricsRegistry &metrics)
+{
+   reloads_counter = &metrics.add_counter("lumize_config_reloads_total", "Config reloads applied");
+   reload_errors_counter = &metrics.add_counter("lumize_config_reload_errors_total", "Config reloads rejected because the config file was not valid");
+}
+
+/*
+ * Asks the watcher thread to reload the config file
+ */
+void ConfigWatcher::request_reload()
+{
+   // Not started, or start() failed before creating the pipe
+   if (wake_pipe[1] < 0)
+      return;
+
+   if (write(wake_pipe[1], "r", 1) < 0)
+      LOGGER_DEBUG("[CONFIG] Error requesting config reload", LOG_WARN);
+}
+
+/*
+ * Returns: the current config, which never changes once published
+ */
+std::shared_ptr<const LumizeConfig> ConfigWatcher::get_config()
+{
+   return std::atomic_load(&config);
+}
+
+/*
+ * Returns: number of configs published after the startup one. Cheap
+ * enough to be checked every frame before calling get_config()
+ */
+unsigned long ConfigWatcher::get_generation()
+{
+   return generation.load(std::memory_order_acquire);
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+/*
+ * Waits for changes to the config file and for reload requests
+ */
+void ConfigWatcher::main_loop()
+{
+   struct pollfd fds[2];
+   bool change_pending = false;
+   int result;
+   char message;
+
+   // Negative file descriptors are ignored by poll()
+   fds[0].fd = wake_pipe[0];
+   fds[0].events = POLLIN;
+   fds[1].fd = inotify_fd;
+   fds[1].events = POLLIN;
+
+   while (running)
+   {
+      // Wait for the config file to stop changing before reading it
+      result = poll(fds, 2, change_pending ? CONFIG_RELOAD_DEBOUNCE : -1);
+
+      if (!running)
+         break;
+
+      if (result < 0)
+      {
+         if (errno != EINTR)
+            LOGGER_DEBUG("[CONFIG] Error on poll()", LOG_WARN);
+         continue;
+      }
+
+      // Config file hasn't changed for CONFIG_RELOAD_DEBOUNCE
+      if (result == 0)
+      {
+         change_pending = false;
+         reload();
+         continue;
+      }
+
+      if ((fds[0].revents & POLLIN) && read(wake_pipe[0], &message, 1) == 1 && message == 'r')
+      {
+         change_pending = false;
+         reload();
+      }
+
+      if ((fds[1].revents & POLLIN) && read_inotify_events())
+         change_pending = true;
+   }
+}
+
+/*
+ * Reads all pending inotify events
+ * Returns: true if one of them is about the config file
+ */
+bool ConfigWatcher::read_inotify_events()
+{
+   std::string config_file_path = CONFIG_FILE_PATH;
+   std::string config_file_name = config_file_path.substr(config_file_path.rfind('/') + 1);
+   char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+   const struct inotify_event *event;
+   bool config_changed = false;
+   ssize_t length;
+
+   while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0)
+      for (char *ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + event->len)
+      {
+         event = (const struct inotify_event *)ptr;
+
+         if (event->len > 0 && config_file_name == event->name)
+            config_changed = true;
+      }
+
+   return config_changed;
+}
+
+/*
+ * Reads the config file and publishes it if it's valid. The current
+ * config is kept otherwise
+ */
+void ConfigWatcher::reload()
+{
+   LumizeConfig new_config;
+   std::shared_ptr<const LumizeConfig> old_config = get_config();
+   std::string restart_only_changes;
+
+   logger("[CONFIG] Reloading config file...", LOG_INFO, false);
+
+   if (!read_config(new_config))
+   {
+      logger("[CONFIG] Config file is not valid, keeping current config", LOG_ERR, false);
+      reload_errors_counter->increment();
+      return;
+   }
+
+   restart_only_changes = get_restart_only_changes(*old_config, new_config);
+   if (!restart_only_changes.empty())
+      logger("[CONFIG] Changes to " + restart_only_changes + " will be applied after a restart", LOG_WARN, false);
+
+   set_enable_debug(new_config.log_debug);
+
+   // Publish config, the LightRenderer picks it up at the next frame
+   std::atomic_store(&config, std::shared_ptr<const LumizeConfig>(new LumizeConfig(new_config)));
+   generation.fetch_add(1, std::memory_order_release);
+
+   tcp_server->wake();
+
+   reloads_counter->increment();
+   logger("[CONFIG] Config reloaded", LOG_SUCC, false);
+}
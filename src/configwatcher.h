@@ -0,0 +1,67 @@
+/*
+ * Filename: configwatcher.h
+ * Description: interface for the ConfigWatcher class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+#include "configreader.h"
+#include "metrics.h"
+#include "logger.h"
+
+#define CONFIG_RELOAD_DEBOUNCE 200 // ms without changes to the config file before reloading it
+
+class TCPServer;
+
+/*
+ * Definition of the ConfigWatcher class
+ *
+ * Watches the config file for changes and reloads it when it changes or
+ * when a reload is requested. Valid configs are published as immutable
+ * objects, which the LightRenderer and TCPServer pick up from their own
+ * threads
+ */
+class ConfigWatcher
+{
+public:
+   // Methods
+   bool start();
+   void stop();
+   void configure(const LumizeConfig &config);
+   void set_tcp_server(TCPServer &tcp_server);
+   void set_metrics(MetricsRegistry &metrics);
+   void request_reload();
+   std::shared_ptr<const LumizeConfig> get_config();
+   unsigned long get_generation();
+
+private:
+   std::shared_ptr<const LumizeConfig> config; // Accessed with std::atomic_load and std::atomic_store
+   std::atomic<unsigned long> generation{0};   // Incremented after every publish
+   TCPServer *tcp_server;
+
+   int inotify_fd = -1;
+   int wake_pipe[2] = {-1, -1}; // Used to request a reload and to stop
+   std::atomic<bool> running{false};
+   std::thread watcher_thread;
+
+   // Metrics
+   Counter *reloads_counter;
+   Counter *reload_errors_counter;
+
+   // Internal functions
+   void main_loop();
+   bool read_inotify_events();
+   void reload();
+};
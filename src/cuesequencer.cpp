@@ -0,0 +1,483 @@
+/*
+ * Filename: cuesequencer.cpp
+ * Description: implementation of the CueSequencer class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "cuesequencer.h" // Include definition of class to be implemented
+#include "tcpserver.h"
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Loads a cue list, replacing the one with the same name. A cue list
+ * being replaced keeps playing from where it is
+ * Parameters:
+ *  - const std::string &name: name of the cue list, must be valid
+ *  - std::shared_ptr<const CueList> list: compiled cue list
+ * Returns: false if CUE_LISTS_MAX cue lists are already loaded
+ */
+bool CueSequencer::set_list(const std::string &name, std::shared_ptr<const CueList> list)
+{
+   std::map<std::string, CueListStatus>::iterator existing = lists.find(name);
+   bool is_free[CUE_LISTS_MAX];
+
+   if (existing == lists.end())
+   {
+      if (lists.size() >= CUE_LISTS_MAX)
+         return false;
+
+      // Take the first free id
+      std::fill(is_free, is_free + CUE_LISTS_MAX, true);
+      for (existing = lists.begin(); existing != lists.end(); existing++)
+         is_free[existing->second.id] = false;
+
+      existing = lists.insert(std::make_pair(name, CueListStatus())).first;
+      existing->second.id = std::find(is_free, is_free + CUE_LISTS_MAX, true) - is_free;
+   }
+
+   existing->second.list = list;
+   queue(CUE_COMMAND_SET, existing->second.id, list, 0);
+
+   return true;
+}
+
+/*
+ * Gets a loaded cue list
+ * Parameters:
+ *  - const std::string &name: name of the cue list
+ * Returns: the cue list, empty if it isn't loaded
+ */
+std::shared_ptr<const CueList> CueSequencer::find_list(const std::string &name)
+{
+   std::map<std::string, CueListStatus>::iterator existing = lists.find(name);
+
+   return existing != lists.end() ? existing->second.list : std::shared_ptr<const CueList>();
+}
+
+/*
+ * Stops and forgets a cue list
+ * Parameters:
+ *  - const std::string &name: name of the cue list
+ * Returns: false if it isn't loaded
+ */
+bool CueSequencer::remove_list(const std::string &name)
+{
+   std::map<std::string, CueListStatus>::iterator existing = lists.find(name);
+
+   if (existing == lists.end())
+      return false;
+
+   queue(CUE_COMMAND_REMOVE, existing->second.id, NULL, 0);
+   lists.erase(existing);
+
+   return true;
+}
+
+/*
+ * Plays a cue list from its current position
+ * Parameters:
+ *  - const std::string &name: name of the cue list
+ * Returns: false if it isn't loaded
+ */
+bool CueSequencer::go(const std::string &name)
+{
+   CueListStatus *status = find_status(name);
+
+   if (!status)
+      return false;
+
+   if (status->state != CUE_STATE_PLAYING)
+   {
+      status->state = CUE_STATE_PLAYING;
+      status->origin = std::chrono::steady_clock::now() - std::chrono::milliseconds(status->position);
+      queue(CUE_COMMAND_GO, status->id, NULL, status->position);
+   }
+
+   return true;
+}
+
+/*
+ * Pauses a cue list at its current position
+ * Parameters:
+ *  - const std::string &name: name of the cue list
+ * Returns: false if it isn't loaded
+ */
+bool CueSequencer::pause(const std::string &name)
+{
+   CueListStatus *status = find_status(name);
+
+   if (!status)
+      return false;
+
+   if (status->state == CUE_STATE_PLAYING)
+   {
+      status->state = CUE_STATE_PAUSED;
+      status->position = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - status->origin).count();
+      queue(CUE_COMMAND_PAUSE, status->id, NULL, 0);
+   }
+
+   return true;
+}
+
+/*
+ * Stops a cue list and rewinds it to the start
+ * Parameters:
+ *  - const std::string &name: name of the cue list
+ * Returns: false if it isn't loaded
+ */
+bool CueSequencer::stop(const std::string &name)
+{
+   CueListStatus *status = find_status(name);
+
+   if (!status)
+      return false;
+
+   status->state = CUE_STATE_STOPPED;
+   status->position = 0;
+   queue(CUE_COMMAND_STOP, status->id, NULL, 0);
+
+   return true;
+}
+
+/*
+ * Moves a cue list to a position. Events before the position are not
+ * fired, events from the position on are
+ * Parameters:
+ *  - const std::string &name: name of the cue list
+ *  - int position: ms from the start of the cue list
+ * Returns: false if it isn't loaded
+ */
+bool CueSequencer::seek(const std::string &name, int position)
+{
+   CueListStatus *status = find_status(name);
+
+   if (!status)
+      return false;
+
+   if (status->state == CUE_STATE_PLAYING)
+      status->origin = std::chrono::steady_clock::now() - std::chrono::milliseconds(position);
+   else
+      status->position = position;
+   queue(CUE_COMMAND_SEEK, status->id, NULL, position);
+
+   return true;
+}
+
+/*
+ * Gets the playback state of a cue list. Must only be called by the TCPServer
+ * Parameters:
+ *  - const std::string &name: name of the cue list
+ *  - int &state: where to store the CUE_STATE_*
+ *  - int &position: where to store the position in ms
+ * Returns: false if it isn't loaded
+ */
+bool CueSequencer::get_status(const std::string &name, int &state, int &position)
+{
+   CueListStatus *status = find_status(name);
+
+   if (!status)
+      return false;
+
+   state = status->state;
+   if (state == CUE_STATE_PLAYING)
+      position = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - status->origin).count();
+   else
+      position = status->position;
+
+   return true;
+}
+
+/*
+ * Takes the fade events fired since the last call. Must only be called by the TCPServer
+ * Parameters:
+ *  - std::vector<FiredCue> &fired: where to store the events, must be empty
+ */
+void CueSequencer::take_fired(std::vector<FiredCue> &fired)
+{
+   std::lock_guard<std::mutex> lk(fired_lock);
+
+   this->fired.swap(fired);
+}
+
+/*
+ * Give CueSequencer access to the command queue, to fire fades
+ * Parameters:
+ *  - CommandQueue &command_queue: reference to command queue
+ */
+void CueSequencer::set_command_queue(CommandQueue &command_queue)
+{
+   this->command_queue = &command_queue;
+}
+
+/*
+ * Give CueSequencer access to the EffectsEngine, to start and stop effects
+ * Parameters:
+ *  - EffectsEngine &effects: reference to effects engine
+ */
+void CueSequencer::set_effects_engine(EffectsEngine &effects)
+{
+   this->effects = &effects;
+}
+
+/*
+ * Give CueSequencer access to the TCPServer, to wake it up when fades are fired
+ * Parameters:
+ *  - TCPServer &tcp_server: reference to TCP server
+ */
+void CueSequencer::set_tcp_server(TCPServer &tcp_server)
+{
+   this->tcp_server = &tcp_server;
+}
+
+/*
+ * Fires the events of all playing cue lists that are due. Must only be
+ * called by the rendering thread, once per frame, before commands are applied
+ * Parameters:
+ *  - std::chrono::steady_clock::time_point now: start of the frame
+ */
+void CueSequencer::render(std::chrono::steady_clock::time_point now)
+{
+   bool has_fired = false;
+
+   // Only take the lock when the TCPServer changed something
+   if (has_pending.load(std::memory_order_acquire))
+      apply_pending(now);
+
+   if (playing == 0)
+      return;
+
+   for (int i = 0; i < CUE_LISTS_MAX; i++)
+      if (playbacks[i].state == CUE_STATE_PLAYING)
+         has_fired |= fire(playbacks[i], now);
+
+   // Only wake the TCPServer on frames that fired fades
+   if (has_fired)
+      tcp_server->wake();
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+/*
+ * Gets the status of a cue list, taking into account that it may have
+ * finished playing since it was last changed
+ * Parameters:
+ *  - const std::string &name: name of the cue list
+ * Returns: status of the cue list, NULL if it isn't loaded
+ */
+CueSequencer::CueListStatus *CueSequencer::find_status(const std::string &name)
+{
+   std::map<std::string, CueListStatus>::iterator existing = lists.find(name);
+
+   if (existing == lists.end())
+      return NULL;
+
+   CueListStatus &status = existing->second;
+
+   // The rendering thread stops cue lists once their last event fired
+   if (status.state == CUE_STATE_PLAYING && std::chrono::steady_clock::now() - status.origin >= std::chrono::milliseconds(status.list->length))
+   {
+      status.state = CUE_STATE_STOPPED;
+      status.position = 0;
+   }
+
+   return &status;
+}
+
+/*
+ * Queues a change for the rendering thread
+ * Parameters:
+ *  - int type: CUE_COMMAND_*
+ *  - int list: id of the cue list
+ *  - std::shared_ptr<const CueList> events: cue list of CUE_COMMAND_SET
+ *  - int position: position of CUE_COMMAND_SEEK
+ */
+void CueSequencer::queue(int type, int list, std::shared_ptr<const CueList> events, int position)
+{
+   std::lock_guard<std::mutex> lk(lock);
+   CueCommand command;
+
+   command.type = type;
+   command.list = list;
+   command.events = events;
+   command.position = position;
+   pending.push_back(command);
+   has_pending.store(true, std::memory_order_release);
+}
+
+/*
+ * Applies the changes requested since last frame, in order
+ * Parameters:
+ *  - std::chrono::steady_clock::time_point now: start of the frame
+ */
+void CueSequencer::apply_pending(std::chrono::steady_clock::time_point now)
+{
+   // Keep the lock only for the swap, the vectors keep their capacity
+   {
+      std::lock_guard<std::mutex> lk(lock);
+
+      applying.swap(pending);
+      has_pending.store(false, std::memory_order_relaxed);
+   }
+
+   for (size_t i = 0; i < applying.size(); i++)
+   {
+      const CueCommand &command = applying[i];
+      CuePlayback &playback = playbacks[command.list];
+      const bool was_playing = playback.state == CUE_STATE_PLAYING;
+
+      switch (command.type)
+      {
+      case CUE_COMMAND_SET:
+         // Events already fired are not fired again
+         playback.list = command.events;
+         playback.next_event = std::upper_bound(playback.list->events.begin(), playback.list->events.end(), playback.fired_until,
+                                                [](int time, const CueEvent &event) { return time < event.time; }) -
+                               playback.list->events.begin();
+         break;
+
+      case CUE_COMMAND_REMOVE:
+         playback = CuePlayback();
+         break;
+
+      case CUE_COMMAND_GO:
+         // The TCPServer saw the cue list finish before its last frame, play it again
+         if (was_playing)
+            seek_playback(playback, command.position, now);
+         playback.state = CUE_STATE_PLAYING;
+         playback.origin = now - std::chrono::milliseconds(command.position);
+         break;
+
+      case CUE_COMMAND_PAUSE:
+         if (was_playing)
+         {
+            playback.state = CUE_STATE_PAUSED;
+            playback.position = std::chrono::duration_cast<std::chrono::milliseconds>(now - playback.origin).count();
+         }
+         break;
+
+      case CUE_COMMAND_STOP:
+         playback.state = CUE_STATE_STOPPED;
+         playback.position = 0;
+         playback.fired_until = -1;
+         playback.next_event = 0;
+         break;
+
+      case CUE_COMMAND_SEEK:
+         seek_playback(playback, command.position, now);
+         break;
+      }
+
+      playing += (playback.state == CUE_STATE_PLAYING) - was_playing;
+   }
+
+   applying.clear();
+}
+
+/*
+ * Moves the playback of a cue list to a position, events at the position are fired
+ * Parameters:
+ *  - CuePlayback &playback: cue list to move
+ *  - int position: ms from the start of the cue list
+ *  - std::chrono::steady_clock::time_point now: start of the frame
+ */
+void CueSequencer::seek_playback(CuePlayback &playback, int position, std::chrono::steady_clock::time_point now)
+{
+   playback.position = position;
+   playback.origin = now - std::chrono::milliseconds(position);
+   playback.fired_until = position - 1;
+   playback.next_event = std::lower_bound(playback.list->events.begin(), playback.list->events.end(), position,
+                                          [](const CueEvent &event, int time) { return event.time < time; }) -
+                         playback.list->events.begin();
+}
+
+/*
+ * Fires the events of a cue list that are due, and stops it after its last event
+ * Parameters:
+ *  - CuePlayback &playback: playing cue list
+ *  - std::chrono::steady_clock::time_point now: start of the frame
+ * Returns: true if a fade was fired
+ */
+bool CueSequencer::fire(CuePlayback &playback, std::chrono::steady_clock::time_point now)
+{
+   const std::vector<CueEvent> &events = playback.list->events;
+   const long long position = std::chrono::duration_cast<std::chrono::milliseconds>(now - playback.origin).count();
+   bool has_fired = false;
+
+   for (; playback.next_event < events.size() && events[playback.next_event].time <= position; playback.next_event++)
+   {
+      const CueEvent &event = events[playback.next_event];
+
+      switch (event.type)
+      {
+      case CUE_EVENT_FADE:
+      {
+         std::lock_guard<std::mutex> lk(fired_lock);
+         FiredCue fired_cue;
+
+         // Commands are applied on this same frame
+         for (size_t i = 0; i < event.commands.size(); i++)
+         {
+            commands[i] = event.commands[i];
+            commands[i].received_time = now;
+         }
+         command_queue->push_batch(event.channels.size(), event.channels.data(), commands);
+
+         fired_cue.list = playback.list;
+         fired_cue.event = playback.next_event;
+         fired.push_back(fired_cue);
+         has_fired = true;
+         break;
+      }
+
+      case CUE_EVENT_EFFECT_START:
+         effects->start_effect(event.effect, event.effect_parameters);
+         break;
+
+      case CUE_EVENT_EFFECT_STOP:
+         effects->stop_effect(event.effect);
+         break;
+      }
+
+      playback.fired_until = event.time;
+   }
+
+   // Cue list is over, rewind it
+   if (playback.next_event >= events.size())
+   {
+      playback.state = CUE_STATE_STOPPED;
+      playback.position = 0;
+      playback.fired_until = -1;
+      playback.next_event = 0;
+      playing--;
+   }
+
+   return has_fired;
+}
+
+/*
+ ********** HELPER FUNCTIONS **********
+ */
+
+/*
+ * Checks if a string can be used as a cue list name, which is also its file name
+ * Parameters:
+ *  - const std::string &name: cue list name
+ * Returns: true if it starts with a letter and only contains letters, digits, '-' and '_'
+ */
+bool is_valid_cue_list_name(const std::string &name)
+{
+   if (name.empty() || name.length() > CUE_LIST_NAME_MAX_LENGTH || !isalpha((unsigned char)name[0]))
+      return false;
+
+   for (size_t i = 0; i < name.length(); i++)
+      if (!isalnum((unsigned char)name[i]) && name[i] != '-' && name[i] != '_')
+         return false;
+
+   return true;
+}
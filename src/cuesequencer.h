@@ -0,0 +1,159 @@
+/*
+ * Filename: cuesequencer.h
+ * Description: interface for the CueSequencer class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <algorithm>
+
+#include "commandqueue.h"
+#include "effects.h"
+#include "logger.h"
+
+#define CUE_LISTS_MAX 16 // Cue lists that can be loaded at the same time
+#define CUE_LIST_NAME_MAX_LENGTH 31
+#define CUE_EVENTS_MAX 4096 // Events in a single cue list
+#define CUE_LIST_FILE_EXTENSION ".cue"
+
+// Events of a cue list
+#define CUE_EVENT_FADE 0         // Fades channels, from on, off and scene_recall
+#define CUE_EVENT_EFFECT_START 1 // Starts an effect, from fxstart
+#define CUE_EVENT_EFFECT_STOP 2  // Stops an effect, from fxstop
+
+// Playback states of a cue list
+#define CUE_STATE_STOPPED 0
+#define CUE_STATE_PLAYING 1
+#define CUE_STATE_PAUSED 2
+
+// Transport changes, applied by the rendering thread
+#define CUE_COMMAND_SET 0    // Load a new version of the cue list
+#define CUE_COMMAND_REMOVE 1 // Stop and forget the cue list
+#define CUE_COMMAND_GO 2     // Play from the current position
+#define CUE_COMMAND_PAUSE 3  // Hold the current position
+#define CUE_COMMAND_STOP 4   // Stop and rewind to the start
+#define CUE_COMMAND_SEEK 5   // Move to a position, playing on if playing
+
+struct CueEvent
+{
+   int time;                           // ms from the start of the cue list
+   int type;                           // CUE_EVENT_*
+   bool sets_brightness;               // Channels turned off take the brightness in their command, for scenes
+   std::vector<int> channels;          // Channels of CUE_EVENT_FADE
+   std::vector<LightCommand> commands; // Command for each channel
+   int effect;                         // Effect id of CUE_EVENT_EFFECT_*
+   EffectParameters effect_parameters; // Effect started by CUE_EVENT_EFFECT_START
+};
+
+// Cue list as compiled by the TCPServer, never changed once loaded
+struct CueList
+{
+   std::vector<CueEvent> events; // Sorted by time
+   int length = 0;               // ms, time of the last event
+};
+
+// Fade event fired by the rendering thread, for the TCPServer to update outward states
+struct FiredCue
+{
+   std::shared_ptr<const CueList> list;
+   size_t event;
+};
+
+struct CueCommand
+{
+   int type; // CUE_COMMAND_*
+   int list;
+   std::shared_ptr<const CueList> events;
+   int position; // ms, for CUE_COMMAND_GO and CUE_COMMAND_SEEK
+};
+
+class TCPServer;
+
+bool is_valid_cue_list_name(const std::string &name);
+
+/*
+ * Definition of the CueSequencer class
+ *
+ * Plays cue lists, timelines of fades and effects compiled by the
+ * TCPServer, from the rendering thread. Every frame the events of all
+ * playing cue lists that are due are fired before commands are applied,
+ * so they take effect on the first frame at or after their time. Cue
+ * lists are loaded and controlled by the TCPServer only, which is told
+ * of fired fades to keep outward states up to date
+ */
+class CueSequencer
+{
+public:
+   // Methods
+   bool set_list(const std::string &name, std::shared_ptr<const CueList> list);
+   std::shared_ptr<const CueList> find_list(const std::string &name);
+   bool remove_list(const std::string &name);
+   bool go(const std::string &name);
+   bool pause(const std::string &name);
+   bool stop(const std::string &name);
+   bool seek(const std::string &name, int position);
+   bool get_status(const std::string &name, int &state, int &position);
+   void take_fired(std::vector<FiredCue> &fired);
+   void set_command_queue(CommandQueue &command_queue);
+   void set_effects_engine(EffectsEngine &effects);
+   void set_tcp_server(TCPServer &tcp_server);
+   void render(std::chrono::steady_clock::time_point now);
+
+private:
+   // Cue lists known to the TCPServer, with the playback it expects
+   struct CueListStatus
+   {
+      int id;
+      std::shared_ptr<const CueList> list;
+      int state = CUE_STATE_STOPPED;
+      int position = 0;                             // ms, while stopped or paused
+      std::chrono::steady_clock::time_point origin; // When position 0 was, while playing
+   };
+   std::map<std::string, CueListStatus> lists;
+
+   // Changes requested since last frame, taken by the rendering thread
+   std::mutex lock;
+   std::vector<CueCommand> pending, applying;
+   std::atomic<bool> has_pending{false};
+
+   // Fade events fired since the TCPServer last took them
+   std::mutex fired_lock;
+   std::vector<FiredCue> fired;
+
+   // Playback of each cue list, only used by the rendering thread
+   struct CuePlayback
+   {
+      std::shared_ptr<const CueList> list;
+      int state = CUE_STATE_STOPPED;
+      int position = 0;                             // ms, while stopped or paused
+      std::chrono::steady_clock::time_point origin; // When position 0 was, while playing
+      int fired_until = -1;                         // ms, events up to this time have fired
+      size_t next_event = 0;                        // First event not fired yet
+   };
+   CuePlayback playbacks[CUE_LISTS_MAX];
+   int playing = 0; // Cue lists playing, nothing to do while 0
+
+   // Commands of the fade being fired
+   LightCommand commands[512];
+
+   CommandQueue *command_queue = NULL;
+   EffectsEngine *effects = NULL;
+   TCPServer *tcp_server = NULL;
+
+   // Internal functions
+   CueListStatus *find_status(const std::string &name);
+   void queue(int type, int list, std::shared_ptr<const CueList> events, int position);
+   void apply_pending(std::chrono::steady_clock::time_point now);
+   void seek_playback(CuePlayback &playback, int position, std::chrono::steady_clock::time_point now);
+   bool fire(CuePlayback &playback, std::chrono::steady_clock::time_point now);
+};
@@ -16,7 +16,7 @@
  */
 bool DMXSender::start()
 {
-  logger("[DMX] Initializing with " + std::to_string(channels) + " channels...", LOG_INFO, true);
+  LOGGER_DEBUG("[DMX] Initializing with " + std::to_string(channels) + " channels...", LOG_INFO);
 
   // Instantiate FTDI library
   if ((ftdi = ftdi_new()) == 0)
@@ -25,6 +25,21 @@ bool DMXSender::start()
     return false;
   }
 
+  // Connect right away on the event loop
+  if (event_loop)
+  {
+    if ((connection_timer = create_timer()) < 0 ||
+        !arm_timer(connection_timer, 1, false) ||
+        !event_loop->add(connection_timer, EPOLLIN, this))
+    {
+      logger("[DMX] Error setting up connection timer!", LOG_ERR, false);
+      ftdi_free(ftdi);
+      return false;
+    }
+
+    return true;
+  }
+
   // Start the connection manager
   connection_manager_thread = std::thread(&DMXSender::manage_connection, this);
 
@@ -36,8 +51,9 @@ bool DMXSender::start()
  * Parameters:
  *  - unsigned char *dmx_frame: Array of values for each of the 512 channels
  *                        in a DMX universe
+ * Returns: true if the frame was written to the FTDI chip
  */
-void DMXSender::send_frame(unsigned char *dmx_frame)
+bool DMXSender::send_frame(unsigned char *dmx_frame)
 {
   if (can_send)
   {
@@ -48,14 +64,25 @@ void DMXSender::send_frame(unsigned char *dmx_frame)
         ftdi_write_data(ftdi, dmx_frame, channels) < 0)
     {
       logger("[DMX] Error sending DMX frame! Not ready to send!", LOG_WARN);
+      write_errors_counter->increment();
       // Tell the connection manager to stop waiting
       {
         std::lock_guard<std::mutex> lk(manager_mutex);
         can_send = false;
       }
       manager_cv.notify_all();
+
+      // Check the connection right away
+      if (event_loop)
+        arm_timer(connection_timer, 1, false);
+
+      return false;
     }
+
+    return true;
   }
+
+  return false;
 }
 
 /*
@@ -64,6 +91,15 @@ void DMXSender::send_frame(unsigned char *dmx_frame)
  */
 void DMXSender::stop()
 {
+  if (event_loop)
+  {
+    event_loop->remove(connection_timer);
+    close(connection_timer);
+    close_ftdi();
+    ftdi_free(ftdi);
+    return;
+  }
+
   // Tell the connection manager to stop waiting
   {
     std::lock_guard<std::mutex> lk(manager_mutex);
@@ -90,6 +126,40 @@ void DMXSender::configure(int channels)
     this->channels = DEFAULT_CHANNELS;
 }
 
+/*
+ * Give DMXSender access to the metrics registry and register its metrics
+ * Parameters:
+ *  - MetricsRegistry &metrics: reference to metrics registry
+ */
+void DMXSender::set_metrics(MetricsRegistry &metrics)
+{
+  write_errors_counter = &metrics.add_counter("lumize_usb_write_errors_total", "Failed writes of DMX frames to the FTDI chip");
+  reconnects_counter = &metrics.add_counter("lumize_usb_reconnects_total", "Succesful connections to the FTDI chip");
+  connected_gauge = &metrics.add_gauge("lumize_usb_connected", "1 if the FTDI chip is connected and ready to send");
+}
+
+/*
+ * Manage the connection on an event loop instead of a thread. Must be called before start()
+ * Parameters:
+ *  - EventLoop &event_loop: event loop of the single thread runtime
+ */
+void DMXSender::set_event_loop(EventLoop &event_loop)
+{
+  this->event_loop = &event_loop;
+}
+
+/*
+ * Checks the connection when the connection timer expires
+ * Parameters:
+ *  - int fd: file descriptor with events
+ *  - uint32_t events: EPOLL* events
+ */
+void DMXSender::handle_event(int fd, uint32_t events)
+{
+  if (read_timer(connection_timer) > 0)
+    arm_timer(connection_timer, check_connection() * 1000L, false);
+}
+
 /*
  ********** PRIVATE FUNCTIONS **********
  */
@@ -176,24 +246,7 @@ void DMXSender::manage_connection()
   {
     std::unique_lock<std::mutex> lk(manager_mutex);
 
-    // If we think we are connected, check the connection
-    if (can_send)
-      if (!check_ftdi_connection())
-        can_send = false;
-
-    // If not, try to connect
-    if (!can_send)
-    {
-      if (reconnect())
-      {
-        can_send = true;
-        logger("[DMX] USB connection to FTDI chip enstablished. Ready to send!", LOG_SUCC);
-      }
-      else
-        logger("[DMX] Unable to connect to FTDI device, retrying in a few seconds...", LOG_WARN);
-    }
-
-    manager_cv.wait_for(lk, std::chrono::milliseconds(2000));
+    manager_cv.wait_for(lk, std::chrono::milliseconds(check_connection()));
   }
 
   // Close connection to FTDI chip
@@ -202,3 +255,45 @@ void DMXSender::manage_connection()
   // Free FTDI context
   ftdi_free(ftdi);
 }
+
+/*
+ * Checks the connection to the FTDI chip and tries to connect if it's down
+ * Returns: ms to wait before the next check
+ */
+int DMXSender::check_connection()
+{
+  int delay;
+
+  // If we think we are connected, check the connection
+  if (can_send)
+    if (!check_ftdi_connection())
+      can_send = false;
+
+  connected_gauge->set(can_send);
+
+  // If not, try to connect
+  if (!can_send)
+  {
+    if (reconnect())
+    {
+      can_send = true;
+      retry_delay = RECONNECT_INITIAL_DELAY;
+      connected_gauge->set(1);
+      reconnects_counter->increment();
+      logger("[DMX] USB connection to FTDI chip enstablished. Ready to send!", LOG_SUCC);
+    }
+    else
+    {
+      // Don't flood the log while retrying quickly
+      if (retry_delay == RECONNECT_INITIAL_DELAY || retry_delay == RECONNECT_MAX_DELAY)
+        logger("[DMX] Unable to connect to FTDI device, retrying in " + std::to_string(retry_delay) + " ms...", LOG_WARN);
+
+      // Retry fast at first, then back off exponentially
+      delay = retry_delay;
+      retry_delay = std::min(retry_delay * 2, RECONNECT_MAX_DELAY);
+      return delay;
+    }
+  }
+
+  return CONNECTION_CHECK_INTERVAL;
+}
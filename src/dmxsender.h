@@ -10,6 +10,8 @@
 #include <thread>
 #include <chrono>
 #include <condition_variable>
+#include <atomic>
+#include <algorithm>
 
 // libFTDi
 #include <libftdi1/ftdi.h>
@@ -17,31 +19,51 @@
 // logger helper
 #include "logger.h"
 
+#include "metrics.h"
+#include "eventloop.h"
+
 #define DEFAULT_CHANNELS 24
 
+// Connection manager timing
+#define RECONNECT_INITIAL_DELAY 50     // ms, first retry after a failed connection attempt
+#define RECONNECT_MAX_DELAY 2000       // ms, retry delay doubles up to this value
+#define CONNECTION_CHECK_INTERVAL 2000 // ms, between checks of an open connection
+
 /*
  * Definition of the DMXSender class
  */
-class DMXSender
+class DMXSender : public EventHandler
 {
 public:
   // Methods
   bool start();
-  void send_frame(unsigned char *dmx_frame);
+  bool send_frame(unsigned char *dmx_frame);
   void stop();
   void configure(int channels = DEFAULT_CHANNELS);
+  void set_metrics(MetricsRegistry &metrics);
+  void set_event_loop(EventLoop &event_loop);
+  void handle_event(int fd, uint32_t events);
 
 private:
   int channels;                          // Number of channels to output
   struct ftdi_context *ftdi;             // libFTDI FTDI context
   bool running = true;                   // Used to disconnect gracefully
-  bool can_send = false;                 // Bool representing current connection
-                                         // status to the FTDI chip
+  std::atomic<bool> can_send{false};     // Current connection status to the FTDI
+                                         // chip, read by the rendering thread
   std::thread connection_manager_thread; // Reference to the connection manager thread
   std::mutex manager_mutex;              // Mutex to be used with the condition variable
   std::condition_variable manager_cv;    // Condition variable to stop
                                          // the connection manager from waiting
   const unsigned char start_code = 0;
+  int retry_delay = RECONNECT_INITIAL_DELAY; // ms before the next connection attempt
+  EventLoop *event_loop = NULL;              // Connection is managed on the event loop
+  int connection_timer = -1;                 // instead of connection_manager_thread
+
+  // Metrics
+  Counter *write_errors_counter;
+  Counter *reconnects_counter;
+  Gauge *connected_gauge;
+
   // Internal functions
   bool open_ftdi();
   bool close_ftdi();
@@ -49,4 +71,5 @@ private:
   bool reconnect();
   bool check_ftdi_connection();
   void manage_connection();
+  int check_connection();
 };
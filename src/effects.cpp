@@ -0,0 +1,237 @@
+/*
+ * Filename: effects.cpp
+ * Description: implementation of the EffectsEngine class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "effects.h" // Include definition of class to be implemented
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Starts an effect, replacing the one running with the same id
+ * Parameters:
+ *  - int id: effect slot, 0 to EFFECTS_MAX - 1
+ *  - const EffectParameters &parameters: validated effect parameters
+ */
+void EffectsEngine::start_effect(int id, const EffectParameters &parameters)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   is_pending[id] = true;
+   pending_start[id] = true;
+   pending[id] = parameters;
+   has_pending.store(true, std::memory_order_release);
+}
+
+/*
+ * Stops an effect, its channels go back to the fade layer
+ * Parameters:
+ *  - int id: effect slot, 0 to EFFECTS_MAX - 1
+ */
+void EffectsEngine::stop_effect(int id)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   is_pending[id] = true;
+   pending_start[id] = false;
+   has_pending.store(true, std::memory_order_release);
+}
+
+/*
+ * Renders all running effects on top of the fade layer. Must only be
+ * called by the rendering thread, once per frame
+ * Parameters:
+ *  - double *levels: fade layer value of each of the 512 channels, updated in place
+ *  - int fps: frames per second, to advance effects in real time
+ */
+void EffectsEngine::render(double *levels, int fps)
+{
+   // Only take the lock when the TCPServer changed something
+   if (has_pending.load(std::memory_order_acquire))
+      apply_pending();
+
+   for (int id = 0; id < EFFECTS_MAX; id++)
+   {
+      RunningEffect &effect = effects[id];
+
+      if (!effect.active)
+         continue;
+
+      const EffectParameters &parameters = effect.parameters;
+      double *range = levels + parameters.first;
+      const float low = parameters.low, span = parameters.high - parameters.low;
+
+      generate(effect, fps);
+
+      // Blend into the fade layer. Straight loops over the range, so
+      // that the compiler can vectorize them
+      if (parameters.blend == EFFECT_BLEND_MULTIPLY)
+         for (int j = 0; j < parameters.count; j++)
+            range[j] = range[j] * (low + span * values[j]) / 255;
+      else
+         for (int j = 0; j < parameters.count; j++)
+            range[j] = std::max(range[j], (double)(low + span * values[j]));
+
+      // Advance to next frame
+      effect.phase += 1000.0 / ((double)parameters.period * fps);
+      effect.phase -= std::floor(effect.phase);
+   }
+}
+
+/*
+ * Give EffectsEngine access to the metrics registry and register its metrics
+ * Parameters:
+ *  - MetricsRegistry &metrics: reference to metrics registry
+ */
+void EffectsEngine::set_metrics(MetricsRegistry &metrics)
+{
+   active_gauge = &metrics.add_gauge("lumize_effects_active", "Effects currently running");
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+/*
+ * Starts and stops the effects requested since last frame
+ */
+void EffectsEngine::apply_pending()
+{
+   std::lock_guard<std::mutex> lk(lock);
+   int active = 0;
+
+   for (int id = 0; id < EFFECTS_MAX; id++)
+   {
+      if (is_pending[id])
+      {
+         RunningEffect &effect = effects[id];
+
+         effect.active = pending_start[id];
+         if (effect.active)
+         {
+            effect.parameters = pending[id];
+            effect.phase = 0;
+            effect.random_state = 2463534242u + id;
+            std::fill(effect.flicker, effect.flicker + 512, 1.0f);
+         }
+
+         is_pending[id] = false;
+      }
+
+      active += effects[id].active;
+   }
+
+   has_pending.store(false, std::memory_order_relaxed);
+   active_gauge->set(active);
+}
+
+/*
+ * Computes the output of an effect for the current frame into values
+ * Parameters:
+ *  - RunningEffect &effect: effect to compute
+ *  - int fps: frames per second
+ */
+void EffectsEngine::generate(RunningEffect &effect, int fps)
+{
+   const EffectParameters &parameters = effect.parameters;
+   const int count = parameters.count;
+   const double phase = effect.phase;
+
+   switch (parameters.type)
+   {
+   case EFFECT_CHASE:
+   {
+      // Lit block ends at head and moves towards higher channels
+      const int head = (int)(phase * count);
+
+      for (int j = 0; j < count; j++)
+         values[j] = (head - j + count) % count < parameters.width;
+      break;
+   }
+
+   case EFFECT_WAVE:
+   {
+      const float step = 2 * M_PI / parameters.width, offset = 2 * M_PI * phase;
+
+      for (int j = 0; j < count; j++)
+         values[j] = 0.5f + 0.5f * std::sin(offset - step * j);
+      break;
+   }
+
+   case EFFECT_PULSE:
+   {
+      // Starts from the bottom of the cycle
+      const float value = 0.5f - 0.5f * std::cos(2 * M_PI * phase);
+
+      std::fill(values, values + count, value);
+      break;
+   }
+
+   case EFFECT_FLICKER:
+   {
+      // Exponential smoothing towards a new random target every frame
+      const float smoothing = std::min(1.0, 1000.0 / ((double)parameters.period * fps));
+
+      for (int j = 0; j < count; j++)
+      {
+         uint32_t x = effect.random_state;
+         float random;
+
+         x ^= x << 13;
+         x ^= x >> 17;
+         x ^= x << 5;
+         effect.random_state = x;
+
+         // Mostly bright, with occasional deep dips
+         random = (x >> 8) * (1.0f / 16777216.0f);
+         effect.flicker[j] += (1 - random * random * random - effect.flicker[j]) * smoothing;
+         values[j] = effect.flicker[j];
+      }
+      break;
+   }
+
+   case EFFECT_RAINBOW:
+   {
+      // Every three channels are an RGB pixel, hue spread over the pixels
+      const int pixels = count / 3;
+      const float offsets[3] = {0, 2.0f / 3, 1.0f / 3};
+
+      for (int j = 0; j < pixels * 3; j++)
+      {
+         float hue = phase + (float)(j / 3) / pixels + offsets[j % 3];
+
+         hue -= std::floor(hue);
+         values[j] = std::min(1.0f, std::max(0.0f, std::fabs(6 * hue - 3) - 1));
+      }
+
+      // Channels left over don't make up a pixel
+      std::fill(values + pixels * 3, values + count, 0.0f);
+      break;
+   }
+   }
+}
+
+/*
+ ********** HELPER FUNCTIONS **********
+ */
+
+/*
+ * Gets an effect generator from its name
+ * Parameters:
+ *  - const std::string &name: name used in the fxstart command
+ * Returns: EFFECT_* type, -1 if unknown
+ */
+int effect_type_from_name(const std::string &name)
+{
+   const char *names[] = {EFFECT_NAMES};
+
+   for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+      if (name == names[i])
+         return i;
+
+   return -1;
+}
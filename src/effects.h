@@ -0,0 +1,90 @@
+/*
+ * Filename: effects.h
+ * Description: interface for the EffectsEngine class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "metrics.h"
+
+#define EFFECTS_MAX 16 // Effects that can run at the same time
+
+// Effect generators
+#define EFFECT_CHASE 0   // Block of channels moving along the range
+#define EFFECT_WAVE 1    // Sine wave travelling along the range
+#define EFFECT_PULSE 2   // All channels breathing together
+#define EFFECT_FLICKER 3 // Independent candle-like flicker on every channel
+#define EFFECT_RAINBOW 4 // Hue cycle across RGB channel triplets
+#define EFFECT_NAMES "chase", "wave", "pulse", "flicker", "rainbow"
+
+// How effect output is combined with the fade layer
+#define EFFECT_BLEND_HTP 0      // Highest value takes precedence
+#define EFFECT_BLEND_MULTIPLY 1 // Effect scales the fade level
+
+// Parameters of an effect, as given in the fxstart command
+struct EffectParameters
+{
+   int type;   // EFFECT_*
+   int first;  // First channel of the range
+   int count;  // Channels in the range
+   int period; // ms per cycle, smoothing time for EFFECT_FLICKER
+   int low;    // Brightness at the bottom of the cycle
+   int high;   // Brightness at the top of the cycle
+   int width;  // Lit channels of EFFECT_CHASE, wavelength in channels of EFFECT_WAVE
+   int blend;  // EFFECT_BLEND_*
+};
+
+int effect_type_from_name(const std::string &name);
+
+/*
+ * Definition of the EffectsEngine class
+ *
+ * Effects are started and stopped from any thread and rendered by the
+ * LightRenderer every frame over their channel range, on top of the
+ * fade layer and before brightness limits are applied
+ */
+class EffectsEngine
+{
+public:
+   // Methods
+   void start_effect(int id, const EffectParameters &parameters);
+   void stop_effect(int id);
+   void render(double *levels, int fps);
+   void set_metrics(MetricsRegistry &metrics);
+
+private:
+   // Latest change requested for each effect, taken by the rendering thread
+   std::mutex lock;
+   bool is_pending[EFFECTS_MAX] = {};
+   bool pending_start[EFFECTS_MAX];
+   EffectParameters pending[EFFECTS_MAX];
+   std::atomic<bool> has_pending{false};
+
+   // Effects state, only used by the rendering thread
+   struct RunningEffect
+   {
+      bool active = false;
+      EffectParameters parameters;
+      double phase;           // Position in the cycle, 0-1
+      uint32_t random_state;  // xorshift32 state of EFFECT_FLICKER
+      float flicker[512];     // Smoothed flicker of each channel
+   };
+   RunningEffect effects[EFFECTS_MAX];
+   float values[512]; // Output of the generator being rendered, 0-1
+
+   // Metrics
+   Gauge *active_gauge;
+
+   // Internal functions
+   void apply_pending();
+   void generate(RunningEffect &effect, int fps);
+};
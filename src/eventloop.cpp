@@ -0,0 +1,166 @@
+/*
+ * Filename: eventloop.cpp
+ * Description: implementation of the EventLoop class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "eventloop.h" // Include definition of class to be implemented
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Closes the epoll instance
+ */
+EventLoop::~EventLoop()
+{
+   if (epoll_fd >= 0)
+      close(epoll_fd);
+}
+
+/*
+ * Creates the epoll instance
+ * Returns: true if succesful
+ */
+bool EventLoop::start()
+{
+   if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+   {
+      logger("[LOOP] Error on epoll_create1() system call!", LOG_ERR, false);
+      return false;
+   }
+
+   LOGGER_DEBUG("[LOOP] Single thread runtime started", LOG_INFO);
+   return true;
+}
+
+/*
+ * Starts watching a file descriptor
+ * Parameters:
+ *  - int fd: file descriptor
+ *  - uint32_t events: EPOLL* events to watch for
+ *  - EventHandler *handler: module to dispatch the events to
+ * Returns: true if succesful
+ */
+bool EventLoop::add(int fd, uint32_t events, EventHandler *handler)
+{
+   struct epoll_event event;
+
+   event.events = events;
+   event.data.fd = fd;
+
+   if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+   {
+      LOGGER_DEBUG("[LOOP] Error adding file descriptor " + std::to_string(fd), LOG_WARN);
+      return false;
+   }
+
+   handlers[fd] = handler;
+   return true;
+}
+
+/*
+ * Changes the events watched for a file descriptor
+ * Parameters:
+ *  - int fd: file descriptor, already added
+ *  - uint32_t events: EPOLL* events to watch for
+ * Returns: true if succesful
+ */
+bool EventLoop::modify(int fd, uint32_t events)
+{
+   struct epoll_event event;
+
+   event.events = events;
+   event.data.fd = fd;
+
+   return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+/*
+ * Stops watching a file descriptor. Must be called before closing it
+ * Parameters:
+ *  - int fd: file descriptor
+ */
+void EventLoop::remove(int fd)
+{
+   epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+   handlers.erase(fd);
+}
+
+/*
+ * Dispatches events for the given time
+ * Parameters:
+ *  - int timeout: ms after which to return
+ */
+void EventLoop::run_for(int timeout)
+{
+   struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+   std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+   int remaining, count;
+
+   while ((remaining = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - std::chrono::steady_clock::now()).count()) > 0)
+   {
+      if ((count = epoll_wait(epoll_fd, events, EVENT_LOOP_MAX_EVENTS, remaining)) < 0)
+      {
+         if (errno != EINTR)
+            LOGGER_DEBUG("[LOOP] Error on epoll_wait()", LOG_WARN);
+         continue;
+      }
+
+      for (int i = 0; i < count; i++)
+      {
+         // File descriptor may have been removed by a previous handler
+         std::map<int, EventHandler *>::iterator handler = handlers.find(events[i].data.fd);
+
+         if (handler != handlers.end())
+            handler->second->handle_event(events[i].data.fd, events[i].events);
+      }
+   }
+}
+
+/*
+ * Creates a timer that can be watched by the EventLoop
+ * Returns: timer file descriptor, -1 if unsuccesful
+ */
+int create_timer()
+{
+   return timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+}
+
+/*
+ * Arms or disarms a timer
+ * Parameters:
+ *  - int timer_fd: timer file descriptor
+ *  - long interval: us after which the timer expires, 0 to disarm it
+ *  - bool periodic: keep expiring every interval
+ * Returns: true if succesful
+ */
+bool arm_timer(int timer_fd, long interval, bool periodic)
+{
+   struct itimerspec spec;
+
+   spec.it_value.tv_sec = interval / 1000000;
+   spec.it_value.tv_nsec = (interval % 1000000) * 1000;
+   spec.it_interval.tv_sec = periodic ? spec.it_value.tv_sec : 0;
+   spec.it_interval.tv_nsec = periodic ? spec.it_value.tv_nsec : 0;
+
+   return timerfd_settime(timer_fd, 0, &spec, NULL) == 0;
+}
+
+/*
+ * Acknowledges the expirations of a timer
+ * Parameters:
+ *  - int timer_fd: timer file descriptor
+ * Returns: times the timer expired since last read
+ */
+uint64_t read_timer(int timer_fd)
+{
+   uint64_t expirations = 0;
+
+   if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+      return 0;
+
+   return expirations;
+}
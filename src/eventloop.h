@@ -0,0 +1,60 @@
+/*
+ * Filename: eventloop.h
+ * Description: interface for the EventLoop class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <map>
+#include <chrono>
+#include <cstdint>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include "logger.h"
+
+#define EVENT_LOOP_MAX_EVENTS 32 // Events handled per epoll_wait()
+
+/*
+ * Interface of the modules that handle events of an EventLoop
+ */
+class EventHandler
+{
+public:
+   virtual ~EventHandler() {}
+   virtual void handle_event(int fd, uint32_t events) = 0;
+};
+
+/*
+ * Definition of the EventLoop class
+ *
+ * Runs the modules of the single thread runtime on the calling thread,
+ * dispatching readiness of their file descriptors (sockets, timerfds)
+ * to them
+ */
+class EventLoop
+{
+public:
+   // Destructor
+   ~EventLoop();
+
+   // Methods
+   bool start();
+   bool add(int fd, uint32_t events, EventHandler *handler);
+   bool modify(int fd, uint32_t events);
+   void remove(int fd);
+   void run_for(int timeout);
+
+private:
+   int epoll_fd = -1;
+   std::map<int, EventHandler *> handlers;
+};
+
+// timerfd helpers
+int create_timer();
+bool arm_timer(int timer_fd, long interval, bool periodic);
+uint64_t read_timer(int timer_fd);
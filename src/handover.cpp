@@ -0,0 +1,371 @@
+/*
+ * Filename: handover.cpp
+ * Description: implementation of the HandoverServer and HandoverClient classes
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "handover.h" // Include definition of class to be implemented
+
+/*
+ ********** HELPER FUNCTIONS **********
+ */
+
+/*
+ * Fills in the address of a Unix socket
+ * Parameters:
+ *  - struct sockaddr_un &address: address to fill in
+ *  - std::string socket_path: path of the socket
+ * Returns: true if the path fits in the address
+ */
+static bool make_socket_address(struct sockaddr_un &address, std::string socket_path)
+{
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+
+   if (socket_path.length() >= sizeof(address.sun_path))
+      return false;
+
+   strcpy(address.sun_path, socket_path.c_str());
+   return true;
+}
+
+/*
+ * Sets send and receive timeouts on a socket
+ * Parameters:
+ *  - int socketfd: socket
+ */
+static void set_handover_timeout(int socketfd)
+{
+   struct timeval timeout;
+
+   timeout.tv_sec = HANDOVER_TIMEOUT;
+   timeout.tv_usec = 0;
+   setsockopt(socketfd, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
+   setsockopt(socketfd, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeout, sizeof(timeout));
+}
+
+/*
+ * Sends a single byte message
+ * Parameters:
+ *  - int socketfd: socket
+ *  - char message: HANDOVER_MESSAGE_*
+ * Returns: true if succesful
+ */
+static bool send_handover_message(int socketfd, char message)
+{
+   return send(socketfd, &message, 1, 0) == 1;
+}
+
+/*
+ * Waits for a single byte message
+ * Parameters:
+ *  - int socketfd: socket
+ *  - char message: expected HANDOVER_MESSAGE_*
+ * Returns: true if the expected message was received
+ */
+static bool wait_handover_message(int socketfd, char message)
+{
+   char received;
+
+   if (recv(socketfd, &received, 1, 0) != 1)
+      return false;
+
+   return received == message;
+}
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Starts listening for a new process
+ * Returns: true if succesful
+ */
+bool HandoverServer::start()
+{
+   struct sockaddr_un address;
+
+   if (!make_socket_address(address, socket_path))
+   {
+      logger("[HANDOVER] Socket path is too long!", LOG_ERR, false);
+      return false;
+   }
+
+   if ((listen_socket = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+   {
+      logger("[HANDOVER] Error on socket() system call!", LOG_ERR, false);
+      return false;
+   }
+
+   // Remove socket left behind by a previous process
+   unlink(socket_path.c_str());
+
+   if (bind(listen_socket, (struct sockaddr *)&address, sizeof(address)) < 0)
+   {
+      logger("[HANDOVER] Error binding socket " + socket_path + "!", LOG_ERR, false);
+      close(listen_socket);
+      return false;
+   }
+
+   if (listen(listen_socket, 1) < 0)
+   {
+      logger("[HANDOVER] Error starting listen()!", LOG_ERR, false);
+      close(listen_socket);
+      return false;
+   }
+
+   requested = false;
+   running = true;
+   server_thread = std::thread(&HandoverServer::main_loop, this);
+
+   LOGGER_DEBUG("[HANDOVER] Waiting for takeover on " + socket_path, LOG_INFO);
+   return true;
+}
+
+/*
+ * Stops listening and closes the connection to the new process. The
+ * socket file is only removed if no handover happened, as it belongs
+ * to the new process otherwise
+ */
+void HandoverServer::stop()
+{
+   running = false;
+
+   if (server_thread.joinable())
+   {
+      // Wake up accept() in the server thread
+      shutdown(listen_socket, SHUT_RDWR);
+
+      server_thread.join();
+      close(listen_socket);
+
+      if (!requested)
+         unlink(socket_path.c_str());
+   }
+
+   if (peer_socket >= 0)
+   {
+      close(peer_socket);
+      peer_socket = -1;
+   }
+}
+
+/*
+ * Configure the handover server
+ * Parameters:
+ *  - std::string socket_path: path of the Unix socket
+ */
+void HandoverServer::configure(std::string socket_path)
+{
+   this->socket_path = socket_path;
+}
+
+/*
+ * Returns: true if a new process is waiting to take over
+ */
+bool HandoverServer::is_requested()
+{
+   return requested;
+}
+
+/*
+ * Sends the engine state and the socket file descriptors to the new process
+ * Parameters:
+ *  - const HandoverState &state: state to send, fd_count must be set
+ *  - const int *fds: file descriptors to pass
+ * Returns: true if succesful
+ */
+bool HandoverServer::send_state(const HandoverState &state, const int *fds)
+{
+   struct msghdr message;
+   struct iovec iov;
+   char control[CMSG_SPACE(sizeof(int) * HANDOVER_MAX_FDS)];
+   struct cmsghdr *cmsg;
+   const char *data = (const char *)&state;
+   size_t sent;
+   ssize_t result;
+
+   memset(&message, 0, sizeof(message));
+   memset(control, 0, sizeof(control));
+
+   iov.iov_base = (void *)data;
+   iov.iov_len = sizeof(state);
+   message.msg_iov = &iov;
+   message.msg_iovlen = 1;
+
+   // File descriptors travel with the first bytes of the state
+   message.msg_control = control;
+   message.msg_controllen = CMSG_SPACE(sizeof(int) * state.fd_count);
+   cmsg = CMSG_FIRSTHDR(&message);
+   cmsg->cmsg_level = SOL_SOCKET;
+   cmsg->cmsg_type = SCM_RIGHTS;
+   cmsg->cmsg_len = CMSG_LEN(sizeof(int) * state.fd_count);
+   memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * state.fd_count);
+
+   if ((result = sendmsg(peer_socket, &message, 0)) <= 0)
+      return false;
+
+   // Send the rest of the state
+   for (sent = result; sent < sizeof(state); sent += result)
+      if ((result = send(peer_socket, data + sent, sizeof(state) - sent, 0)) <= 0)
+         return false;
+
+   return true;
+}
+
+/*
+ * Waits for a message from the new process
+ * Parameters:
+ *  - char message: expected HANDOVER_MESSAGE_*
+ * Returns: true if the expected message was received
+ */
+bool HandoverServer::wait_message(char message)
+{
+   return wait_handover_message(peer_socket, message);
+}
+
+/*
+ * Sends a message to the new process
+ * Parameters:
+ *  - char message: HANDOVER_MESSAGE_*
+ * Returns: true if succesful
+ */
+bool HandoverServer::send_message(char message)
+{
+   return send_handover_message(peer_socket, message);
+}
+
+/*
+ * Closes the connection to the running process
+ */
+HandoverClient::~HandoverClient()
+{
+   if (socketfd >= 0)
+      close(socketfd);
+}
+
+/*
+ * Connects to the running process
+ * Parameters:
+ *  - std::string socket_path: path of the Unix socket
+ * Returns: true if succesful
+ */
+bool HandoverClient::connect_to(std::string socket_path)
+{
+   struct sockaddr_un address;
+
+   if (!make_socket_address(address, socket_path))
+      return false;
+
+   if ((socketfd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+      return false;
+
+   if (connect(socketfd, (struct sockaddr *)&address, sizeof(address)) < 0)
+      return false;
+
+   set_handover_timeout(socketfd);
+
+   return true;
+}
+
+/*
+ * Receives the engine state and the socket file descriptors
+ * Parameters:
+ *  - HandoverState &state: where to store the state
+ *  - int *fds: array of HANDOVER_MAX_FDS where to store the file descriptors
+ * Returns: true if succesful
+ */
+bool HandoverClient::receive_state(HandoverState &state, int *fds)
+{
+   struct msghdr message;
+   struct iovec iov;
+   char control[CMSG_SPACE(sizeof(int) * HANDOVER_MAX_FDS)];
+   struct cmsghdr *cmsg;
+   char *data = (char *)&state;
+   size_t received;
+   ssize_t result;
+   int fd_count = 0;
+
+   memset(&message, 0, sizeof(message));
+
+   iov.iov_base = data;
+   iov.iov_len = sizeof(state);
+   message.msg_iov = &iov;
+   message.msg_iovlen = 1;
+   message.msg_control = control;
+   message.msg_controllen = sizeof(control);
+
+   if ((result = recvmsg(socketfd, &message, 0)) <= 0)
+      return false;
+
+   // Take file descriptors
+   for (cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg))
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+      {
+         fd_count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+         memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * fd_count);
+      }
+
+   // Receive the rest of the state
+   for (received = result; received < sizeof(state); received += result)
+      if ((result = recv(socketfd, data + received, sizeof(state) - received, 0)) <= 0)
+         return false;
+
+   if (state.magic != HANDOVER_MAGIC || state.version != HANDOVER_VERSION || state.fd_count != fd_count || fd_count < 1)
+   {
+      logger("[HANDOVER] Running process is a different version of Lumize DMX Engine!", LOG_ERR, false);
+      return false;
+   }
+
+   return true;
+}
+
+/*
+ * Waits for a message from the running process
+ * Parameters:
+ *  - char message: expected HANDOVER_MESSAGE_*
+ * Returns: true if the expected message was received
+ */
+bool HandoverClient::wait_message(char message)
+{
+   return wait_handover_message(socketfd, message);
+}
+
+/*
+ * Sends a message to the running process
+ * Parameters:
+ *  - char message: HANDOVER_MESSAGE_*
+ * Returns: true if succesful
+ */
+bool HandoverClient::send_message(char message)
+{
+   return send_handover_message(socketfd, message);
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+/*
+ * Waits for a single new process to connect
+ */
+void HandoverServer::main_loop()
+{
+   while (running)
+   {
+      int socketfd = accept(listen_socket, NULL, NULL);
+
+      if (socketfd < 0)
+      {
+         if (running && errno != EINTR)
+            LOGGER_DEBUG("[HANDOVER] Error accepting connection", LOG_WARN);
+         continue;
+      }
+
+      set_handover_timeout(socketfd);
+      peer_socket = socketfd;
+      requested = true;
+      return;
+   }
+}
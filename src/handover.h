@@ -0,0 +1,116 @@
+/*
+ * Filename: handover.h
+ * Description: interface for the HandoverServer and HandoverClient classes
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+// Unix domain sockets
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "persistency.h"
+#include "configreader.h"
+#include "logger.h"
+
+#define HANDOVER_MAGIC 0x48455A4C // "LZEH" in little endian
+#define HANDOVER_VERSION 2
+#define HANDOVER_MAX_FDS 16   // Listening socket and client sockets
+#define HANDOVER_MAX_SUBMASTERS 128
+#define HANDOVER_TIMEOUT 10   // s, max wait for the other process
+
+// Messages exchanged after the state has been sent
+#define HANDOVER_MESSAGE_READY 'R'    // New process: sockets and state taken over
+#define HANDOVER_MESSAGE_RELEASED 'D' // Old process: FTDI chip and ports released
+
+// Level of a submaster, by group name
+struct HandoverSubmaster
+{
+   char group[GROUP_NAME_MAX_LENGTH + 1];
+   double level;
+};
+
+// Masters, restored by the new process on its first frame
+struct HandoverMasters
+{
+   double grand_master;
+   uint8_t blackout;
+   uint8_t frozen;
+   uint16_t submaster_count;
+   HandoverSubmaster submasters[HANDOVER_MAX_SUBMASTERS];
+   uint8_t frozen_frame[512]; // Frame output while frozen
+};
+
+// State sent from the running process to the new one, along with
+// the socket file descriptors
+struct HandoverState
+{
+   uint32_t magic;
+   uint16_t version;
+   uint16_t fd_count; // First is the listening socket, then the clients
+   PersistencyChannelRecord channels[512];
+   HandoverMasters masters;
+};
+
+/*
+ * Definition of the HandoverServer class
+ *
+ * Listens on a Unix socket for a new engine process started with
+ * --takeover, and lets the running process hand over to it
+ */
+class HandoverServer
+{
+public:
+   // Methods
+   bool start();
+   void stop();
+   void configure(std::string socket_path);
+   bool is_requested();
+   bool send_state(const HandoverState &state, const int *fds);
+   bool wait_message(char message);
+   bool send_message(char message);
+
+private:
+   std::string socket_path;
+   int listen_socket = -1;
+   int peer_socket = -1;
+   std::atomic<bool> running{false};
+   std::atomic<bool> requested{false};
+   std::thread server_thread;
+
+   // Internal functions
+   void main_loop();
+};
+
+/*
+ * Definition of the HandoverClient class
+ *
+ * Used by a process started with --takeover to receive the state
+ * and sockets of the running engine
+ */
+class HandoverClient
+{
+public:
+   // Destructor
+   ~HandoverClient();
+
+   // Methods
+   bool connect_to(std::string socket_path);
+   bool receive_state(HandoverState &state, int *fds);
+   bool wait_message(char message);
+   bool send_message(char message);
+
+private:
+   int socketfd = -1;
+};
@@ -0,0 +1,125 @@
+/*
+ * Filename: histogram.cpp
+ * Description: implementation of the Histogram class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "histogram.h" // Include definition of class to be implemented
+
+// 1-2-5 series from 10us to 10s
+const unsigned long Histogram::bucket_bounds[HISTOGRAM_BUCKETS] = {
+    10, 20, 50,
+    100, 200, 500,
+    1000, 2000, 5000,
+    10000, 20000, 50000,
+    100000, 200000, 500000,
+    1000000, 2000000, 5000000,
+    10000000};
+
+/*
+ *********** CONSTRUCTOR **********
+ */
+Histogram::Histogram() : count(0), sum(0), max(0)
+{
+   for (int i = 0; i <= HISTOGRAM_BUCKETS; i++)
+      buckets[i].store(0, std::memory_order_relaxed);
+}
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Adds a value to the histogram
+ * Parameters:
+ *  - unsigned long value: value to record
+ */
+void Histogram::record(unsigned long value)
+{
+   int bucket = 0;
+
+   // Find bucket
+   while (bucket < HISTOGRAM_BUCKETS && value > bucket_bounds[bucket])
+      bucket++;
+
+   buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+   count.fetch_add(1, std::memory_order_relaxed);
+   sum.fetch_add(value, std::memory_order_relaxed);
+
+   // Update maximum
+   if (value > max.load(std::memory_order_relaxed))
+      max.store(value, std::memory_order_relaxed);
+}
+
+/*
+ * Returns: amount of recorded values
+ */
+unsigned long Histogram::get_count()
+{
+   return count.load(std::memory_order_relaxed);
+}
+
+/*
+ * Returns: sum of all recorded values
+ */
+unsigned long Histogram::get_sum()
+{
+   return sum.load(std::memory_order_relaxed);
+}
+
+/*
+ * Returns: biggest recorded value
+ */
+unsigned long Histogram::get_max()
+{
+   return max.load(std::memory_order_relaxed);
+}
+
+/*
+ * Gets the amount of values recorded in a bucket
+ * Parameters:
+ *  - int bucket: bucket index, HISTOGRAM_BUCKETS for the overflow bucket
+ * Returns: amount of values in the bucket (not cumulative)
+ */
+unsigned long Histogram::get_bucket_count(int bucket)
+{
+   return buckets[bucket].load(std::memory_order_relaxed);
+}
+
+/*
+ * Estimates a percentile by interpolating inside the bucket it falls in
+ * Parameters:
+ *  - double percentile: percentile to compute (0-100)
+ * Returns: estimated value, 0 if the histogram is empty
+ */
+unsigned long Histogram::get_percentile(double percentile)
+{
+   unsigned long total = get_count();
+   unsigned long max_value = get_max();
+   double rank, seen = 0;
+
+   if (total == 0)
+      return 0;
+
+   rank = total * percentile / 100;
+
+   for (int i = 0; i <= HISTOGRAM_BUCKETS; i++)
+   {
+      unsigned long in_bucket = get_bucket_count(i);
+
+      if (in_bucket > 0 && seen + in_bucket >= rank)
+      {
+         unsigned long lower = i == 0 ? 0 : bucket_bounds[i - 1];
+         unsigned long upper = i == HISTOGRAM_BUCKETS ? max_value : bucket_bounds[i];
+         unsigned long value = lower + (upper - lower) * ((rank - seen) / in_bucket);
+
+         // Interpolation can't go past the real maximum
+         return value < max_value ? value : max_value;
+      }
+
+      seen += in_bucket;
+   }
+
+   return max_value;
+}
@@ -0,0 +1,44 @@
+/*
+ * Filename: histogram.h
+ * Description: interface for the Histogram class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <atomic>
+
+// Amount of finite buckets
+#define HISTOGRAM_BUCKETS 19
+
+/*
+ * Definition of the Histogram class
+ *
+ * Fixed-bucket histogram of unsigned values (usually microseconds).
+ * Recording is wait-free, so it can be called from the rendering
+ * thread while other threads read the histogram. The maximum is
+ * exact as long as each histogram is recorded from a single thread.
+ */
+class Histogram
+{
+public:
+   // Constructor
+   Histogram();
+
+   // Upper bounds of the finite buckets
+   static const unsigned long bucket_bounds[HISTOGRAM_BUCKETS];
+
+   // Methods
+   void record(unsigned long value);
+   unsigned long get_count();
+   unsigned long get_sum();
+   unsigned long get_max();
+   unsigned long get_bucket_count(int bucket);
+   unsigned long get_percentile(double percentile);
+
+private:
+   // Last bucket collects values above the biggest bound
+   std::atomic<unsigned long> buckets[HISTOGRAM_BUCKETS + 1];
+   std::atomic<unsigned long> count, sum, max;
+};
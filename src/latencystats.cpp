@@ -0,0 +1,63 @@
+/*
+ * Filename: latencystats.cpp
+ * Description: implementation of latency statistics helpers
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "latencystats.h" // Include definition of functions to be implemented
+
+/*
+ * Formats p50, p99 and max of a histogram
+ * Parameters:
+ *  - Histogram &histogram: histogram to format
+ * Returns: "[p50]-[p99]-[max]"
+ */
+std::string histogram_summary_string(Histogram &histogram)
+{
+   return std::to_string(histogram.get_percentile(50)) + "-" +
+          std::to_string(histogram.get_percentile(99)) + "-" +
+          std::to_string(histogram.get_max());
+}
+
+/*
+ * Generates the latency statistics string sent to clients
+ * Parameters:
+ *  - LatencyStats &latency_stats: statistics to format
+ * Returns: "[receive->apply],[apply->render],[render->output]", each one
+ *    formatted as "[p50]-[p99]-[max]" in microseconds
+ */
+std::string latency_stats_string(LatencyStats &latency_stats)
+{
+   return histogram_summary_string(latency_stats.receive_to_apply) + "," +
+          histogram_summary_string(latency_stats.apply_to_render) + "," +
+          histogram_summary_string(latency_stats.render_to_output);
+}
+
+/*
+ * Logs a summary of a histogram
+ * Parameters:
+ *  - std::string name: name of the measured interval
+ *  - Histogram &histogram: histogram to summarize
+ */
+void log_histogram_summary(std::string name, Histogram &histogram)
+{
+   logger("        " + name + ": samples: " + std::to_string(histogram.get_count()) +
+              ", p50: " + std::to_string(histogram.get_percentile(50)) + "us" +
+              ", p99: " + std::to_string(histogram.get_percentile(99)) + "us" +
+              ", max: " + std::to_string(histogram.get_max()) + "us",
+          LOG_INFO, false);
+}
+
+/*
+ * Logs a summary of all latency statistics
+ * Parameters:
+ *  - LatencyStats &latency_stats: statistics to log
+ */
+void log_latency_stats(LatencyStats &latency_stats)
+{
+   logger("[LATENCY] Command latency statistics:", LOG_INFO, false);
+   log_histogram_summary("Receive -> apply", latency_stats.receive_to_apply);
+   log_histogram_summary("Apply -> render", latency_stats.apply_to_render);
+   log_histogram_summary("Render -> output", latency_stats.render_to_output);
+}
@@ -0,0 +1,24 @@
+/*
+ * Filename: latencystats.h
+ * Description: command to output latency statistics
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+
+#include "histogram.h"
+#include "logger.h"
+
+// Latency of commands through the engine, in microseconds
+struct LatencyStats
+{
+   Histogram receive_to_apply; // TCPServer received the command -> LightRenderer started the fade
+   Histogram apply_to_render;  // Fade started -> first frame reflecting it computed
+   Histogram render_to_output; // Frame computed -> frame written to the FTDI chip
+};
+
+std::string latency_stats_string(LatencyStats &latency_stats);
+void log_latency_stats(LatencyStats &latency_stats);
@@ -23,7 +23,26 @@ bool LightRenderer::start()
       return false;
    }
 
-   rendering_thread = std::thread(&LightRenderer::main_loop, this);
+   // Calculate total wait time between each frame
+   total_wait = 1000 / fps;
+
+   // Render on the event loop thread when a frame is due
+   if (event_loop)
+   {
+      prefault_stack();
+      realtime_gauge->set(setup_realtime_thread("Event loop", realtime_settings));
+
+      if ((frame_timer = create_timer()) < 0 ||
+          !arm_timer(frame_timer, 1000000 / fps, true) ||
+          !event_loop->add(frame_timer, EPOLLIN, this))
+      {
+         logger("[LIGHT] Error setting up frame timer!", LOG_ERR, false);
+         dmx_sender.stop();
+         return false;
+      }
+   }
+   else
+      rendering_thread = std::thread(&LightRenderer::main_loop, this);
 
    logger("[LIGHT] Light output started at " + std::to_string(fps) + " FPS!", LOG_SUCC, false);
    return true;
@@ -36,7 +55,13 @@ void LightRenderer::stop()
 {
    // Stop rendering thread
    running = false;
-   rendering_thread.join();
+   if (event_loop)
+   {
+      event_loop->remove(frame_timer);
+      close(frame_timer);
+   }
+   else
+      rendering_thread.join();
 
    // Stop DMX Sender
    dmx_sender.stop();
@@ -58,121 +83,405 @@ void LightRenderer::set_light_states(LightStates &light_states, std::timed_mutex
  * Parameters:
  *  - int fps: FPS to render at
  *  - BrightnessLimits brightness_limits: brightness limits of all lights
+ *  - const std::vector<int> *fine_channels: coarse channels of 16-bit lights
+ *  - const std::array<uint16_t, 512> *patch: channel output on each slot, NULL to output channels one to one
  *  - int channels: Amount of channels to output
  */
-void LightRenderer::configure(int fps, int channels, std::array<BrightnessLimits, 512> *brightness_limits, int pushbutton_fade_delta, int pushbutton_fade_pause)
+void LightRenderer::configure(int fps, int channels, const std::array<BrightnessLimits, 512> *brightness_limits, const std::vector<int> *fine_channels, const std::array<uint16_t, 512> *patch, int pushbutton_fade_delta, int pushbutton_fade_pause)
 {
    this->fps = fps;
    this->channels = channels;
    this->pushbutton_fade_delta_divided = (double)pushbutton_fade_delta / fps;
    this->pushbutton_fade_pause_frames = pushbutton_fade_pause * fps / 1000;
    this->brightness_limits = brightness_limits;
+   this->fine_channels = fine_channels;
+   this->patch = patch;
 
    // Configure DMXSender
    dmx_sender.configure(channels);
 }
 
 /*
- ********** PRIVATE FUNCTIONS **********
+ * Give LightRenderer access to the ConfigWatcher, to apply config changes
+ * Parameters:
+ *  - ConfigWatcher &config_watcher: reference to config watcher
  */
+void LightRenderer::set_config_watcher(ConfigWatcher &config_watcher)
+{
+   this->config_watcher = &config_watcher;
+   config_generation = config_watcher.get_generation();
+}
 
-void LightRenderer::main_loop()
+/*
+ * Give LightRenderer access to the EffectsEngine, to render effects every frame
+ * Parameters:
+ *  - EffectsEngine &effects: reference to effects engine
+ */
+void LightRenderer::set_effects_engine(EffectsEngine &effects)
 {
-   // Calculate total wait time between each frame
-   total_wait = 1000 / fps;
+   this->effects = &effects;
+}
 
-   while (running)
+/*
+ * Give LightRenderer access to the SourceMerger, to merge named sources every frame
+ * Parameters:
+ *  - SourceMerger &sources: reference to source merger
+ */
+void LightRenderer::set_source_merger(SourceMerger &sources)
+{
+   this->sources = &sources;
+}
+
+/*
+ * Give LightRenderer access to the MasterControls, to scale every frame
+ * Parameters:
+ *  - MasterControls &masters: reference to master controls
+ */
+void LightRenderer::set_master_controls(MasterControls &masters)
+{
+   this->masters = &masters;
+}
+
+/*
+ * Give LightRenderer access to the ColorFixtures, to fade fixtures every frame
+ * Parameters:
+ *  - ColorFixtures &fixtures: reference to color fixtures
+ */
+void LightRenderer::set_color_fixtures(ColorFixtures &fixtures)
+{
+   this->fixtures = &fixtures;
+}
+
+/*
+ * Give LightRenderer access to the CueSequencer, to fire cues every frame
+ * Parameters:
+ *  - CueSequencer &sequencer: reference to cue sequencer
+ */
+void LightRenderer::set_cue_sequencer(CueSequencer &sequencer)
+{
+   this->sequencer = &sequencer;
+}
+
+/*
+ * Copies the DMX frame being output. Must be called with the light
+ * states lock held, the frame is only written while holding it
+ * Parameters:
+ *  - unsigned char *frame: array of 512 elements to copy the frame into
+ */
+void LightRenderer::get_frame(unsigned char *frame)
+{
+   memcpy(frame, dmx_frame, 512);
+}
+
+/*
+ * Sets the DMX frame to output, kept while output is frozen. Must be
+ * called before the rendering thread is started
+ * Parameters:
+ *  - const unsigned char *frame: 512 values to output
+ */
+void LightRenderer::set_frame(const unsigned char *frame)
+{
+   memcpy(dmx_frame, frame, 512);
+}
+
+/*
+ * Give LightRenderer access to the ShmExporter, to export every frame
+ * Parameters:
+ *  - ShmExporter &shm_exporter: reference to shared memory exporter
+ */
+void LightRenderer::set_shm_exporter(ShmExporter &shm_exporter)
+{
+   this->shm_exporter = &shm_exporter;
+}
+
+/*
+ * Configure scheduling of the rendering thread. Must be called before start()
+ * Parameters:
+ *  - const RealtimeSettings &realtime_settings: scheduling policy, priority and CPU
+ */
+void LightRenderer::configure_realtime(const RealtimeSettings &realtime_settings)
+{
+   this->realtime_settings = realtime_settings;
+}
+
+/*
+ * Run the LightRenderer on an event loop instead of its own thread.
+ * Must be called before start()
+ * Parameters:
+ *  - EventLoop &event_loop: event loop of the single thread runtime
+ */
+void LightRenderer::set_event_loop(EventLoop &event_loop)
+{
+   this->event_loop = &event_loop;
+   dmx_sender.set_event_loop(event_loop);
+}
+
+/*
+ * Renders a frame when the frame timer expires
+ * Parameters:
+ *  - int fd: file descriptor with events
+ *  - uint32_t events: EPOLL* events
+ */
+void LightRenderer::handle_event(int fd, uint32_t events)
+{
+   // Frames missed because the loop was busy are not made up for
+   if (read_timer(frame_timer) > 0)
+      render_frame();
+}
+
+/*
+ * Give LightRenderer access to the queue of commands to apply
+ * Parameters:
+ *  - CommandQueue &command_queue: reference to command queue
+ */
+void LightRenderer::set_command_queue(CommandQueue &command_queue)
+{
+   this->command_queue = &command_queue;
+}
+
+/*
+ * Give LightRenderer access to the command latency statistics
+ * Parameters:
+ *  - LatencyStats &latency_stats: reference to latency statistics
+ */
+void LightRenderer::set_latency_stats(LatencyStats &latency_stats)
+{
+   this->latency_stats = &latency_stats;
+}
+
+/*
+ * Give LightRenderer access to the snapshot of fade states it publishes
+ * Parameters:
+ *  - FadeSnapshot &fade_snapshot: reference to fade snapshot
+ */
+void LightRenderer::set_fade_snapshot(FadeSnapshot &fade_snapshot)
+{
+   this->fade_snapshot = &fade_snapshot;
+}
+
+/*
+ * Give LightRenderer access to the PersistencyWriter, to notify it of fades
+ * starting and ending
+ * Parameters:
+ *  - PersistencyWriter &persistency_writer: reference to persistency writer
+ */
+void LightRenderer::set_persistency_writer(PersistencyWriter &persistency_writer)
+{
+   this->persistency_writer = &persistency_writer;
+}
+
+/*
+ * Give LightRenderer access to the metrics registry and register its metrics
+ * Parameters:
+ *  - MetricsRegistry &metrics: reference to metrics registry
+ */
+void LightRenderer::set_metrics(MetricsRegistry &metrics)
+{
+   frames_counter = &metrics.add_counter("lumize_frames_rendered_total", "DMX frames rendered");
+   frame_overruns_counter = &metrics.add_counter("lumize_frame_overruns_total", "Frames that took longer than the frame interval to render and send");
+   realtime_gauge = &metrics.add_gauge("lumize_render_realtime", "Whether the realtime settings of the rendering thread took effect");
+
+   dmx_sender.set_metrics(metrics);
+}
+
+/*
+ * Computes and sends a single DMX frame
+ */
+void LightRenderer::render_frame()
+{
+   bool commands_applied = false;
+
+   // Get render start time
+   render_begin_time = std::chrono::steady_clock::now();
+
+   // Acquire lock on light states
+   if (light_states_lock->try_lock_for(std::chrono::milliseconds(5)))
    {
-      // Get render start time
-      render_begin_time = std::chrono::steady_clock::now();
+      // Pick up the config published since last frame
+      apply_config_changes();
+
+      // Cues due by this frame queue their commands
+      if (sequencer)
+         sequencer->render(render_begin_time);
+
+      // Start fades for the commands received since last frame
+      commands_applied = apply_commands();
+
+      // Color fades write the channels of their fixtures
+      if (fixtures && fixtures->render(*light_states, fade_changed))
+         fades_changed = true;
 
-      // Acquire lock on light states
-      if (light_states_lock->try_lock_for(std::chrono::milliseconds(5)))
+      // If we were able to acquire the lock, compute new frame
+      for (int i = 0; i < 512; i++)
       {
-         // If we were able to acquire the lock, compute new frame
-         for (int i = 0; i < 512; i++)
+         double computation_value;
+
+         // No fade active
+         if (light_states->fade_delta[i] == 0)
+            computation_value = light_states->fade_current[i];
+         else
          {
-            double computation_value;
+            // Increment fade progress
+            light_states->fade_progress[i] += light_states->fade_delta[i];
 
-            // No fade active
-            if (light_states->fade_delta[i] == 0)
+            // If fade is finished
+            if (light_states->fade_progress[i] > 1)
+            {
+               light_states->fade_delta[i] = 0;
+               light_states->fade_progress[i] = 0;
+               light_states->fade_current[i] = light_states->fade_end[i];
                computation_value = light_states->fade_current[i];
+               fade_changed[i] = fades_changed = true;
+               LOGGER_DEBUG("[LIGHT] Fade finished, channel: " + std::to_string(i), LOG_INFO);
+            }
             else
             {
-               // Increment fade progress
-               light_states->fade_progress[i] += light_states->fade_delta[i];
-
-               // If fade is finished
-               if (light_states->fade_progress[i] > 1)
-               {
-                  light_states->fade_delta[i] = 0;
-                  light_states->fade_progress[i] = 0;
-                  light_states->fade_current[i] = light_states->fade_end[i];
-                  logger("[LIGHT] Fade finished, channel: " + std::to_string(i), LOG_INFO, true);
-               }
-               else
-               {
-                  // Compute light value
-                  light_states->fade_current[i] = (double)(light_states->fade_end[i] - light_states->fade_start[i]) * ease_in_out_sine(light_states->fade_progress[i]) + light_states->fade_start[i];
-                  computation_value = light_states->fade_current[i];
-               }
+               // Compute light value
+               light_states->fade_current[i] = (light_states->fade_end[i] - light_states->fade_start[i]) * ease_in_out_sine(light_states->fade_progress[i]) + light_states->fade_start[i];
+               computation_value = light_states->fade_current[i];
             }
+         }
 
-            // There is a pushbutton fade active
-            if (light_states->pushbutton_fade[i])
-            {
+         // Pushbutton fade was started or ended by the TCPServer
+         if (light_states->pushbutton_fade[i] != pushbutton_fade_active[i])
+         {
+            pushbutton_fade_active[i] = light_states->pushbutton_fade[i];
+            fade_changed[i] = fades_changed = true;
+            if (sources)
+               sources->mark_main_changed(i);
+            if (fixtures)
+               fixtures->mark_channel_changed(i);
+         }
 
-               // Calculate new value
-               if (light_states->pushbutton_fade_up[i])
-                  light_states->pushbutton_fade_current[i] += pushbutton_fade_delta_divided;
-               else
-                  light_states->pushbutton_fade_current[i] -= pushbutton_fade_delta_divided;
+         // There is a pushbutton fade active
+         if (light_states->pushbutton_fade[i])
+         {
 
-               // Check limits
-               if (light_states->pushbutton_fade_current[i] >= 255)
-               {
-                  // Pause stuff
-                  if (light_states->pushbutton_fade_pause_counter[i] < pushbutton_fade_pause_frames)
-                     light_states->pushbutton_fade_pause_counter[i]++;
-                  else
-                  {
-                     // Invert direction
-                     light_states->pushbutton_fade_up[i] = false;
-
-                     // Reset counter
-                     light_states->pushbutton_fade_pause_counter[i] = 0;
-                  }
-
-                  // Clean up value
-                  light_states->pushbutton_fade_current[i] = 255;
-               }
-               else if (light_states->pushbutton_fade_current[i] <= 0)
+            // Calculate new value
+            if (light_states->pushbutton_fade_up[i])
+               light_states->pushbutton_fade_current[i] += pushbutton_fade_delta_divided;
+            else
+               light_states->pushbutton_fade_current[i] -= pushbutton_fade_delta_divided;
+
+            // Check limits
+            if (light_states->pushbutton_fade_current[i] >= 255)
+            {
+               // Pause stuff
+               if (light_states->pushbutton_fade_pause_counter[i] < pushbutton_fade_pause_frames)
+                  light_states->pushbutton_fade_pause_counter[i]++;
+               else
                {
-                  light_states->pushbutton_fade_up[i] = true;
                   // Invert direction
-                  light_states->pushbutton_fade_current[i] = 0;
+                  light_states->pushbutton_fade_up[i] = false;
+
+                  // Reset counter
+                  light_states->pushbutton_fade_pause_counter[i] = 0;
                }
 
-               // Save new value into DMX frame
-               computation_value = light_states->pushbutton_fade_current[i];
+               // Clean up value
+               light_states->pushbutton_fade_current[i] = 255;
+            }
+            else if (light_states->pushbutton_fade_current[i] <= 0)
+            {
+               light_states->pushbutton_fade_up[i] = true;
+               // Invert direction
+               light_states->pushbutton_fade_current[i] = 0;
             }
 
-            // Save computed value into dmx frame
-            dmx_frame[i] = map_brightness_limits(computation_value, brightness_limits->at(i));
+            // Save new value into DMX frame
+            computation_value = light_states->pushbutton_fade_current[i];
          }
 
-         // std::cout << (int)dmx_frame[0] << std::endl;
-      };
+         // Save computed value into fade layer
+         levels[i] = computation_value;
+      }
+
+      // Merge named sources with the fade layer
+      if (sources)
+         sources->render(levels);
+
+      // Render effects on top of the fade layer
+      if (effects)
+         effects->render(levels, fps);
+
+      // Scale by the masters
+      if (masters)
+         masters->render(levels);
+
+      // Keep sending the last frame while output is frozen
+      if (!masters || !masters->is_frozen())
+      {
+         // Channels go straight into the dmx frame unless they're patched
+         unsigned char *output = patch ? channel_frame : dmx_frame;
+
+         // Save computed values into dmx frame
+         for (int i = 0; i < 512; i++)
+            output[i] = map_brightness_limits(levels[i], brightness_limits->at(i));
+
+         // 16-bit lights overwrite their coarse and fine bytes
+         for (size_t i = 0; i < fine_channels->size(); i++)
+         {
+            const int channel = (*fine_channels)[i];
+            const uint16_t value = map_brightness_limits_fine(levels[channel], brightness_limits->at(channel));
+
+            output[channel] = value >> 8;
+            output[channel + 1] = value & 0xFF;
+         }
+
+         // Gather the channel of every slot, unpatched slots read the 0 past the end
+         if (patch)
+            for (int i = 0; i < 512; i++)
+               dmx_frame[i] = channel_frame[(*patch)[i]];
+      }
+
+      // std::cout << (int)dmx_frame[0] << std::endl;
+
+      // Publish fades started or ended in this frame
+      if (fades_changed)
+         fade_snapshot->publish(*light_states);
 
       // Free lock
       light_states_lock->unlock();
 
-      // Send dmx frame
-      dmx_sender.send_frame(dmx_frame);
+      publish_fade_changes();
+   };
+
+   frame_computed_time = std::chrono::steady_clock::now();
+
+   // Track latency of the frame that first reflects new commands
+   if (commands_applied)
+      latency_stats->apply_to_render.record(std::chrono::duration_cast<std::chrono::microseconds>(frame_computed_time - commands_apply_time).count());
+
+   // Send dmx frame
+   if (dmx_sender.send_frame(dmx_frame) && commands_applied)
+      latency_stats->render_to_output.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - frame_computed_time).count());
+
+   // Export frame after sending it, so readers don't delay the output
+   if (shm_exporter)
+      shm_exporter->publish(dmx_frame, channels, fps);
 
-      // Get render end time
-      render_end_time = std::chrono::steady_clock::now();
-      wait_time = total_wait - std::chrono::duration_cast<std::chrono::milliseconds>(render_end_time - render_begin_time).count();
+   // Get render end time
+   render_end_time = std::chrono::steady_clock::now();
+   wait_time = total_wait - std::chrono::duration_cast<std::chrono::milliseconds>(render_end_time - render_begin_time).count();
+
+   frames_counter->increment();
+   if (wait_time < 0)
+      frame_overruns_counter->increment();
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+void LightRenderer::main_loop()
+{
+   // Map the stack pages the thread will use, then apply realtime settings
+   prefault_stack();
+   realtime_gauge->set(setup_realtime_thread("Render", realtime_settings));
+
+   while (running)
+   {
+      render_frame();
 
       // Wait correct amount of time
       std::this_thread::sleep_for(std::chrono::milliseconds(wait_time));
@@ -180,14 +489,103 @@ void LightRenderer::main_loop()
 }
 
 /*
- * Interpolates between with sine exponentiation
+ * Applies all commands queued since the last frame. Must be
+ * called with light_states_lock held
+ * Returns: true if at least one command was applied
+ */
+bool LightRenderer::apply_commands()
+{
+   int count = command_queue->drain(command_channels, commands);
+
+   commands_apply_time = std::chrono::steady_clock::now();
+
+   for (int i = 0; i < count; i++)
+   {
+      latency_stats->receive_to_apply.record(std::chrono::duration_cast<std::chrono::microseconds>(commands_apply_time - commands[i].received_time).count());
+      apply_command(command_channels[i], commands[i]);
+   }
+
+   return count > 0;
+}
+
+/*
+ * Applies the config published by the ConfigWatcher since the last
+ * frame. Must be called with light_states_lock held
+ */
+void LightRenderer::apply_config_changes()
+{
+   unsigned long generation = config_watcher->get_generation();
+
+   if (generation == config_generation)
+      return;
+
+   config_generation = generation;
+   config = config_watcher->get_config();
+
+   if (config->fps != fps)
+   {
+      // Fades in progress keep their duration
+      for (int i = 0; i < 512; i++)
+         light_states->fade_delta[i] = light_states->fade_delta[i] * fps / config->fps;
+
+      total_wait = 1000 / config->fps;
+      if (event_loop)
+         arm_timer(frame_timer, 1000000 / config->fps, true);
+      logger("[LIGHT] Light output now at " + std::to_string(config->fps) + " FPS", LOG_INFO, false);
+   }
+
+   configure(config->fps, config->channels, &config->brightness_limits, &config->fine_channels, config->has_patch ? &config->patch_table : NULL, config->pushbutton_fade_delta, config->pushbutton_fade_pause);
+   if (sources)
+      sources->configure(config->fps, &config->ltp_channels, config->main_source_priority);
+   if (masters)
+      masters->configure(config->fps, &config->groups);
+   if (fixtures)
+      fixtures->configure(config->fps, &config->fixtures);
+}
+
+/*
+ * Starts the fade requested by a command
  * Parameters:
- *  - double t: input
- * Returns: sine interpolation
+ *  - int channel: channel to fade
+ *  - const LightCommand &command: command to apply
  */
-double LightRenderer::ease_in_out_sine(double t)
+void LightRenderer::apply_command(int channel, const LightCommand &command)
 {
-   return 0.5 * (1 + sin(3.1415926 * (t - 0.5)));
+   // Set fade variables
+   light_states->fade_progress[channel] = 0;
+   light_states->fade_delta[channel] = 1000.0 / (fps * command.transition); // 1 / FPS * transition if transition was in seconds
+   light_states->fade_start[channel] = light_states->fade_current[channel];  // Start where last fade ended
+   light_states->fade_end[channel] = command.type == LIGHT_COMMAND_ON ? command.brightness : 0;
+   light_states->fade_duration[channel] = command.transition;
+   light_states->fade_start_time[channel] = std::chrono::system_clock::now();
+   fade_changed[channel] = fades_changed = true;
+   if (sources)
+      sources->mark_main_changed(channel);
+   if (fixtures)
+      fixtures->mark_channel_changed(channel);
+
+   LOGGER_DEBUG("[LIGHT] Starting fade, channel: " + std::to_string(channel) + ", start: " + std::to_string(light_states->fade_start[channel]) + ", end: " + std::to_string(light_states->fade_end[channel]) + ", delta: " + std::to_string(light_states->fade_delta[channel]), LOG_INFO);
+}
+
+/*
+ * Tells the PersistencyWriter which channels had a fade start or end,
+ * after the fade snapshot has been published
+ */
+void LightRenderer::publish_fade_changes()
+{
+   if (!fades_changed)
+      return;
+
+   for (int i = 0; i < 512; i++)
+   {
+      if (!fade_changed[i])
+         continue;
+
+      persistency_writer->mark_dirty(i);
+      fade_changed[i] = false;
+   }
+
+   fades_changed = false;
 }
 
 /*
@@ -207,4 +605,24 @@ unsigned char LightRenderer::map_brightness_limits(double value, BrightnessLimit
 
    // Compute mapped value
    return value * (brightness_limits.max - brightness_limits.min) / 255 + brightness_limits.min;
-}
\ No newline at end of file
+}
+
+/*
+ * Maps brightness between 0 and 255 to a 16-bit value within brightness
+ * limits, for lights that take a coarse and a fine byte
+ * Parameters:
+ *  - double value: value to map
+ *  - BrightnessLimits brightness_limits: brightness limits to use for the map
+ * Returns: mapped value, coarse byte first
+ */
+uint16_t LightRenderer::map_brightness_limits_fine(double value, BrightnessLimits brightness_limits)
+{
+   if (value <= 0)
+      return 0;
+
+   if (value >= 255)
+      return 65535;
+
+   // Compute mapped value, limits are on the coarse byte
+   return std::lround((value * (brightness_limits.max - brightness_limits.min) / 255 + brightness_limits.min) * 257);
+}
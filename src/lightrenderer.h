@@ -14,11 +14,27 @@
 #include <cmath>
 #include <mutex>
 #include <array>
+#include <condition_variable>
+#include <string.h>
 
 // DMX output
 #include "dmxsender.h"
 
 #include "lightstates.h"
+#include "commandqueue.h"
+#include "latencystats.h"
+#include "metrics.h"
+#include "statesnapshot.h"
+#include "persistency.h"
+#include "configwatcher.h"
+#include "realtime.h"
+#include "eventloop.h"
+#include "shmexport.h"
+#include "effects.h"
+#include "sourcemerger.h"
+#include "mastercontrols.h"
+#include "colorfixtures.h"
+#include "cuesequencer.h"
 
 #include "configreader.h"
 
@@ -30,37 +46,102 @@
 /*
  * Definition of the LightRenderer class
  */
-class LightRenderer
+class LightRenderer : public EventHandler
 {
 public:
    // Methods
    bool start();
    void stop();
    void set_light_states(LightStates &light_states, std::timed_mutex &light_states_lock);
-   void configure(int fps, int channels, std::array<BrightnessLimits, 512> *brightness_limits, int pushbutton_fade_delta, int pushbutton_fade_pause);
+   void configure(int fps, int channels, const std::array<BrightnessLimits, 512> *brightness_limits, const std::vector<int> *fine_channels, const std::array<uint16_t, 512> *patch, int pushbutton_fade_delta, int pushbutton_fade_pause);
+   void set_command_queue(CommandQueue &command_queue);
+   void set_latency_stats(LatencyStats &latency_stats);
+   void set_fade_snapshot(FadeSnapshot &fade_snapshot);
+   void set_persistency_writer(PersistencyWriter &persistency_writer);
+   void set_metrics(MetricsRegistry &metrics);
+   void set_config_watcher(ConfigWatcher &config_watcher);
+   void configure_realtime(const RealtimeSettings &realtime_settings);
+   void set_event_loop(EventLoop &event_loop);
+   void set_shm_exporter(ShmExporter &shm_exporter);
+   void set_effects_engine(EffectsEngine &effects);
+   void set_source_merger(SourceMerger &sources);
+   void set_master_controls(MasterControls &masters);
+   void set_color_fixtures(ColorFixtures &fixtures);
+   void set_cue_sequencer(CueSequencer &sequencer);
+   void get_frame(unsigned char *frame);
+   void set_frame(const unsigned char *frame);
+   void render_frame();
+   void handle_event(int fd, uint32_t events);
 
 private:
    DMXSender dmx_sender;
    LightStates *light_states;
    std::timed_mutex *light_states_lock;
+   CommandQueue *command_queue;
+   LatencyStats *latency_stats;
+   ShmExporter *shm_exporter = NULL; // Local readers of the live universe
+
+   // Fade states published for persistency
+   FadeSnapshot *fade_snapshot;
+   PersistencyWriter *persistency_writer;
+   bool fade_changed[512] = {};          // Fade started or ended in this frame
+   bool pushbutton_fade_active[512] = {}; // Pushbutton fade state seen in the last frame
+   bool fades_changed = false;
+
+   // Metrics
+   Counter *frames_counter;
+   Counter *frame_overruns_counter;
+   Gauge *realtime_gauge;
    unsigned char dmx_frame[512]; // DMX frame to be sent
+   unsigned char channel_frame[PATCH_UNPATCHED + 1] = {}; // Output of each channel before the patch, always 0 past the end
+   double levels[512];           // Channel values before brightness limits
+
+   // Named sources merged with the fades
+   SourceMerger *sources = NULL;
+
+   // Effects rendered on top of the fades
+   EffectsEngine *effects = NULL;
+
+   // Masters applied right before output
+   MasterControls *masters = NULL;
+
+   // Color fixtures faded into the fade layer
+   ColorFixtures *fixtures = NULL;
+
+   // Cue lists fired at the start of each frame
+   CueSequencer *sequencer = NULL;
+
+   // Commands taken from the queue for the current frame
+   int command_channels[512];
+   LightCommand commands[512];
    bool running = true;
    std::thread rendering_thread;
+   EventLoop *event_loop = NULL; // Frames are clocked by frame_timer instead of rendering_thread
+   int frame_timer = -1;
    int total_wait;
    std::chrono::steady_clock::time_point render_begin_time, render_end_time;
+   std::chrono::steady_clock::time_point commands_apply_time, frame_computed_time;
    int wait_time;
 
    // Config
    int fps, channels, pushbutton_fade_pause_frames;
    double pushbutton_fade_delta_divided;
-   std::array<BrightnessLimits, 512> *brightness_limits;
+   const std::array<BrightnessLimits, 512> *brightness_limits;
+   const std::vector<int> *fine_channels; // Coarse channels of 16-bit lights
+   const std::array<uint16_t, 512> *patch; // Channel output on each slot, NULL if not patched
+   ConfigWatcher *config_watcher;
+   RealtimeSettings realtime_settings; // Scheduling of the rendering thread
+   std::shared_ptr<const LumizeConfig> config; // Keeps brightness_limits alive after a reload
+   unsigned long config_generation = 0;        // Generation of the config in use
 
    // Internal functions
    void main_loop();
-
-   // Easing functions
-   double ease_in_out_sine(double t);
+   bool apply_commands();
+   void apply_command(int channel, const LightCommand &command);
+   void publish_fade_changes();
+   void apply_config_changes();
 
    // Mapping function
    unsigned char map_brightness_limits(double value, BrightnessLimits brightness_limits);
+   uint16_t map_brightness_limits_fine(double value, BrightnessLimits brightness_limits);
 };
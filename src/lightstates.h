@@ -9,19 +9,23 @@
 #pragma once
 
 #include <chrono>
+#include <cmath>
 
 struct LightStates
 {
    // Outward-facing states
    bool outward_state[512];
    int outward_brightness[512];
+   int outward_brightness_fine[512]; // 0-65535, for 16-bit lights
 
    // Fade states
    double fade_progress[512];
    double fade_delta[512];
-   int fade_start[512];
-   int fade_end[512];
-   int fade_current[512];
+   double fade_start[512]; // 0-255, kept fractional for 16-bit lights
+   double fade_end[512];
+   double fade_current[512];
+   int fade_duration[512];                                  // ms
+   std::chrono::system_clock::time_point fade_start_time[512]; // Wall clock, to resume fades after a restart
 
    // Pushbutton dimming states
    bool pushbutton_fade[512];
@@ -29,4 +33,29 @@ struct LightStates
    double pushbutton_fade_current[512];
    int pushbutton_fade_pause_counter[512];
    std::chrono::steady_clock::time_point pushbutton_fade_end_time[512];
-};
\ No newline at end of file
+};
+
+/*
+ * Interpolates between with sine exponentiation. Shared by all fades,
+ * so that they all follow the same curve
+ * Parameters:
+ *  - double t: input
+ * Returns: sine interpolation
+ */
+inline double ease_in_out_sine(double t)
+{
+   return 0.5 * (1 + sin(3.1415926 * (t - 0.5)));
+}
+
+/*
+ * Sets the outward brightness of a channel, at both resolutions
+ * Parameters:
+ *  - LightStates &light_states: light states to update
+ *  - int channel: channel to update
+ *  - double brightness: brightness between 0 and 255
+ */
+inline void set_outward_brightness(LightStates &light_states, int channel, double brightness)
+{
+   light_states.outward_brightness[channel] = std::lround(brightness);
+   light_states.outward_brightness_fine[channel] = std::lround(brightness * 257);
+}
@@ -1,4 +1,3 @@
-
 /*
  * Filename: logger.cpp
  * Description: implementation of the logger function
@@ -9,34 +8,188 @@
 #include "logger.h" // Include definition of function to be implemented
 
 // Enable debug mode
-bool global_enable_debug = false;
+std::atomic<bool> global_enable_debug(false);
+
+// Slot of the messages ring
+struct LogEntry
+{
+  std::atomic<size_t> sequence; // Position this slot is ready for
+  int log_level;
+  std::string message;
+};
+
+// Messages waiting to be written by the logger thread
+LogEntry log_ring[LOGGER_RING_SIZE];
+std::atomic<size_t> log_ring_enqueue_position(0);
+size_t log_ring_dequeue_position = 0; // Only used by the logger thread
+std::atomic<unsigned long> log_dropped_messages(0);
+
+// Logger thread
+std::atomic<bool> logger_running(false);
+std::thread logger_thread;
+
+/*
+ * Writes a message to the console
+ * Parameters:
+ * - int log_level: color of the message by type of log
+ * - const std::string &message: message to be written
+ */
+void write_log_message(int log_level, const std::string &message)
+{
+  // For each log level use a differnt color
+  switch (log_level)
+  {
+  case 1:
+    std::cout << "\u001b[32m" << message << "\u001b[0m\n";
+    break;
+  case 2:
+    std::cout << "\u001b[33m" << message << "\u001b[0m\n";
+    break;
+  case 3:
+    std::cout << "\u001b[31m" << message << "\u001b[0m\n";
+    break;
+  case 4:
+    std::cout << "\u001b[34m" << message << "\u001b[0m\n";
+    break;
+  default:
+    std::cout << message << "\n";
+    break;
+  }
+}
+
+/*
+ * Puts a message in the ring without locking
+ * Parameters:
+ * - std::string &message: message to be moved into the ring
+ * - int log_level: color of the message by type of log
+ * Returns: false if the ring is full
+ */
+bool enqueue_log_message(std::string &message, int log_level)
+{
+  size_t position = log_ring_enqueue_position.load(std::memory_order_relaxed);
+  LogEntry *entry;
+
+  // Claim a free slot
+  while (true)
+  {
+    entry = &log_ring[position & (LOGGER_RING_SIZE - 1)];
+    size_t sequence = entry->sequence.load(std::memory_order_acquire);
+    long difference = (long)sequence - (long)position;
+
+    if (difference == 0)
+    {
+      if (log_ring_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (difference < 0)
+      return false;
+    else
+      position = log_ring_enqueue_position.load(std::memory_order_relaxed);
+  }
+
+  entry->log_level = log_level;
+  entry->message.swap(message);
+
+  // Hand the slot over to the logger thread
+  entry->sequence.store(position + 1, std::memory_order_release);
+
+  return true;
+}
+
+/*
+ * Writes all messages currently in the ring
+ * Returns: amount of messages written
+ */
+int drain_log_ring()
+{
+  int written = 0;
+
+  while (true)
+  {
+    LogEntry *entry = &log_ring[log_ring_dequeue_position & (LOGGER_RING_SIZE - 1)];
+
+    // Next slot hasn't been filled yet
+    if (entry->sequence.load(std::memory_order_acquire) != log_ring_dequeue_position + 1)
+      break;
+
+    write_log_message(entry->log_level, entry->message);
+    entry->message.clear();
+
+    // Give the slot back to the producers
+    entry->sequence.store(log_ring_dequeue_position + LOGGER_RING_SIZE, std::memory_order_release);
+    log_ring_dequeue_position++;
+    written++;
+  }
+
+  return written;
+}
+
+/*
+ * Main loop of the logger thread
+ */
+void logger_main_loop()
+{
+  while (logger_running.load(std::memory_order_relaxed))
+  {
+    int written = drain_log_ring();
+
+    // Report messages lost because the ring was full
+    unsigned long dropped = log_dropped_messages.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+      write_log_message(LOG_WARN, "[LOGGER] " + std::to_string(dropped) + " messages dropped");
+
+    if (written > 0 || dropped > 0)
+      std::cout.flush();
+    else
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // Write what's left
+  drain_log_ring();
+  std::cout.flush();
+}
 
 void logger(std::string message, int log_level, bool debug_only)
 {
   // If the message isn't debug only or debug is enabled
-  if (!debug_only || global_enable_debug)
-    // For each log level use a differnt color
-    switch (log_level)
+  if (!debug_only || global_enable_debug.load(std::memory_order_relaxed))
+  {
+    // Before the logger thread is running, write directly
+    if (!logger_running.load(std::memory_order_relaxed))
     {
-    case 1:
-      std::cout << "\u001b[32m" << message << "\u001b[0m" << std::endl;
-      break;
-    case 2:
-      std::cout << "\u001b[33m" << message << "\u001b[0m" << std::endl;
-      break;
-    case 3:
-      std::cout << "\u001b[31m" << message << "\u001b[0m" << std::endl;
-      break;
-    case 4:
-      std::cout << "\u001b[34m" << message << "\u001b[0m" << std::endl;
-      break;
-    default:
-      std::cout << message << std::endl;
-      break;
+      write_log_message(log_level, message);
+      std::cout.flush();
     }
+    else if (!enqueue_log_message(message, log_level))
+      log_dropped_messages.fetch_add(1, std::memory_order_relaxed);
+  }
 }
 
 void set_enable_debug(bool enable)
 {
   global_enable_debug = enable;
-}
\ No newline at end of file
+}
+
+/*
+ * Starts the logger thread. From now on messages are written asynchronously
+ */
+void start_logger()
+{
+  // Initialize ring slots
+  for (size_t i = 0; i < LOGGER_RING_SIZE; i++)
+    log_ring[i].sequence.store(i, std::memory_order_relaxed);
+  log_ring_enqueue_position.store(0, std::memory_order_relaxed);
+  log_ring_dequeue_position = 0;
+
+  logger_running = true;
+  logger_thread = std::thread(logger_main_loop);
+}
+
+/*
+ * Stops the logger thread after writing all pending messages
+ */
+void stop_logger()
+{
+  logger_running = false;
+  logger_thread.join();
+}
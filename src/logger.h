@@ -9,6 +9,9 @@
 
 #include <iostream>
 #include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
 
 // Types of log levels
 #define LOG_INFO 0
@@ -16,6 +19,28 @@
 #define LOG_WARN 2
 #define LOG_ERR 3
 
+// Amount of messages the logger can hold before the writer thread
+// catches up. Must be a power of two
+#define LOGGER_RING_SIZE 4096
+
+// Enable debug mode
+extern std::atomic<bool> global_enable_debug;
+
+/*
+ * Logs a debug message. The message expression is only evaluated
+ * when debug logging is enabled, so disabled debug messages don't
+ * build any string
+ * Parameters:
+ * - message: expression producing the message to be logged
+ * - log_level: color of the message by type of log
+ */
+#define LOGGER_DEBUG(message, log_level)                           \
+   do                                                              \
+   {                                                               \
+      if (global_enable_debug.load(std::memory_order_relaxed))     \
+         logger(message, log_level, true);                         \
+   } while (0)
+
 /*
  * Logs some information
  * Parameters:
@@ -25,4 +50,7 @@
  */
 void logger(std::string message, int log_level = LOG_INFO, bool debug_only = false);
 
-void set_enable_debug(bool enable);
\ No newline at end of file
+void set_enable_debug(bool enable);
+
+void start_logger();
+void stop_logger();
@@ -0,0 +1,204 @@
+/*
+ * Filename: lumizeshm.h
+ * Description: layout of the live universe shared memory segment and
+ *              header-only library to read it from other processes
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// POSIX shared memory
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LUMIZE_SHM_DEFAULT_NAME "/lumizedmxengine2" // Found in /dev/shm
+#define LUMIZE_SHM_MAGIC 0x4D455A4C                // "LZEM" in little endian
+#define LUMIZE_SHM_VERSION 1
+#define LUMIZE_SHM_READ_ATTEMPTS 1000 // Times a reader yields waiting for a frame to be written
+
+// Frame data, copied out of the segment by LumizeShmReader::read()
+struct LumizeShmFrame
+{
+   uint16_t channels;             // Channels sent to the FTDI chip
+   uint16_t fps;                  // Frames per second the engine renders at
+   uint32_t reserved;
+   uint64_t frame_count;          // Frames published since the segment was created
+   int64_t timestamp;             // us since epoch when the frame was computed
+   uint8_t dmx[512];              // Values sent to the FTDI chip
+   uint8_t outward_state[512];    // On/off state reported to clients
+   uint8_t outward_brightness[512]; // Brightness reported to clients
+};
+
+// Layout of the shared memory segment
+struct LumizeShmSegment
+{
+   uint32_t magic;
+   uint16_t version;
+   uint16_t reserved;
+   std::atomic<int32_t> pid;       // Engine writing the segment, 0 if none is running
+   std::atomic<uint32_t> sequence; // Odd while a frame is being written
+   LumizeShmFrame frame;
+};
+
+/*
+ * Starts reading a frame in place. Gives up if the frame stays half
+ * written, which happens when the engine dies while writing it
+ * Parameters:
+ *  - const LumizeShmSegment *segment: mapped segment
+ *  - uint32_t &sequence: where to store the sequence to pass to lumize_shm_read_retry()
+ * Returns: false if no frame could be read
+ */
+inline bool lumize_shm_read_begin(const LumizeShmSegment *segment, uint32_t &sequence)
+{
+   // Wait for the engine to finish writing the frame
+   for (int i = 0; i < LUMIZE_SHM_READ_ATTEMPTS; i++)
+   {
+      if ((sequence = segment->sequence.load(std::memory_order_acquire)) % 2 == 0)
+         return true;
+
+      // Engine stopped, nobody is going to finish the frame
+      if (segment->pid.load(std::memory_order_relaxed) == 0)
+         return false;
+
+      sched_yield();
+   }
+
+   return false;
+}
+
+/*
+ * Checks whether a frame read in place has been overwritten while reading it
+ * Parameters:
+ *  - const LumizeShmSegment *segment: mapped segment
+ *  - uint32_t sequence: value returned by lumize_shm_read_begin()
+ * Returns: true if the read has to be repeated
+ */
+inline bool lumize_shm_read_retry(const LumizeShmSegment *segment, uint32_t sequence)
+{
+   std::atomic_thread_fence(std::memory_order_acquire);
+   return segment->sequence.load(std::memory_order_relaxed) != sequence;
+}
+
+/*
+ * Definition of the LumizeShmReader class
+ *
+ * Maps the segment read-only. Frames can be copied with read(), or
+ * read in place from segment() between lumize_shm_read_begin() and
+ * lumize_shm_read_retry():
+ *
+ *   do {
+ *     if (!lumize_shm_read_begin(reader.segment(), sequence))
+ *       break; // No engine is writing frames
+ *     value = reader.segment()->frame.dmx[channel];
+ *   } while (lumize_shm_read_retry(reader.segment(), sequence));
+ */
+class LumizeShmReader
+{
+public:
+   // Destructor
+   ~LumizeShmReader()
+   {
+      close();
+   }
+
+   /*
+    * Maps the segment exported by the engine
+    * Parameters:
+    *  - std::string name: name of the segment, shm_export_name in the engine config
+    * Returns: true if succesful
+    */
+   bool open(std::string name = LUMIZE_SHM_DEFAULT_NAME)
+   {
+      int fd;
+      struct stat status;
+      void *mapping;
+
+      close();
+
+      if ((fd = shm_open(name.c_str(), O_RDONLY, 0)) < 0)
+         return false;
+
+      if (fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof(LumizeShmSegment))
+      {
+         ::close(fd);
+         return false;
+      }
+
+      mapping = mmap(NULL, sizeof(LumizeShmSegment), PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+
+      if (mapping == MAP_FAILED)
+         return false;
+
+      mapped = (const LumizeShmSegment *)mapping;
+
+      if (mapped->magic != LUMIZE_SHM_MAGIC || mapped->version != LUMIZE_SHM_VERSION)
+      {
+         close();
+         return false;
+      }
+
+      return true;
+   }
+
+   /*
+    * Unmaps the segment
+    */
+   void close()
+   {
+      if (mapped)
+         munmap((void *)mapped, sizeof(LumizeShmSegment));
+      mapped = NULL;
+   }
+
+   /*
+    * Returns: the mapped segment, NULL if not open
+    */
+   const LumizeShmSegment *segment()
+   {
+      return mapped;
+   }
+
+   /*
+    * Returns: true if an engine is currently publishing frames
+    */
+   bool is_engine_running()
+   {
+      return mapped && mapped->pid.load(std::memory_order_relaxed) != 0;
+   }
+
+   /*
+    * Copies the latest frame
+    * Parameters:
+    *  - LumizeShmFrame &frame: where to copy the frame
+    * Returns: false if the segment is not open, or if the engine died while writing a frame
+    */
+   bool read(LumizeShmFrame &frame)
+   {
+      uint32_t sequence;
+
+      if (!mapped)
+         return false;
+
+      do
+      {
+         if (!lumize_shm_read_begin(mapped, sequence))
+            return false;
+         memcpy(&frame, (const void *)&mapped->frame, sizeof(frame));
+      } while (lumize_shm_read_retry(mapped, sequence));
+
+      return true;
+   }
+
+private:
+   const LumizeShmSegment *mapped = NULL;
+};
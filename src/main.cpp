@@ -11,6 +11,7 @@
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <csignal>
 
 #include "tcpserver.h" // TCPServer class
 #include "lightrenderer.h"
@@ -19,6 +20,48 @@
 #include "logger.h"       // Logger class
 #include "configreader.h" // Config reader
 #include "persistency.h"  // Persistency writer and reader
+#include "commandqueue.h" // Queue of commands from TCPServer to LightRenderer
+#include "statesnapshot.h" // Outward states for background readers
+#include "latencystats.h" // Command latency statistics
+#include "metrics.h"       // Metrics registry
+#include "metricsserver.h" // Prometheus exposition endpoint
+#include "handover.h"      // Live upgrade to a new process
+#include "configwatcher.h" // Config reload
+#include "realtime.h"      // Realtime scheduling and memory locking
+#include "eventloop.h"     // Single thread runtime
+#include "shmexport.h"     // Live universe for local readers
+#include "scenestore.h"    // Saved scenes
+#include "effects.h"       // Effects rendered on top of fades
+#include "sourcemerger.h"  // Named sources merged with the light states
+#include "mastercontrols.h" // Grand master, submasters, blackout and freeze
+#include "colorfixtures.h"  // Color fades of RGB, RGBW and CCT fixtures
+#include "cuesequencer.h"   // Timed playback of cue lists
+
+// Set by the signal handler when the engine has to shut down
+volatile sig_atomic_t stop_requested = 0;
+
+// Set by the signal handler when the config has to be reloaded
+volatile sig_atomic_t reload_requested = 0;
+
+/*
+ * Handles SIGINT and SIGTERM
+ * Parameters:
+ *  - int signal: received signal
+ */
+void handle_stop_signal(int signal)
+{
+  stop_requested = 1;
+}
+
+/*
+ * Handles SIGHUP
+ * Parameters:
+ *  - int signal: received signal
+ */
+void handle_reload_signal(int signal)
+{
+  reload_requested = 1;
+}
 
 /*
  * Sets up the light states struct
@@ -30,12 +73,14 @@ void setup_light_states(LightStates &light_states)
   for (int i = 0; i < 512; i++)
   {
     light_states.outward_state[i] = false;
-    light_states.outward_brightness[i] = 255;
+    set_outward_brightness(light_states, i, 255);
     light_states.fade_delta[i] = 0;
     light_states.fade_progress[i] = 0;
     light_states.fade_start[i] = 0;
     light_states.fade_end[i] = 0;
     light_states.fade_current[i] = 0;
+    light_states.fade_duration[i] = 0;
+    light_states.fade_start_time[i] = std::chrono::system_clock::time_point();
     light_states.pushbutton_fade[i] = false;
     light_states.pushbutton_fade_up[i] = true;
     light_states.pushbutton_fade_current[i] = 0;
@@ -44,8 +89,185 @@ void setup_light_states(LightStates &light_states)
   }
 }
 
-int main()
+/*
+ * Reads the masters to hand over to a new process. Must be called with
+ * the TCPServer stopped and the light states lock held
+ * Parameters:
+ *  - MasterControls &masters: masters of this process
+ *  - LightRenderer &light_renderer: renderer to copy the frozen frame from
+ *  - HandoverMasters &record: where to store the masters
+ */
+void read_master_records(MasterControls &masters, LightRenderer &light_renderer, HandoverMasters &record)
 {
+  const std::map<std::string, double> &submasters = masters.get_submasters();
+
+  record.grand_master = masters.get_grand_master();
+  record.blackout = masters.is_blackout();
+  record.frozen = masters.is_frozen();
+  light_renderer.get_frame(record.frozen_frame);
+
+  record.submaster_count = 0;
+  for (std::map<std::string, double>::const_iterator submaster = submasters.begin(); submaster != submasters.end(); submaster++)
+  {
+    // Submasters at full don't change anything
+    if (submaster->second == 255)
+      continue;
+
+    if (record.submaster_count >= HANDOVER_MAX_SUBMASTERS)
+    {
+      logger("[HANDOVER] Too many submasters, the others start at full", LOG_WARN, false);
+      break;
+    }
+
+    strncpy(record.submasters[record.submaster_count].group, submaster->first.c_str(), GROUP_NAME_MAX_LENGTH);
+    record.submasters[record.submaster_count].level = submaster->second;
+    record.submaster_count++;
+  }
+}
+
+/*
+ * Restores the masters handed over by the running process. Masters that
+ * were fading are set to where they were fading to on the first frame
+ * Parameters:
+ *  - MasterControls &masters: masters of this process
+ *  - LightRenderer &light_renderer: renderer to give the frozen frame to, not started yet
+ *  - const HandoverMasters &record: masters of the running process
+ */
+void restore_masters(MasterControls &masters, LightRenderer &light_renderer, const HandoverMasters &record)
+{
+  MasterChange change;
+
+  change.transition = 0;
+
+  change.type = MASTER_GRAND;
+  change.level = record.grand_master;
+  masters.set_master(change);
+
+  change.type = MASTER_BLACKOUT;
+  change.level = record.blackout ? 0 : 255;
+  masters.set_master(change);
+
+  change.type = MASTER_SUB;
+  for (int i = 0; i < record.submaster_count && i < HANDOVER_MAX_SUBMASTERS; i++)
+  {
+    change.group = std::string(record.submasters[i].group, strnlen(record.submasters[i].group, GROUP_NAME_MAX_LENGTH));
+    change.level = record.submasters[i].level;
+    masters.set_master(change);
+  }
+
+  // Keep outputting the frame the running process was holding
+  if (record.frozen)
+  {
+    light_renderer.set_frame(record.frozen_frame);
+    masters.set_frozen(true);
+  }
+}
+
+/*
+ * Hands the sockets and light states over to a new process, then
+ * releases the FTDI chip and ports so it can take over output
+ * Parameters:
+ *  - HandoverServer &handover_server: handover server with a waiting process
+ *  - TCPServer &tcp_server: TCP server to detach the sockets from
+ *  - LightRenderer &light_renderer: renderer to stop once the new process is ready
+ *  - CommandQueue &command_queue: commands still to be applied by the renderer
+ *  - std::timed_mutex &light_states_lock: light states mutex
+ *  - StateSnapshot &state_snapshot: published outward states
+ *  - FadeSnapshot &fade_snapshot: published fade states
+ *  - MasterControls &masters: masters to hand over
+ *  - bool single_thread_runtime: the renderer runs on this thread
+ * Returns: true if the new process took over, false if the TCPServer has been
+ *          restarted and this process keeps running
+ */
+bool hand_over(HandoverServer &handover_server, TCPServer &tcp_server, LightRenderer &light_renderer,
+               CommandQueue &command_queue, std::timed_mutex &light_states_lock,
+               StateSnapshot &state_snapshot, FadeSnapshot &fade_snapshot, MasterControls &masters,
+               bool single_thread_runtime)
+{
+  HandoverState state;
+  int fds[HANDOVER_MAX_FDS];
+
+  logger("[HANDOVER] New process connected, handing over...", LOG_INFO, false);
+
+  // Stop taking commands
+  memset(&state, 0, sizeof(state));
+  state.magic = HANDOVER_MAGIC;
+  state.version = HANDOVER_VERSION;
+  state.fd_count = tcp_server.detach(fds);
+
+  // Wait for the renderer to start the fades of the last commands. It
+  // publishes them before releasing the lock
+  while (!command_queue.empty())
+  {
+    if (single_thread_runtime)
+      light_renderer.render_frame();
+    else
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  light_states_lock.lock();
+  read_master_records(masters, light_renderer, state.masters);
+  light_states_lock.unlock();
+
+  read_channel_records(state_snapshot, fade_snapshot, state.channels);
+
+  if (!handover_server.send_state(state, fds) || !handover_server.wait_message(HANDOVER_MESSAGE_READY))
+  {
+    logger("[HANDOVER] New process didn't take over, resuming", LOG_ERR, false);
+    tcp_server.start();
+    return false;
+  }
+
+  // Release the FTDI chip, the new process starts output as soon as
+  // it opens it. DMX receivers hold the last frame in the meantime
+  light_renderer.stop();
+
+  return true;
+}
+
+/*
+ * Takes over sockets and light states from the running process
+ * Parameters:
+ *  - HandoverClient &handover_client: connection to the running process
+ *  - TCPServer &tcp_server: TCP server to give the sockets to
+ *  - LightStates &light_states: light states struct
+ *  - std::timed_mutex &light_states_lock: light states mutex
+ *  - int fps: frames per second of the LightRenderer
+ *  - MasterControls &masters: masters to restore
+ *  - LightRenderer &light_renderer: renderer, not started yet
+ * Returns: true if succesful
+ */
+bool take_over(HandoverClient &handover_client, TCPServer &tcp_server,
+               LightStates &light_states, std::timed_mutex &light_states_lock, int fps,
+               MasterControls &masters, LightRenderer &light_renderer)
+{
+  HandoverState state;
+  int fds[HANDOVER_MAX_FDS];
+
+  if (!handover_client.receive_state(state, fds))
+  {
+    logger("[HANDOVER] Error receiving state from running process!", LOG_ERR, false);
+    return false;
+  }
+
+  light_states_lock.lock();
+  for (int i = 0; i < 512; i++)
+    restore_channel(light_states, i, state.channels[i], fps);
+  light_states_lock.unlock();
+
+  restore_masters(masters, light_renderer, state.masters);
+
+  tcp_server.adopt_sockets(fds, state.fd_count);
+
+  logger("[HANDOVER] Took over " + std::to_string(state.fd_count - 1) + " clients from running process", LOG_SUCC, false);
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  // Take over from a running engine instead of starting from scratch
+  bool takeover = argc > 1 && std::string(argv[1]) == "--takeover";
+  bool handed_over = false;
+
   std::cout << "##### Lumize DMX Engine 2 #####" << std::endl;
   std::cout << "Starting..." << std::endl;
 
@@ -53,11 +275,28 @@ int main()
   LightRenderer light_renderer;
   LumizeConfig config;
   PersistencyWriter persistency_writer;
+  MetricsRegistry metrics;
+  MetricsServer metrics_server;
+  HandoverServer handover_server;
+  HandoverClient handover_client;
+  ConfigWatcher config_watcher;
+  EventLoop event_loop;
+  ShmExporter shm_exporter;
+  SceneStore scene_store;
+  EffectsEngine effects;
+  SourceMerger sources;
+  MasterControls masters;
+  ColorFixtures fixtures;
+  CueSequencer sequencer;
 
   // Setup light states structs
   LightStates light_states;
   setup_light_states(light_states);
   std::timed_mutex light_states_lock;
+  CommandQueue command_queue;
+  StateSnapshot state_snapshot;
+  FadeSnapshot fade_snapshot;
+  LatencyStats latency_stats;
 
   // Read config
   if (!read_config(config))
@@ -65,37 +304,183 @@ int main()
     return 1;
   }
 
-  // Initialize condition variable for PersistencyWriter
-  std::condition_variable &persistency_writer_cv = persistency_writer.get_cv();
-
   // Give TCPServer and LightRenderer access to light states struct
   tcp_server.set_light_states(light_states, light_states_lock);
   light_renderer.set_light_states(light_states, light_states_lock);
-  persistency_writer.set_light_states(light_states, light_states_lock);
 
   // Configure TCPServer and LightRenderer
   tcp_server.configure(config.port, config.fps, config.default_transition, config.pushbutton_fade_reset_delay);
-  light_renderer.configure(config.fps, config.channels, &config.brightness_limits, config.pushbutton_fade_delta, config.pushbutton_fade_pause);
-  persistency_writer.configure(config.persistency_file_path, config.persistency_write_interval);
+  light_renderer.configure(config.fps, config.channels, &config.brightness_limits, &config.fine_channels, config.has_patch ? &config.patch_table : NULL, config.pushbutton_fade_delta, config.pushbutton_fade_pause);
+  persistency_writer.configure(config.persistency_file_path, config.persistency_write_interval, config.persistency_compact_records, config.persistency_debounce, config.persistency_max_delay);
   set_enable_debug(config.log_debug);
 
-  // Give access to persistency_writer_cv
-  tcp_server.set_persistency_writer_cv(persistency_writer_cv);
+  // Publish the config, TCPServer and LightRenderer pick up its reloads
+  config_watcher.configure(config);
+  config_watcher.set_tcp_server(tcp_server);
+  tcp_server.set_config_watcher(config_watcher);
+  light_renderer.set_config_watcher(config_watcher);
+
+  // From now on, write log messages from a background thread
+  start_logger();
+
+  // Keep all memory of the engine in RAM, also the one allocated later
+  if (config.lock_memory)
+    lock_process_memory();
+
+  // Run TCPServer, LightRenderer and PersistencyWriter on this thread
+  if (config.single_thread_runtime)
+  {
+    if (!event_loop.start())
+    {
+      stop_logger();
+      return 1;
+    }
+
+    tcp_server.set_event_loop(event_loop);
+    light_renderer.set_event_loop(event_loop);
+    persistency_writer.set_event_loop(event_loop);
+  }
+
+  // Realtime scheduling of the rendering thread
+  RealtimeSettings realtime_settings;
+  realtime_settings.policy = config.realtime_policy;
+  realtime_settings.priority = config.realtime_priority;
+  realtime_settings.cpu = config.render_cpu;
+  light_renderer.configure_realtime(realtime_settings);
+
+  // Give TCPServer and LightRenderer access to the command queue
+  tcp_server.set_command_queue(command_queue);
+  light_renderer.set_command_queue(command_queue);
+
+  // Give TCPServer access to the saved scenes
+  scene_store.configure(config.scenes_file_path);
+  tcp_server.set_scene_store(scene_store);
+
+  // TCPServer starts and stops effects, LightRenderer renders them
+  tcp_server.set_effects_engine(effects);
+  light_renderer.set_effects_engine(effects);
+
+  // TCPServer gives commands to named sources, LightRenderer merges them
+  sources.configure(config.fps, &config.ltp_channels, config.main_source_priority);
+  tcp_server.set_source_merger(sources);
+  light_renderer.set_source_merger(sources);
+
+  // TCPServer sets masters, LightRenderer applies them before output
+  masters.configure(config.fps, &config.groups);
+  tcp_server.set_master_controls(masters);
+  light_renderer.set_master_controls(masters);
+
+  // TCPServer sets fixture colors, LightRenderer fades them
+  fixtures.configure(config.fps, &config.fixtures);
+  tcp_server.set_color_fixtures(fixtures);
+  light_renderer.set_color_fixtures(fixtures);
+
+  // TCPServer loads and controls cue lists, LightRenderer fires them
+  sequencer.set_command_queue(command_queue);
+  sequencer.set_effects_engine(effects);
+  sequencer.set_tcp_server(tcp_server);
+  tcp_server.set_cue_sequencer(sequencer);
+  light_renderer.set_cue_sequencer(sequencer);
+
+  // Let TCPServer notify PersistencyWriter of changed channels
+  tcp_server.set_persistency_writer(persistency_writer);
+
+  // TCPServer publishes outward states, PersistencyWriter reads them
+  tcp_server.set_state_snapshot(state_snapshot);
+  persistency_writer.set_state_snapshot(state_snapshot);
 
+  // LightRenderer publishes fade states and notifies PersistencyWriter of fades starting and ending
+  light_renderer.set_fade_snapshot(fade_snapshot);
+  light_renderer.set_persistency_writer(persistency_writer);
+  persistency_writer.set_fade_snapshot(fade_snapshot);
+
+  // LightRenderer exports every frame along with the outward states
+  shm_exporter.configure(config.shm_export_name);
+  shm_exporter.set_state_snapshot(state_snapshot);
+  light_renderer.set_shm_exporter(shm_exporter);
+
+  // Give TCPServer and LightRenderer access to latency statistics
+  tcp_server.set_latency_stats(latency_stats);
+  light_renderer.set_latency_stats(latency_stats);
+
+  // Register metrics of all modules
+  tcp_server.set_metrics(metrics);
+  light_renderer.set_metrics(metrics);
+  persistency_writer.set_metrics(metrics);
+  command_queue.set_metrics(metrics);
+  config_watcher.set_metrics(metrics);
+  effects.set_metrics(metrics);
+  sources.set_metrics(metrics);
+  metrics.add_histogram("lumize_command_receive_to_apply_seconds", "Time from a command being received to its fade being started", latency_stats.receive_to_apply);
+  metrics.add_histogram("lumize_command_apply_to_render_seconds", "Time from a fade being started to the first frame reflecting it being computed", latency_stats.apply_to_render);
+  metrics.add_histogram("lumize_command_render_to_output_seconds", "Time from a frame reflecting new commands being computed to it being written to USB", latency_stats.render_to_output);
+  metrics_server.set_metrics(metrics);
+  metrics_server.configure(config.metrics_port);
+  handover_server.configure(config.handover_socket_path);
+
+  // Writing to a client that has just disconnected must not kill the engine
+  std::signal(SIGPIPE, SIG_IGN);
+
+  if (takeover)
+  {
+    // Get sockets and light states from the running process
+    if (!handover_client.connect_to(config.handover_socket_path))
+    {
+      logger("[HANDOVER] Unable to connect to running process on " + config.handover_socket_path, LOG_ERR, false);
+      stop_logger();
+      return 6;
+    }
+
+    if (!take_over(handover_client, tcp_server, light_states, light_states_lock, config.fps, masters, light_renderer))
+    {
+      stop_logger();
+      return 6;
+    }
+  }
   // Read persistency file
-  if (config.enable_persistency)
-    read_persistency_file(config.persistency_file_path, light_states, light_states_lock);
+  else if (config.enable_persistency)
+    read_persistency_file(config.persistency_file_path, light_states, light_states_lock, config.fps);
+
+  state_snapshot.publish(light_states);
+  fade_snapshot.publish(light_states);
+
+  // Read saved scenes, the engine runs without them
+  if (!scene_store.load())
+    logger("[SCENES] Starting with no scenes, saving one will replace the scenes file", LOG_WARN, false);
+
+  if (takeover)
+  {
+    // Handle commands right away, they are applied once the renderer starts
+    if (!tcp_server.start())
+    {
+      stop_logger();
+      return 3;
+    }
+
+    // Wait for the running process to release the FTDI chip and ports. If
+    // it exits without saying so, they have been released anyway
+    handover_client.send_message(HANDOVER_MESSAGE_READY);
+    handover_client.wait_message(HANDOVER_MESSAGE_RELEASED);
+  }
+
+  // Export the live universe if it's enabled, the engine runs without it
+  if (config.enable_shm_export && !shm_exporter.start())
+    logger("[SHM] Live universe will not be exported", LOG_WARN, false);
 
   // Start LightRenderer
   if (!light_renderer.start())
   {
+    if (takeover)
+      tcp_server.stop();
+    stop_logger();
     return 2;
   }
 
   // Start the TCPServer
-  if (!tcp_server.start())
+  if (!takeover && !tcp_server.start())
   {
     light_renderer.stop();
+    stop_logger();
     return 3;
   }
 
@@ -107,21 +492,106 @@ int main()
     {
       light_renderer.stop();
       tcp_server.stop();
+      stop_logger();
       return 4;
     }
   }
 
+  // Start the MetricsServer if it's enabled
+  if (config.enable_metrics)
+  {
+    if (!metrics_server.start())
+    {
+      light_renderer.stop();
+      tcp_server.stop();
+      if (config.enable_persistency)
+        persistency_writer.stop();
+      stop_logger();
+      return 5;
+    }
+  }
+
+  // Wait for a new process to take over if it's enabled
+  if (config.enable_handover)
+    handover_server.start();
+
+  // Reload config when the config file changes
+  if (!config_watcher.start())
+    logger("[CONFIG] Config will not be reloaded until restart", LOG_WARN, false);
+
+  // Shut down gracefully on SIGINT and SIGTERM, reload config on SIGHUP
+  std::signal(SIGINT, handle_stop_signal);
+  std::signal(SIGTERM, handle_stop_signal);
+  std::signal(SIGHUP, handle_reload_signal);
+
   // Keep program running
-  while (true)
+  while (!stop_requested)
+  {
+    if (config.single_thread_runtime)
+      event_loop.run_for(100);
+    else
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    if (reload_requested)
+    {
+      reload_requested = 0;
+      config_watcher.request_reload();
+    }
+
+    if (!handover_server.is_requested())
+      continue;
+
+    if ((handed_over = hand_over(handover_server, tcp_server, light_renderer, command_queue, light_states_lock, state_snapshot, fade_snapshot, masters, config.single_thread_runtime)))
+      break;
+
+    // Wait for another attempt
+    handover_server.stop();
+    handover_server.start();
+  }
+
+  logger("Stopping...", LOG_INFO, false);
+
+  // Stop reloading config
+  config_watcher.stop();
+
+  // Sockets and FTDI chip have already been handed over
+  if (!handed_over)
   {
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // Stop DMXSender, first as it wakes up the TCPServer when cues fire
+    light_renderer.stop();
+
+    // Stop TCPServer
+    tcp_server.stop();
   }
 
-  // Stop TCPServer
-  tcp_server.stop();
+  // Stop exporting frames, after the last one has been rendered
+  shm_exporter.stop();
 
-  // Stop DMXSender
-  light_renderer.stop();
+  // Stop PersistencyWriter
+  if (config.enable_persistency)
+    persistency_writer.stop();
+
+  // Stop MetricsServer
+  if (config.enable_metrics)
+    metrics_server.stop();
+
+  if (config.enable_handover)
+  {
+    // Tell the new process it can open the FTDI chip and bind the ports
+    if (handed_over)
+    {
+      handover_server.send_message(HANDOVER_MESSAGE_RELEASED);
+      logger("[HANDOVER] New process took over", LOG_SUCC, false);
+    }
+
+    handover_server.stop();
+  }
+
+  // Dump command latency statistics
+  log_latency_stats(latency_stats);
+
+  // Write remaining log messages
+  stop_logger();
 
   return 0;
 }
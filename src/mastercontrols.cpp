@@ -0,0 +1,227 @@
+/*
+ * Filename: mastercontrols.cpp
+ * Description: implementation of the MasterControls class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "mastercontrols.h" // Include definition of class to be implemented
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Configure the master controls. Must only be called by the rendering
+ * thread, or before it's started
+ * Parameters:
+ *  - int fps: frames per second of the LightRenderer
+ *  - const std::map<std::string, std::vector<int>> *groups: channels of each group, for submasters
+ */
+void MasterControls::configure(int fps, const std::map<std::string, std::vector<int>> *groups)
+{
+   // Fades in progress keep their duration
+   if (this->fps != 0 && fps != this->fps)
+   {
+      grand_master.delta = grand_master.delta * this->fps / fps;
+      blackout.delta = blackout.delta * this->fps / fps;
+      for (std::map<std::string, MasterFader>::iterator submaster = submasters.begin(); submaster != submasters.end(); submaster++)
+         submaster->second.delta = submaster->second.delta * this->fps / fps;
+   }
+
+   this->fps = fps;
+   this->groups = groups;
+
+   // Groups could have changed channels
+   scale_changed = true;
+}
+
+/*
+ * Fades a master to a new level. Must only be called by the TCPServer
+ * Parameters:
+ *  - const MasterChange &change: master, level and transition
+ */
+void MasterControls::set_master(const MasterChange &change)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   if (change.type == MASTER_GRAND)
+      grand_master_target = change.level;
+   else if (change.type == MASTER_BLACKOUT)
+      blackout_target = change.level == 0;
+   else
+      submaster_targets[change.group] = change.level;
+
+   pending.push_back(change);
+   has_pending.store(true, std::memory_order_release);
+}
+
+/*
+ * Freezes or unfreezes the output. While frozen the last frame is
+ * output, fades and effects keep running behind it
+ * Parameters:
+ *  - bool frozen: true to freeze
+ */
+void MasterControls::set_frozen(bool frozen)
+{
+   this->frozen.store(frozen, std::memory_order_relaxed);
+}
+
+/*
+ * Gets the level the grand master is at or fading to. Must only be called by the TCPServer
+ * Returns: level between 0 and 255
+ */
+double MasterControls::get_grand_master()
+{
+   return grand_master_target;
+}
+
+/*
+ * Gets the levels the submasters are at or fading to. Must only be called by the TCPServer
+ * Returns: level between 0 and 255 of each group a submaster was set for
+ */
+const std::map<std::string, double> &MasterControls::get_submasters()
+{
+   return submaster_targets;
+}
+
+/*
+ * Checks if blackout is on or fading in. Must only be called by the TCPServer
+ * Returns: true if blackout is on
+ */
+bool MasterControls::is_blackout()
+{
+   return blackout_target;
+}
+
+/*
+ * Checks if the output is frozen
+ * Returns: true if frozen
+ */
+bool MasterControls::is_frozen()
+{
+   return frozen.load(std::memory_order_relaxed);
+}
+
+/*
+ * Applies the masters to a frame. Must only be called by the rendering
+ * thread, once per frame
+ * Parameters:
+ *  - double *levels: value of each of the 512 channels, scaled in place
+ */
+void MasterControls::render(double *levels)
+{
+   // Only take the lock when the TCPServer changed something
+   if (has_pending.load(std::memory_order_acquire))
+      apply_pending();
+
+   // Advance master fades
+   scale_changed |= advance_fade(grand_master);
+   scale_changed |= advance_fade(blackout);
+   for (std::map<std::string, MasterFader>::iterator submaster = submasters.begin(); submaster != submasters.end(); submaster++)
+      scale_changed |= advance_fade(submaster->second);
+
+   if (scale_changed)
+      compute_scale();
+
+   if (is_unity)
+      return;
+
+   // One multiply per channel
+   for (int i = 0; i < 512; i++)
+      levels[i] *= scale[i];
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+/*
+ * Starts the fades requested since last frame
+ */
+void MasterControls::apply_pending()
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   applying.swap(pending);
+   has_pending.store(false, std::memory_order_relaxed);
+
+   for (size_t i = 0; i < applying.size(); i++)
+   {
+      const MasterChange &change = applying[i];
+
+      if (change.type == MASTER_GRAND)
+         start_fade(grand_master, change.level, change.transition);
+      else if (change.type == MASTER_BLACKOUT)
+         start_fade(blackout, change.level, change.transition);
+      else
+         start_fade(submasters[change.group], change.level, change.transition);
+   }
+
+   applying.clear();
+}
+
+/*
+ * Starts the fade of a master from its current level
+ * Parameters:
+ *  - MasterFader &fader: master to fade
+ *  - double level: level to fade to, 0-255
+ *  - int transition: transition in ms
+ */
+void MasterControls::start_fade(MasterFader &fader, double level, int transition)
+{
+   fader.start = fader.current;
+   fader.end = level;
+   fader.progress = 0;
+   fader.delta = 1000.0 / (fps * transition); // 1 / FPS * transition if transition was in seconds
+}
+
+/*
+ * Advances the fade of a master by one frame
+ * Parameters:
+ *  - MasterFader &fader: master to advance
+ * Returns: true if the level of the master changed
+ */
+bool MasterControls::advance_fade(MasterFader &fader)
+{
+   // No fade active
+   if (fader.delta == 0)
+      return false;
+
+   fader.progress += fader.delta;
+
+   // Fade is finished
+   if (fader.progress > 1)
+   {
+      fader.delta = 0;
+      fader.current = fader.end;
+   }
+   else
+      fader.current = (fader.end - fader.start) * ease_in_out_sine(fader.progress) + fader.start;
+
+   return true;
+}
+
+/*
+ * Combines all masters into the scale of each channel
+ */
+void MasterControls::compute_scale()
+{
+   std::map<std::string, std::vector<int>>::const_iterator group;
+
+   is_unity = grand_master.current == 255 && blackout.current == 255;
+   std::fill(scale, scale + 512, grand_master.current / 255 * blackout.current / 255);
+
+   for (std::map<std::string, MasterFader>::iterator submaster = submasters.begin(); submaster != submasters.end(); submaster++)
+   {
+      // Group was removed from the config
+      if (submaster->second.current == 255 || (group = groups->find(submaster->first)) == groups->end())
+         continue;
+
+      is_unity = false;
+      for (size_t i = 0; i < group->second.size(); i++)
+         scale[group->second[i]] *= submaster->second.current / 255;
+   }
+
+   scale_changed = false;
+}
@@ -0,0 +1,92 @@
+/*
+ * Filename: mastercontrols.h
+ * Description: interface for the MasterControls class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+#include "lightstates.h"
+
+// Masters a change applies to
+#define MASTER_GRAND 0    // Grand master, scales all channels
+#define MASTER_SUB 1      // Submaster of a group, scales the channels of the group
+#define MASTER_BLACKOUT 2 // Blackout, faded like a master between full and 0
+
+// Change of a master requested by the TCPServer
+struct MasterChange
+{
+   int type;          // MASTER_*
+   std::string group; // Group of MASTER_SUB
+   double level;      // 0-255
+   int transition;    // ms
+};
+
+/*
+ * Definition of the MasterControls class
+ *
+ * Grand master, group submasters and blackout are faded like channels
+ * and combined into a scale for each channel, only recomputed while
+ * they change. The LightRenderer multiplies every channel by its scale
+ * right before output, and holds the last frame while output is frozen
+ */
+class MasterControls
+{
+public:
+   // Methods
+   void configure(int fps, const std::map<std::string, std::vector<int>> *groups);
+   void set_master(const MasterChange &change);
+   void set_frozen(bool frozen);
+   double get_grand_master();
+   const std::map<std::string, double> &get_submasters();
+   bool is_blackout();
+   bool is_frozen();
+   void render(double *levels);
+
+private:
+   // Level of a master, faded by the rendering thread
+   struct MasterFader
+   {
+      double current = 255;
+      double start = 255;
+      double end = 255;
+      double progress = 0;
+      double delta = 0;
+   };
+
+   // Latest targets, only used by the TCPServer
+   double grand_master_target = 255;
+   std::map<std::string, double> submaster_targets; // Submasters set since start, by group
+   bool blackout_target = false;
+
+   // Changes requested since last frame, taken by the rendering thread
+   std::mutex lock;
+   std::vector<MasterChange> pending, applying;
+   std::atomic<bool> has_pending{false};
+   std::atomic<bool> frozen{false};
+
+   // Masters, only used by the rendering thread
+   MasterFader grand_master, blackout;
+   std::map<std::string, MasterFader> submasters;
+   bool is_unity = true;        // All masters at full, channels are output as they are
+   bool scale_changed = false;  // Scale has to be recomputed
+   double scale[512];           // Combined masters of each channel, 0-1
+
+   // Config
+   int fps = 0;
+   const std::map<std::string, std::vector<int>> *groups;
+
+   // Internal functions
+   void apply_pending();
+   void start_fade(MasterFader &fader, double level, int transition);
+   bool advance_fade(MasterFader &fader);
+   void compute_scale();
+};
@@ -0,0 +1,166 @@
+/*
+ * Filename: metrics.cpp
+ * Description: implementation of the MetricsRegistry class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "metrics.h" // Include definition of class to be implemented
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Registers a new counter
+ * Parameters:
+ *  - std::string name: metric name
+ *  - std::string help: metric description
+ *  - std::string labels: label set of this series, empty for none
+ * Returns: reference to the new counter
+ */
+Counter &MetricsRegistry::add_counter(std::string name, std::string help, std::string labels)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   counters.emplace_back();
+   add_entry(METRIC_COUNTER, name, help, labels, &counters.back());
+
+   return counters.back();
+}
+
+/*
+ * Registers a new gauge
+ * Parameters:
+ *  - std::string name: metric name
+ *  - std::string help: metric description
+ *  - std::string labels: label set of this series, empty for none
+ * Returns: reference to the new gauge
+ */
+Gauge &MetricsRegistry::add_gauge(std::string name, std::string help, std::string labels)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   gauges.emplace_back();
+   add_entry(METRIC_GAUGE, name, help, labels, &gauges.back());
+
+   return gauges.back();
+}
+
+/*
+ * Registers a new histogram of microsecond values
+ * Parameters:
+ *  - std::string name: metric name, exposed in seconds
+ *  - std::string help: metric description
+ * Returns: reference to the new histogram
+ */
+Histogram &MetricsRegistry::add_histogram(std::string name, std::string help)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   histograms.emplace_back();
+   add_entry(METRIC_HISTOGRAM, name, help, "", &histograms.back());
+
+   return histograms.back();
+}
+
+/*
+ * Registers a histogram of microsecond values owned by someone else
+ * Parameters:
+ *  - std::string name: metric name, exposed in seconds
+ *  - std::string help: metric description
+ *  - Histogram &histogram: histogram to expose
+ */
+void MetricsRegistry::add_histogram(std::string name, std::string help, Histogram &histogram)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   add_entry(METRIC_HISTOGRAM, name, help, "", &histogram);
+}
+
+/*
+ * Generates the Prometheus text exposition of all metrics
+ * Returns: exposition text
+ */
+std::string MetricsRegistry::generate_exposition()
+{
+   std::lock_guard<std::mutex> lk(lock);
+   std::string output;
+
+   for (size_t i = 0; i < entries.size(); i++)
+   {
+      MetricEntry &entry = entries[i];
+
+      // Series with the same name share the HELP and TYPE lines
+      if (i == 0 || entries[i - 1].name != entry.name)
+      {
+         output.append("# HELP " + entry.name + " " + entry.help + "\n");
+         output.append("# TYPE " + entry.name + " ");
+
+         if (entry.type == METRIC_COUNTER)
+            output.append("counter\n");
+         else if (entry.type == METRIC_GAUGE)
+            output.append("gauge\n");
+         else
+            output.append("histogram\n");
+      }
+
+      std::string series = entry.labels.empty() ? entry.name : entry.name + "{" + entry.labels + "}";
+
+      if (entry.type == METRIC_COUNTER)
+         output.append(series + " " + std::to_string(((Counter *)entry.metric)->get()) + "\n");
+      else if (entry.type == METRIC_GAUGE)
+         output.append(series + " " + std::to_string(((Gauge *)entry.metric)->get()) + "\n");
+      else
+         append_histogram(output, entry.name, *(Histogram *)entry.metric);
+   }
+
+   return output;
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+/*
+ * Adds a metric to the list of exposed metrics
+ */
+void MetricsRegistry::add_entry(int type, std::string name, std::string help, std::string labels, void *metric)
+{
+   MetricEntry entry;
+
+   entry.type = type;
+   entry.name = name;
+   entry.help = help;
+   entry.labels = labels;
+   entry.metric = metric;
+
+   entries.push_back(entry);
+}
+
+/*
+ * Appends the series of a histogram in seconds
+ * Parameters:
+ *  - std::string &output: exposition text to append to
+ *  - std::string &name: metric name
+ *  - Histogram &histogram: histogram of microsecond values
+ */
+void MetricsRegistry::append_histogram(std::string &output, std::string &name, Histogram &histogram)
+{
+   unsigned long cumulative = 0;
+   char bound[32];
+
+   for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+   {
+      cumulative += histogram.get_bucket_count(i);
+      snprintf(bound, sizeof(bound), "%g", Histogram::bucket_bounds[i] / 1000000.0);
+      output.append(name + "_bucket{le=\"" + bound + "\"} " + std::to_string(cumulative) + "\n");
+   }
+
+   cumulative += histogram.get_bucket_count(HISTOGRAM_BUCKETS);
+   output.append(name + "_bucket{le=\"+Inf\"} " + std::to_string(cumulative) + "\n");
+
+   snprintf(bound, sizeof(bound), "%.6f", histogram.get_sum() / 1000000.0);
+   output.append(name + "_sum " + bound + "\n");
+   output.append(name + "_count " + std::to_string(cumulative) + "\n");
+}
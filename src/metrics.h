@@ -0,0 +1,91 @@
+/*
+ * Filename: metrics.h
+ * Description: interface for the MetricsRegistry class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <cstdio>
+
+#include "histogram.h"
+
+// Types of metrics
+#define METRIC_COUNTER 0
+#define METRIC_GAUGE 1
+#define METRIC_HISTOGRAM 2
+
+/*
+ * Monotonically increasing value
+ */
+class Counter
+{
+public:
+   Counter() : value(0) {}
+   void increment(unsigned long amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+   unsigned long get() { return value.load(std::memory_order_relaxed); }
+
+private:
+   std::atomic<unsigned long> value;
+};
+
+/*
+ * Value that can go up and down
+ */
+class Gauge
+{
+public:
+   Gauge() : value(0) {}
+   void set(long value) { this->value.store(value, std::memory_order_relaxed); }
+   void increment(long amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+   void decrement(long amount = 1) { value.fetch_sub(amount, std::memory_order_relaxed); }
+   long get() { return value.load(std::memory_order_relaxed); }
+
+private:
+   std::atomic<long> value;
+};
+
+/*
+ * Definition of the MetricsRegistry class
+ *
+ * Modules register their metrics at configuration time and keep the
+ * returned references. Updates only touch the metric's atomics, the
+ * registry lock is only taken to register metrics and to generate the
+ * exposition text.
+ */
+class MetricsRegistry
+{
+public:
+   // Methods
+   Counter &add_counter(std::string name, std::string help, std::string labels = "");
+   Gauge &add_gauge(std::string name, std::string help, std::string labels = "");
+   Histogram &add_histogram(std::string name, std::string help);
+   void add_histogram(std::string name, std::string help, Histogram &histogram);
+   std::string generate_exposition();
+
+private:
+   // Registered metric
+   struct MetricEntry
+   {
+      int type;
+      std::string name;
+      std::string help;
+      std::string labels; // Prometheus label set without braces, e.g. type="on"
+      void *metric;
+   };
+
+   std::mutex lock;
+   std::deque<Counter> counters;
+   std::deque<Gauge> gauges;
+   std::deque<Histogram> histograms;
+   std::vector<MetricEntry> entries;
+
+   void add_entry(int type, std::string name, std::string help, std::string labels, void *metric);
+   void append_histogram(std::string &output, std::string &name, Histogram &histogram);
+};
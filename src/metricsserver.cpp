@@ -0,0 +1,176 @@
+/*
+ * Filename: metricsserver.cpp
+ * Description: implementation of the MetricsServer class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "metricsserver.h" // Include definition of class to be implemented
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Starts the metrics HTTP server
+ * Returns: true if succesful
+ */
+bool MetricsServer::start()
+{
+   struct sockaddr_in address;
+   int opt = 1;
+
+   LOGGER_DEBUG("[METRICS] Starting server...", LOG_INFO);
+
+   if ((listen_socket = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+   {
+      logger("[METRICS] Error on socket() system call!", LOG_ERR, false);
+      return false;
+   }
+
+   if (setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, (char *)&opt, sizeof(opt)) < 0)
+   {
+      logger("[METRICS] Error setting socket options!", LOG_ERR, false);
+      close(listen_socket);
+      return false;
+   }
+
+   // Only reachable from the local machine
+   address.sin_family = AF_INET;
+   address.sin_addr.s_addr = inet_addr(METRICS_SERVER_ADDRESS);
+   address.sin_port = htons(port);
+
+   if (bind(listen_socket, (struct sockaddr *)&address, sizeof(address)) < 0)
+   {
+      logger("[METRICS] Error binding port to socket!", LOG_ERR, false);
+      close(listen_socket);
+      return false;
+   }
+
+   if (listen(listen_socket, 5) < 0)
+   {
+      logger("[METRICS] Error starting listen()!", LOG_ERR, false);
+      close(listen_socket);
+      return false;
+   }
+
+   running = true;
+   server_thread = std::thread(&MetricsServer::main_loop, this);
+
+   logger("[METRICS] Serving metrics on http://" + std::string(METRICS_SERVER_ADDRESS) + ":" + std::to_string(port) + "/metrics", LOG_SUCC, false);
+   return true;
+}
+
+/*
+ * Stops the metrics HTTP server
+ */
+void MetricsServer::stop()
+{
+   running = false;
+
+   // Wake up accept() in the server thread
+   shutdown(listen_socket, SHUT_RDWR);
+
+   server_thread.join();
+   close(listen_socket);
+}
+
+/*
+ * Configure the metrics server
+ * Parameters:
+ *  - int port: local TCP port to listen on
+ */
+void MetricsServer::configure(int port)
+{
+   this->port = port;
+}
+
+/*
+ * Give MetricsServer access to the metrics registry
+ * Parameters:
+ *  - MetricsRegistry &metrics: reference to metrics registry
+ */
+void MetricsServer::set_metrics(MetricsRegistry &metrics)
+{
+   this->metrics = &metrics;
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+/*
+ * Accepts and serves scrape requests one at a time
+ */
+void MetricsServer::main_loop()
+{
+   while (running)
+   {
+      int socketfd = accept(listen_socket, NULL, NULL);
+
+      if (socketfd < 0)
+      {
+         if (running && errno != EINTR)
+            LOGGER_DEBUG("[METRICS] Error accepting client", LOG_WARN);
+         continue;
+      }
+
+      handle_request(socketfd);
+      close(socketfd);
+   }
+}
+
+/*
+ * Reads an HTTP request and sends the exposition text
+ * Parameters:
+ *  - int socketfd: client socket
+ */
+void MetricsServer::handle_request(int socketfd)
+{
+   struct timeval timeout;
+   char buffer[1024];
+   ssize_t valread;
+
+   // Don't let a silent client block the server
+   timeout.tv_sec = METRICS_REQUEST_TIMEOUT;
+   timeout.tv_usec = 0;
+   setsockopt(socketfd, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
+
+   // Only the request line is needed
+   if ((valread = read(socketfd, buffer, sizeof(buffer) - 1)) <= 0)
+      return;
+   buffer[valread] = '\0';
+
+   std::string request = buffer;
+
+   if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0)
+      send_response(socketfd, "200 OK", metrics->generate_exposition());
+   else
+      send_response(socketfd, "404 Not Found", "Not found\n");
+}
+
+/*
+ * Sends a complete HTTP response
+ * Parameters:
+ *  - int socketfd: client socket
+ *  - std::string status: HTTP status
+ *  - std::string body: response body
+ */
+void MetricsServer::send_response(int socketfd, std::string status, std::string body)
+{
+   std::string response = "HTTP/1.0 " + status + "\r\n" +
+                          "Content-Type: text/plain; version=0.0.4\r\n" +
+                          "Content-Length: " + std::to_string(body.length()) + "\r\n" +
+                          "Connection: close\r\n\r\n" + body;
+   size_t sent = 0;
+
+   while (sent < response.length())
+   {
+      ssize_t written = send(socketfd, response.data() + sent, response.length() - sent, MSG_NOSIGNAL);
+
+      if (written <= 0)
+         return;
+
+      sent += written;
+   }
+}
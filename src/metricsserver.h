@@ -0,0 +1,55 @@
+/*
+ * Filename: metricsserver.h
+ * Description: interface for the MetricsServer class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+// Network libraries
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "metrics.h"
+#include "logger.h"
+
+#define METRICS_SERVER_ADDRESS "127.0.0.1"
+#define METRICS_REQUEST_TIMEOUT 1 // s
+
+/*
+ * Definition of the MetricsServer class
+ *
+ * Minimal HTTP/1.0 listener serving the Prometheus text exposition
+ * of a MetricsRegistry on GET /metrics
+ */
+class MetricsServer
+{
+public:
+   // Methods
+   bool start();
+   void stop();
+   void configure(int port);
+   void set_metrics(MetricsRegistry &metrics);
+
+private:
+   int port;
+   int listen_socket;
+   std::atomic<bool> running;
+   std::thread server_thread;
+   MetricsRegistry *metrics;
+
+   // Internal functions
+   void main_loop();
+   void handle_request(int socketfd);
+   void send_response(int socketfd, std::string status, std::string body);
+};
@@ -16,7 +16,37 @@
  */
 bool PersistencyWriter::start()
 {
-  logger("[PERSISTENCY] Starting writer on file " + file_path, LOG_INFO, true);
+  LOGGER_DEBUG("[PERSISTENCY] Starting writer on file " + file_path, LOG_INFO);
+
+  // Open journal for appending
+  if ((journal_fd = open((file_path + PERSISTENCY_JOURNAL_FILE_SUFFIX).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644)) < 0)
+  {
+    logger("[PERSISTENCY] Unable to open persistency journal!", LOG_ERR, false);
+    return false;
+  }
+
+  // Continue from the generation of the snapshot on disk, whose
+  // contents are the states that were just restored
+  generation = read_snapshot_generation(file_path);
+  read_channel_records(persisted.channels);
+
+  // Schedule writes on the event loop
+  if (event_loop)
+  {
+    // Start from a snapshot of the restored states and an empty journal
+    compact_persistency_file();
+
+    if ((debounce_timer = create_timer()) < 0 || (compaction_timer = create_timer()) < 0 ||
+        !arm_timer(compaction_timer, interval * 1000000L, true) ||
+        !event_loop->add(debounce_timer, EPOLLIN, this) || !event_loop->add(compaction_timer, EPOLLIN, this))
+    {
+      logger("[PERSISTENCY] Error setting up persistency timers!", LOG_ERR, false);
+      close(journal_fd);
+      return false;
+    }
+
+    return true;
+  }
 
   // Start the connection manager
   main_loop_thread = std::thread(&PersistencyWriter::main_loop, this);
@@ -29,6 +59,21 @@ bool PersistencyWriter::start()
  */
 void PersistencyWriter::stop()
 {
+  if (event_loop)
+  {
+    event_loop->remove(debounce_timer);
+    event_loop->remove(compaction_timer);
+    close(debounce_timer);
+    close(compaction_timer);
+
+    // Write changes still being debounced
+    if (dirty_pending)
+      append_journal();
+
+    close(journal_fd);
+    return;
+  }
+
   // Tell the main loop
   {
     std::lock_guard<std::mutex> lk(main_loop_mutex);
@@ -37,38 +82,122 @@ void PersistencyWriter::stop()
   main_loop_cv.notify_all();
 
   main_loop_thread.join(); // Wait for the connection manager to exit
+
+  close(journal_fd);
 }
 
 /*
- * Give PersistencyWriter access to LightStates struct
+ * Give PersistencyWriter access to the published outward states
  * Parameters:
- *  - LightStates &light_states: reference to light states struct
+ *  - StateSnapshot &state_snapshot: reference to state snapshot
+ */
+void PersistencyWriter::set_state_snapshot(StateSnapshot &state_snapshot)
+{
+  this->state_snapshot = &state_snapshot;
+}
+
+/*
+ * Give PersistencyWriter access to the published fade states
+ * Parameters:
+ *  - FadeSnapshot &fade_snapshot: reference to fade snapshot
  */
-void PersistencyWriter::set_light_states(LightStates &light_states, std::timed_mutex &light_states_lock)
+void PersistencyWriter::set_fade_snapshot(FadeSnapshot &fade_snapshot)
 {
-  this->light_states = &light_states;
-  this->light_states_lock = &light_states_lock;
+  this->fade_snapshot = &fade_snapshot;
 }
 
 /*
  * Sets up configuration for the PersistencyWriter
  * Parameters:
- *  - int channels: Amount of channels to include in the DMX frame
+ *  - std::string file_path: path of the snapshot file
+ *  - int interval: seconds between compactions of the journal into the snapshot
+ *  - int compact_records: journal records that trigger an early compaction
+ *  - int debounce: milliseconds without changes to wait before writing
+ *  - int max_delay: max milliseconds a change can wait to be written
  */
-void PersistencyWriter::configure(std::string file_path, int interval)
+void PersistencyWriter::configure(std::string file_path, int interval, int compact_records, int debounce, int max_delay)
 {
   this->file_path = file_path;
   this->interval = interval;
+  this->compact_records = compact_records;
+  this->debounce = debounce;
+  this->max_delay = max_delay;
 }
 
 /*
- * Give access to internal condition variable to be able to notify PersistencyWiter
- * of change of light states
- * Returns: condition variable
+ * Records that the outward state of a channel changed. Called by the TCP
+ * thread, wakes the writer only when the first change of a burst arrives
+ * Parameters:
+ *  - int channel: changed channel
  */
-std::condition_variable &PersistencyWriter::get_cv()
+void PersistencyWriter::mark_dirty(int channel)
 {
-  return main_loop_cv;
+  dirty_channels[channel / 64].fetch_or(1ULL << (channel % 64));
+  dirty_marks++;
+  changes_counter->increment();
+
+  // Marked by the event loop thread itself
+  if (event_loop)
+  {
+    schedule_write();
+    return;
+  }
+
+  if (!dirty_pending.exchange(true))
+  {
+    // Taking the mutex makes sure the writer is either waiting or
+    // hasn't checked dirty_pending yet
+    {
+      std::lock_guard<std::mutex> lk(main_loop_mutex);
+    }
+    main_loop_cv.notify_all();
+  }
+}
+
+/*
+ * Schedule writes on an event loop instead of a thread. Must be called before start()
+ * Parameters:
+ *  - EventLoop &event_loop: event loop of the single thread runtime
+ */
+void PersistencyWriter::set_event_loop(EventLoop &event_loop)
+{
+  this->event_loop = &event_loop;
+}
+
+/*
+ * Writes changes once they have been debounced, and compacts the journal
+ * Parameters:
+ *  - int fd: file descriptor with events
+ *  - uint32_t events: EPOLL* events
+ */
+void PersistencyWriter::handle_event(int fd, uint32_t events)
+{
+  if (read_timer(fd) == 0)
+    return;
+
+  if (fd == debounce_timer && dirty_pending)
+  {
+    write_delay_histogram->record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - first_change_time).count());
+    append_journal();
+  }
+
+  compact_if_needed();
+}
+
+/*
+ * Give PersistencyWriter access to the metrics registry and register its metrics
+ * Parameters:
+ *  - MetricsRegistry &metrics: reference to metrics registry
+ */
+void PersistencyWriter::set_metrics(MetricsRegistry &metrics)
+{
+  writes_counter = &metrics.add_counter("lumize_persistency_writes_total", "Persistency journal appends and snapshot writes");
+  write_errors_counter = &metrics.add_counter("lumize_persistency_write_errors_total", "Failed persistency writes");
+  journal_records_counter = &metrics.add_counter("lumize_persistency_journal_records_total", "Channel changes appended to the persistency journal");
+  compactions_counter = &metrics.add_counter("lumize_persistency_compactions_total", "Compactions of the persistency journal into a snapshot");
+  changes_counter = &metrics.add_counter("lumize_persistency_changes_total", "Light state changes notified to the persistency writer");
+  write_duration_histogram = &metrics.add_histogram("lumize_persistency_write_duration_seconds", "Time taken by a persistency write");
+  write_delay_histogram = &metrics.add_histogram("lumize_persistency_write_delay_seconds", "Time from the first change of a burst to its write to the journal");
 }
 
 /*
@@ -76,63 +205,225 @@ std::condition_variable &PersistencyWriter::get_cv()
  */
 
 /*
- * Generates the states string used for persistency
- * Returns: states string
+ * Reads a consistent copy of the outward and fade states into persistency records
+ * Parameters:
+ *  - PersistencyChannelRecord *channels: array of 512 records to fill in
  */
-std::string PersistencyWriter::generate_states_string()
+void PersistencyWriter::read_channel_records(PersistencyChannelRecord *channels)
 {
-  std::string string;
+  ::read_channel_records(*state_snapshot, *fade_snapshot, channels);
+}
 
-  // Start with response message type
-  string.append("2.0");
+/*
+ * Appends the dirty channels that changed since the last write to the journal
+ * Returns: true if succesful
+ */
+bool PersistencyWriter::append_journal()
+{
+  std::chrono::steady_clock::time_point write_begin_time = std::chrono::steady_clock::now();
+  PersistencyJournalRecord records[512];
+  PersistencyChannelRecord current[512];
+  uint64_t dirty[8];
+  int count = 0;
+
+  // Take dirty channels. A channel marked after this point sets
+  // dirty_pending again and is written on the next round
+  dirty_pending = false;
+  for (int word = 0; word < 8; word++)
+    dirty[word] = dirty_channels[word].exchange(0);
+
+  // Channels are marked dirty after being published, so
+  // this copy includes all the changes taken above
+  read_channel_records(current);
+
+  for (int word = 0; word < 8; word++)
+  {
+    for (int bit = 0; dirty[word] != 0; bit++, dirty[word] >>= 1)
+    {
+      int i = word * 64 + bit;
 
-  // Append all statuses
-  for (int i = 0; i < 512; i++)
+      if (!(dirty[word] & 1))
+        continue;
+
+      // Channel went back to the persisted state
+      if (memcmp(&current[i], &persisted.channels[i], sizeof(PersistencyChannelRecord)) == 0)
+        continue;
+
+      memset(&records[count], 0, sizeof(PersistencyJournalRecord));
+      records[count].generation = generation;
+      records[count].channel = i;
+      records[count].record = current[i];
+      records[count].checksum = persistency_crc32(&records[count], offsetof(PersistencyJournalRecord, checksum));
+      count++;
+    }
+  }
+
+  // Nothing to write
+  if (count == 0)
+    return true;
+
+  LOGGER_DEBUG("[PERSISTENCY] Appending " + std::to_string(count) + " changes to journal...", LOG_INFO);
+
+  // All records go out in a single write
+  ssize_t size = count * sizeof(PersistencyJournalRecord);
+  if (write(journal_fd, records, size) != size || fdatasync(journal_fd) < 0)
   {
-    string.append(",");
-    string.append(std::to_string(light_states->outward_state[i]));
-    string.append("-");
-    string.append(std::to_string(light_states->outward_brightness[i]));
+    logger("[PERSISTENCY] Error writing to persistency journal!", LOG_WARN, false);
+    write_errors_counter->increment();
+
+    // Retry these channels on the next round
+    for (int j = 0; j < count; j++)
+      dirty_channels[records[j].channel / 64].fetch_or(1ULL << (records[j].channel % 64));
+    dirty_pending = true;
+
+    return false;
   }
 
-  return string;
+  for (int j = 0; j < count; j++)
+    persisted.channels[records[j].channel] = records[j].record;
+  journal_records += count;
+
+  writes_counter->increment();
+  journal_records_counter->increment(count);
+  write_duration_histogram->record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - write_begin_time).count());
+
+  return true;
 }
 
 /*
- * Writes light states to persistency file
+ * Writes a full snapshot of the light states and empties the journal
+ * Returns: true if succesful
  */
-void PersistencyWriter::write_persistency_file()
+bool PersistencyWriter::compact_persistency_file()
 {
-  // Generate persistency states string
-  std::string states_string = generate_states_string();
+  std::chrono::steady_clock::time_point write_begin_time = std::chrono::steady_clock::now();
+
+  PersistencySnapshot snapshot;
 
-  // Create and open a text file
-  std::ofstream PersistencyFile(file_path);
+  LOGGER_DEBUG("[PERSISTENCY] Writing persistency snapshot...", LOG_INFO);
 
-  // Write to the file
-  if (!(PersistencyFile << states_string))
+  memset(&snapshot.header, 0, sizeof(snapshot.header));
+
+  read_channel_records(snapshot.channels);
+
+  // A new generation invalidates the records currently in the journal,
+  // even if we crash before truncating it
+  snapshot.header.magic = PERSISTENCY_SNAPSHOT_MAGIC;
+  snapshot.header.version = PERSISTENCY_SNAPSHOT_VERSION;
+  snapshot.header.channels = 512;
+  snapshot.header.generation = generation + 1;
+  snapshot.header.payload_size = sizeof(snapshot.channels);
+  snapshot.header.checksum = persistency_crc32(snapshot.channels, sizeof(snapshot.channels));
+
+  if (!write_file_atomically(file_path, &snapshot, sizeof(snapshot)))
+  {
     logger("[PERSISTENCY] Error writing to persistency file!", LOG_WARN, false);
+    write_errors_counter->increment();
+    return false;
+  }
+
+  persisted = snapshot;
+  generation++;
+
+  // Empty journal
+  if (ftruncate(journal_fd, 0) < 0 || fsync(journal_fd) < 0)
+  {
+    logger("[PERSISTENCY] Error truncating persistency journal!", LOG_WARN, false);
+    write_errors_counter->increment();
+  }
+
+  journal_records = 0;
+  last_compaction_time = std::chrono::steady_clock::now();
+
+  writes_counter->increment();
+  compactions_counter->increment();
+  write_duration_histogram->record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - write_begin_time).count());
 
-  // Close the file
-  PersistencyFile.close();
+  return true;
 }
 
 /*
- * Manages the connection to the FTDI chip with reconnects
+ * Waits for changes to the light states. Once the first change arrives
+ * keeps waiting until no more changes come for the debounce time, but
+ * no longer than the max delay, so a burst of commands becomes a single write
+ * Parameters:
+ *  - std::unique_lock<std::mutex> &lk: lock on main_loop_mutex
+ */
+void PersistencyWriter::wait_for_changes(std::unique_lock<std::mutex> &lk)
+{
+  std::chrono::steady_clock::time_point first_change_time, deadline;
+  unsigned long seen_marks;
+
+  // Wait for the first change, or for the compaction interval
+  if (!main_loop_cv.wait_for(lk, std::chrono::seconds(interval), [this]
+                             { return !running || dirty_pending; }))
+    return;
+
+  first_change_time = std::chrono::steady_clock::now();
+  deadline = first_change_time + std::chrono::milliseconds(max_delay);
+
+  // Debounce
+  do
+  {
+    seen_marks = dirty_marks;
+    main_loop_cv.wait_until(lk, std::min(deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(debounce)), [this]
+                            { return !running; });
+  } while (running && dirty_marks != seen_marks && std::chrono::steady_clock::now() < deadline);
+
+  write_delay_histogram->record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - first_change_time).count());
+}
+
+/*
+ * Restarts the debounce timer after a change, without delaying the
+ * write more than max_delay from the first change of the burst
+ */
+void PersistencyWriter::schedule_write()
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  long remaining;
+
+  if (!dirty_pending.exchange(true))
+    first_change_time = now;
+
+  remaining = std::chrono::duration_cast<std::chrono::microseconds>(first_change_time + std::chrono::milliseconds(max_delay) - now).count();
+  arm_timer(debounce_timer, std::max(1L, std::min(debounce * 1000L, remaining)), false);
+}
+
+/*
+ * Compacts the journal into a snapshot when it gets long or old
+ */
+void PersistencyWriter::compact_if_needed()
+{
+  if (journal_records >= compact_records ||
+      (journal_records > 0 && std::chrono::steady_clock::now() - last_compaction_time >= std::chrono::seconds(interval)))
+    compact_persistency_file();
+}
+
+/*
+ * Appends changes to the journal whenever light states change and
+ * periodically compacts it into a snapshot
  */
 void PersistencyWriter::main_loop()
 {
+  std::unique_lock<std::mutex> lk(main_loop_mutex);
+
+  // Start from a snapshot of the restored states and an empty journal
+  compact_persistency_file();
+
   while (running)
   {
-    std::unique_lock<std::mutex> lk(main_loop_mutex);
+    wait_for_changes(lk);
 
-    logger("[PERSISTENCY] Writing persistency file...", LOG_INFO, true);
+    // Write without holding the mutex, so the TCP thread never waits on the disk
+    lk.unlock();
 
-    // Write persistency file
-    write_persistency_file();
+    // Append changed channels, also done one last time when stopping
+    if (dirty_pending)
+      append_journal();
 
-    // Wait for interval or next update
-    main_loop_cv.wait_for(lk, std::chrono::seconds(interval));
+    compact_if_needed();
+
+    lk.lock();
   }
 }
 
@@ -171,7 +462,7 @@ bool parse_states_string(std::string states_string, LightStates &light_states, s
   int tmp_brightness;
 
   // Check that persistency file version string matches
-  if (!(string_split[0] == PERSISTENCY_FILE_VERSION_STRING))
+  if (string_split.size() < 513 || !(string_split[0] == PERSISTENCY_FILE_VERSION_STRING))
   {
     logger("[PERSISTENCY] Persistency file was written by different version of Lumize DMX Engine! Skipping...", LOG_WARN, false);
     return false;
@@ -191,7 +482,7 @@ bool parse_states_string(std::string states_string, LightStates &light_states, s
     else
     {
       // If value is corrupted, skip
-      logger("[PERSISTENCY] Bad state value in persistency file at channel " + std::to_string(i), LOG_WARN, true);
+      LOGGER_DEBUG("[PERSISTENCY] Bad state value in persistency file at channel " + std::to_string(i), LOG_WARN);
     }
 
     // Parse brightness
@@ -202,16 +493,16 @@ bool parse_states_string(std::string states_string, LightStates &light_states, s
       // Check that brightness value is acceptable
       if (tmp_brightness < 0 || tmp_brightness > 511)
       {
-        logger("[PERSISTENCY] Brightness value out of range in perstency file at channel " + std::to_string(i), LOG_WARN, true);
+        LOGGER_DEBUG("[PERSISTENCY] Brightness value out of range in perstency file at channel " + std::to_string(i), LOG_WARN);
         continue;
       }
 
       // Copy value to temporary light states
-      light_states.outward_brightness[i] = tmp_brightness;
+      set_outward_brightness(light_states, i, tmp_brightness);
     }
     catch (const std::exception &e)
     {
-      logger("[PERSISTENCY] Bad brightness value in persistency file at channel " + std::to_string(i), LOG_WARN, true);
+      LOGGER_DEBUG("[PERSISTENCY] Bad brightness value in persistency file at channel " + std::to_string(i), LOG_WARN);
     }
 
     // Calculate current brightness
@@ -222,38 +513,374 @@ bool parse_states_string(std::string states_string, LightStates &light_states, s
   return true;
 }
 
+/*
+ * Replaces a file without ever leaving a partially written file
+ * behind: data is written to a temporary file, synced to disk and
+ * then renamed over the old file
+ * Parameters:
+ *  - std::string file_path: path of the file to replace
+ *  - const void *data: new file contents
+ *  - size_t size: size of data
+ * Returns: true if succesful
+ */
+bool write_file_atomically(std::string file_path, const void *data, size_t size)
+{
+  std::string tmp_file_path = file_path + PERSISTENCY_TMP_FILE_SUFFIX;
+  const char *position = (const char *)data;
+  int fd;
+
+  if ((fd = open(tmp_file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+    return false;
+
+  // Write whole buffer
+  while (size > 0)
+  {
+    ssize_t written = write(fd, position, size);
+
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      close(fd);
+      return false;
+    }
+
+    position += written;
+    size -= written;
+  }
+
+  // Make sure data is on disk before the rename makes it visible
+  if (fsync(fd) < 0)
+  {
+    close(fd);
+    return false;
+  }
+  close(fd);
+
+  if (rename(tmp_file_path.c_str(), file_path.c_str()) < 0)
+    return false;
+
+  // Persist the rename itself
+  size_t separator = file_path.rfind('/');
+  std::string directory_path = separator == std::string::npos ? "." : file_path.substr(0, separator + 1);
+
+  if ((fd = open(directory_path.c_str(), O_RDONLY | O_DIRECTORY)) >= 0)
+  {
+    fsync(fd);
+    close(fd);
+  }
+
+  return true;
+}
+
+/*
+ * Computes the CRC-32 (IEEE 802.3) of a buffer
+ * Parameters:
+ *  - const void *data: input buffer
+ *  - size_t size: size of the buffer
+ * Returns: checksum
+ */
+uint32_t persistency_crc32(const void *data, size_t size)
+{
+  static uint32_t table[256];
+  static bool table_ready = false;
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint32_t crc = 0xFFFFFFFF;
+
+  // Build lookup table on first use
+  if (!table_ready)
+  {
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; bit++)
+        value = value & 1 ? (value >> 1) ^ 0xEDB88320 : value >> 1;
+      table[i] = value;
+    }
+    table_ready = true;
+  }
+
+  for (size_t i = 0; i < size; i++)
+    crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+
+  return crc ^ 0xFFFFFFFF;
+}
+
+/*
+ * Reads a consistent copy of the outward and fade states into persistency records
+ * Parameters:
+ *  - StateSnapshot &state_snapshot: published outward states
+ *  - FadeSnapshot &fade_snapshot: published fade states
+ *  - PersistencyChannelRecord *channels: array of 512 records to fill in
+ */
+void read_channel_records(StateSnapshot &state_snapshot, FadeSnapshot &fade_snapshot, PersistencyChannelRecord *channels)
+{
+  OutwardStates states;
+  FadeStates fades;
+
+  state_snapshot.read(states);
+  fade_snapshot.read(fades);
+
+  // Zero padding too, records are compared and checksummed as bytes
+  memset(channels, 0, 512 * sizeof(PersistencyChannelRecord));
+
+  for (int i = 0; i < 512; i++)
+  {
+    const ChannelFade &fade = fades.channels[i];
+
+    channels[i].state = states.state[i];
+    channels[i].brightness = states.brightness[i];
+    channels[i].brightness_fine = states.brightness_fine[i];
+    channels[i].fade_curve = PERSISTENCY_FADE_CURVE_EASE_IN_OUT_SINE;
+    channels[i].flags = PERSISTENCY_FLAG_FINE;
+    channels[i].pushbutton_fade_end_time = fade.pushbutton_fade_end_time;
+
+    if (fade.pushbutton_fade_up)
+      channels[i].flags |= PERSISTENCY_FLAG_PUSHBUTTON_UP;
+
+    if (fade.fading)
+    {
+      channels[i].flags |= PERSISTENCY_FLAG_FADING;
+      channels[i].fade_start = std::lround(fade.fade_start / 257.0);
+      channels[i].fade_end = std::lround(fade.fade_end / 257.0);
+      channels[i].fade_start_fine = fade.fade_start;
+      channels[i].fade_end_fine = fade.fade_end;
+      channels[i].fade_duration = fade.fade_duration;
+      channels[i].fade_start_time = fade.fade_start_time;
+    }
+  }
+}
+
+/*
+ * Restores the state of a channel from its persistency record. A fade
+ * that was in progress is resumed from the progress it would have now,
+ * based on the wall clock. Must be called with light_states_lock held
+ * Parameters:
+ *  - LightStates &light_states: reference to light states struct
+ *  - int channel: channel to restore
+ *  - const PersistencyChannelRecord &record: persisted channel state
+ *  - int fps: frames per second of the LightRenderer
+ */
+void restore_channel(LightStates &light_states, int channel, const PersistencyChannelRecord &record, int fps)
+{
+  std::chrono::system_clock::time_point system_now = std::chrono::system_clock::now();
+  long long now = std::chrono::duration_cast<std::chrono::milliseconds>(system_now.time_since_epoch()).count();
+  long long elapsed = now - record.fade_start_time;
+
+  bool is_fine = record.flags & PERSISTENCY_FLAG_FINE;
+
+  light_states.outward_state[channel] = record.state != 0;
+  set_outward_brightness(light_states, channel, is_fine ? record.brightness_fine / 257.0 : record.brightness);
+
+  // Calculate current brightness
+  light_states.fade_current[channel] = light_states.outward_state[channel] ? light_states.outward_brightness_fine[channel] / 257.0 : 0;
+  light_states.fade_delta[channel] = 0;
+  light_states.fade_progress[channel] = 0;
+
+  // Pushbutton fade direction reset delay keeps running across the restart
+  light_states.pushbutton_fade_up[channel] = record.flags & PERSISTENCY_FLAG_PUSHBUTTON_UP;
+  light_states.pushbutton_fade_current[channel] = light_states.fade_current[channel];
+  if (record.pushbutton_fade_end_time != 0)
+    light_states.pushbutton_fade_end_time[channel] = std::chrono::steady_clock::now() - std::chrono::milliseconds(now - record.pushbutton_fade_end_time);
+
+  // Fade already finished, or clock went backwards
+  if (!(record.flags & PERSISTENCY_FLAG_FADING) || record.fade_duration == 0 || elapsed < 0 || elapsed >= record.fade_duration)
+    return;
+
+  // Resume fade
+  light_states.fade_start[channel] = is_fine ? record.fade_start_fine / 257.0 : record.fade_start;
+  light_states.fade_end[channel] = is_fine ? record.fade_end_fine / 257.0 : record.fade_end;
+  light_states.fade_duration[channel] = record.fade_duration;
+  light_states.fade_start_time[channel] = std::chrono::system_clock::time_point(std::chrono::milliseconds(record.fade_start_time));
+  light_states.fade_progress[channel] = (double)elapsed / record.fade_duration;
+  light_states.fade_delta[channel] = 1000.0 / (fps * (double)record.fade_duration);
+
+  // The LightRenderer computes the exact value on the next frame
+  light_states.fade_current[channel] = light_states.fade_start[channel] + (light_states.fade_end[channel] - light_states.fade_start[channel]) * light_states.fade_progress[channel];
+
+  LOGGER_DEBUG("[PERSISTENCY] Resuming fade, channel: " + std::to_string(channel) + ", progress: " + std::to_string(light_states.fade_progress[channel]), LOG_INFO);
+}
+
+/*
+ * Validates a binary snapshot and copies it into the light states
+ * Parameters:
+ *  - const unsigned char *data: mapped file contents
+ *  - size_t size: size of the file
+ *  - LightStates &light_states: reference to light states struct
+ *  - std::timed_mutex &light_states_lock reference to light states struct mutex
+ *  - int fps: frames per second of the LightRenderer
+ *  - uint32_t &generation: set to the generation of the snapshot
+ * Returns: true if succesful
+ */
+bool load_snapshot(const unsigned char *data, size_t size, LightStates &light_states, std::timed_mutex &light_states_lock, int fps, uint32_t &generation)
+{
+  const PersistencySnapshot *snapshot = (const PersistencySnapshot *)data;
+
+  // Check that the file is a complete snapshot of the right version
+  if (size != sizeof(PersistencySnapshot) ||
+      snapshot->header.version != PERSISTENCY_SNAPSHOT_VERSION ||
+      snapshot->header.channels != 512 ||
+      snapshot->header.payload_size != sizeof(snapshot->channels))
+  {
+    logger("[PERSISTENCY] Persistency file was written by different version of Lumize DMX Engine! Skipping...", LOG_WARN, false);
+    return false;
+  }
+
+  if (snapshot->header.checksum != persistency_crc32(snapshot->channels, sizeof(snapshot->channels)))
+  {
+    logger("[PERSISTENCY] Persistency file is corrupted! Skipping...", LOG_WARN, false);
+    return false;
+  }
+
+  light_states_lock.lock();
+  for (int i = 0; i < 512; i++)
+    restore_channel(light_states, i, snapshot->channels[i], fps);
+  light_states_lock.unlock();
+
+  generation = snapshot->header.generation;
+
+  return true;
+}
+
+/*
+ * Reads the generation of the snapshot currently on disk
+ * Parameters:
+ *  - std::string file_path: persistency file path
+ * Returns: generation, 0 if there's no valid snapshot
+ */
+uint32_t read_snapshot_generation(std::string file_path)
+{
+  PersistencySnapshotHeader header;
+  int fd;
+
+  if ((fd = open(file_path.c_str(), O_RDONLY)) < 0)
+    return 0;
+
+  ssize_t valread = read(fd, &header, sizeof(header));
+  close(fd);
+
+  if (valread != sizeof(header) || header.magic != PERSISTENCY_SNAPSHOT_MAGIC || header.version != PERSISTENCY_SNAPSHOT_VERSION)
+    return 0;
+
+  return header.generation;
+}
+
+/*
+ * Applies the journal records written after a snapshot. Replay stops
+ * at the first damaged record, which can only be a torn last write
+ * Parameters:
+ *  - std::string file_path: journal file path
+ *  - uint32_t generation: generation of the loaded snapshot
+ *  - LightStates &light_states: reference to light states struct
+ *  - std::timed_mutex &light_states_lock reference to light states struct mutex
+ *  - int fps: frames per second of the LightRenderer
+ */
+void replay_journal(std::string file_path, uint32_t generation, LightStates &light_states, std::timed_mutex &light_states_lock, int fps)
+{
+  struct stat file_stat;
+  const PersistencyJournalRecord *records;
+  size_t count, applied = 0;
+  int fd;
+
+  if ((fd = open(file_path.c_str(), O_RDONLY)) < 0)
+    return;
+
+  if (fstat(fd, &file_stat) < 0 || (count = file_stat.st_size / sizeof(PersistencyJournalRecord)) == 0)
+  {
+    close(fd);
+    return;
+  }
+
+  records = (const PersistencyJournalRecord *)mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (records == MAP_FAILED)
+    return;
+
+  light_states_lock.lock();
+  for (; applied < count; applied++)
+  {
+    const PersistencyJournalRecord &record = records[applied];
+
+    // Records of an older snapshot, left behind by an interrupted compaction
+    if (record.generation != generation)
+      break;
+
+    if (record.checksum != persistency_crc32(&record, offsetof(PersistencyJournalRecord, checksum)) || record.channel > 511)
+    {
+      logger("[PERSISTENCY] Damaged record in persistency journal, ignoring the rest", LOG_WARN, false);
+      break;
+    }
+
+    restore_channel(light_states, record.channel, record.record, fps);
+  }
+  light_states_lock.unlock();
+
+  munmap((void *)records, file_stat.st_size);
+
+  LOGGER_DEBUG("[PERSISTENCY] Replayed " + std::to_string(applied) + " journal records", LOG_INFO);
+}
+
 /*
  * Read data from persistency file and store it in light states struct
  * Parameters:
  *  - std::string file_path: persistency file path
  *  - LightStates &light_states: reference to light states struct
  *  - std::timed_mutex &light_states_lock reference to light states struct mutex
+ *  - int fps: frames per second of the LightRenderer, to resume fades
  * Returns: true if succesful
  */
-bool read_persistency_file(std::string file_path, LightStates &light_states, std::timed_mutex &light_states_lock)
+bool read_persistency_file(std::string file_path, LightStates &light_states, std::timed_mutex &light_states_lock, int fps)
 {
-  logger("[PERSISTENCY] Reading persistency file: " + file_path + "...", LOG_INFO, true);
+  LOGGER_DEBUG("[PERSISTENCY] Reading persistency file: " + file_path + "...", LOG_INFO);
 
-  std::string states_string;
+  struct stat file_stat;
+  const unsigned char *data;
+  uint32_t generation = 0;
+  bool success;
+  int fd;
 
   // Open file as read only
-  std::ifstream read_file(file_path);
+  if ((fd = open(file_path.c_str(), O_RDONLY)) < 0 || fstat(fd, &file_stat) < 0 || file_stat.st_size == 0)
+  {
+    logger("[PERSISTENCY] Unable to read persistency file");
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
 
-  // Read first line from file (it's all we need)
-  if (!getline(read_file, states_string))
+  // Map the whole file, it's read in a single pass
+  data = (const unsigned char *)mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED)
   {
     logger("[PERSISTENCY] Unable to read persistency file");
-    read_file.close();
     return false;
   }
 
-  // Close the file
-  read_file.close();
+  // Tell apart binary snapshots and files written by older versions
+  if ((size_t)file_stat.st_size >= sizeof(uint32_t) && *(const uint32_t *)data == PERSISTENCY_SNAPSHOT_MAGIC)
+    success = load_snapshot(data, file_stat.st_size, light_states, light_states_lock, fps, generation);
+  else
+  {
+    // Legacy text file: only the first line is needed
+    std::string states_string((const char *)data, file_stat.st_size);
+    states_string = states_string.substr(0, states_string.find('\n'));
+
+    success = parse_states_string(states_string, light_states, light_states_lock);
+  }
+
+  munmap((void *)data, file_stat.st_size);
 
-  // Parse states string
-  if (!parse_states_string(states_string, light_states, light_states_lock))
+  if (!success)
     return false;
 
-  logger("[PERSISTENCY] Succesfully read persistency file!", LOG_SUCC, true);
+  // Apply changes made after the snapshot was written
+  if (generation != 0)
+    replay_journal(file_path + PERSISTENCY_JOURNAL_FILE_SUFFIX, generation, light_states, light_states_lock, fps);
+
+  LOGGER_DEBUG("[PERSISTENCY] Succesfully read persistency file!", LOG_SUCC);
   return true;
 }
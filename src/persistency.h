@@ -11,49 +11,171 @@
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 #include <fstream>
 #include <vector>
 #include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+// POSIX file I/O
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // logger helper
 #include "logger.h"
 
 #include "lightstates.h"
+#include "statesnapshot.h"
+#include "metrics.h"
+#include "eventloop.h"
 
+// Legacy text persistency file
 #define PERSISTENCY_FILE_VERSION_STRING "2.0"
 
+// Binary persistency snapshot
+#define PERSISTENCY_SNAPSHOT_MAGIC 0x32455A4C // "LZE2" in little endian
+#define PERSISTENCY_SNAPSHOT_VERSION 5
+#define PERSISTENCY_TMP_FILE_SUFFIX ".tmp"
+
+// Journal of changes since the last snapshot
+#define PERSISTENCY_JOURNAL_FILE_SUFFIX ".journal"
+
+// Header at the beginning of the snapshot file. All fields are
+// stored in host byte order
+struct PersistencySnapshotHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t channels;     // Amount of channel records following the header
+  uint32_t generation;   // Incremented on every compaction, ties journal records to this snapshot
+  uint32_t payload_size; // Bytes following the header
+  uint32_t checksum;     // CRC-32 of the payload
+};
+
+// Channel record flags
+#define PERSISTENCY_FLAG_FADING 0x01        // Fade was in progress
+#define PERSISTENCY_FLAG_PUSHBUTTON_UP 0x02 // Direction of the last pushbutton fade
+#define PERSISTENCY_FLAG_FINE 0x04          // 16-bit fields are valid, not set by older versions
+
+// Fade curves
+#define PERSISTENCY_FADE_CURVE_EASE_IN_OUT_SINE 0
+
+// Persisted state of a single channel. Times are wall clock
+// milliseconds since epoch, so fades can be resumed after a restart
+struct PersistencyChannelRecord
+{
+  uint8_t state;
+  uint8_t brightness;
+  uint8_t fade_start;
+  uint8_t fade_end;
+  uint8_t fade_curve; // PERSISTENCY_FADE_CURVE_*
+  uint8_t flags;      // PERSISTENCY_FLAG_*
+  uint16_t brightness_fine; // 16-bit brightness, 0-65535
+  uint32_t fade_duration;   // ms
+  uint16_t fade_start_fine;
+  uint16_t fade_end_fine;
+  int64_t fade_start_time;
+  int64_t pushbutton_fade_end_time;
+};
+
+// Complete snapshot file
+struct PersistencySnapshot
+{
+  PersistencySnapshotHeader header;
+  PersistencyChannelRecord channels[512];
+};
+
+// Change of a single channel appended to the journal
+struct PersistencyJournalRecord
+{
+  uint32_t generation; // Generation of the snapshot this record applies to
+  uint16_t channel;
+  uint16_t reserved;
+  PersistencyChannelRecord record;
+  uint32_t checksum; // CRC-32 of the fields above
+  uint32_t reserved2;
+};
+
+uint32_t persistency_crc32(const void *data, size_t size);
+bool write_file_atomically(std::string file_path, const void *data, size_t size);
+uint32_t read_snapshot_generation(std::string file_path);
+void read_channel_records(StateSnapshot &state_snapshot, FadeSnapshot &fade_snapshot, PersistencyChannelRecord *channels);
+void restore_channel(LightStates &light_states, int channel, const PersistencyChannelRecord &record, int fps);
+
 /*
  * Definition of the PersistencyWriter class
  */
-class PersistencyWriter
+class PersistencyWriter : public EventHandler
 {
 public:
   // Methods
   bool start();
   void stop();
-  void configure(std::string file_path, int interval);
-  void set_light_states(LightStates &light_states, std::timed_mutex &light_states_lock);
-  std::condition_variable &get_cv();
+  void configure(std::string file_path, int interval, int compact_records, int debounce, int max_delay);
+  void set_state_snapshot(StateSnapshot &state_snapshot);
+  void set_fade_snapshot(FadeSnapshot &fade_snapshot);
+  void set_metrics(MetricsRegistry &metrics);
+  void mark_dirty(int channel);
+  void set_event_loop(EventLoop &event_loop);
+  void handle_event(int fd, uint32_t events);
 
 private:
   std::string file_path;
-  int interval;
+  int interval;        // Seconds between compactions
+  int compact_records; // Journal records that trigger a compaction
+  int debounce;        // ms without changes before writing
+  int max_delay;       // Max ms between the first change and the write
   bool running = true;          // Used to disconnect gracefully
   std::thread main_loop_thread; // Reference to the connection manager thread
   std::mutex main_loop_mutex;
   std::condition_variable main_loop_cv;
 
-  // Light states
-  LightStates *light_states;
-  std::timed_mutex *light_states_lock;
+  // Writes are scheduled with timers on the event loop instead of main_loop_thread
+  EventLoop *event_loop = NULL;
+  int debounce_timer = -1;
+  int compaction_timer = -1;
+  std::chrono::steady_clock::time_point first_change_time; // First change of the burst being debounced
+
+  // Published outward and fade states
+  StateSnapshot *state_snapshot;
+  FadeSnapshot *fade_snapshot;
+
+  // Channels changed since the last write, set by the TCP thread
+  std::atomic<uint64_t> dirty_channels[8] = {};
+  std::atomic<bool> dirty_pending{false};
+  std::atomic<unsigned long> dirty_marks{0}; // Incremented on every change, used for debouncing
+
+  // Persistency files state
+  PersistencySnapshot persisted; // States as stored by snapshot + journal
+  uint32_t generation = 0;       // Generation of the current snapshot
+  int journal_fd = -1;
+  int journal_records = 0; // Records appended since the last compaction
+  std::chrono::steady_clock::time_point last_compaction_time;
+
+  // Metrics
+  Counter *writes_counter;
+  Counter *write_errors_counter;
+  Counter *journal_records_counter;
+  Counter *compactions_counter;
+  Counter *changes_counter;
+  Histogram *write_duration_histogram;
+  Histogram *write_delay_histogram;
 
   // Internal functions
   void main_loop();
-  std::string generate_states_string();
-  void write_persistency_file();
+  void wait_for_changes(std::unique_lock<std::mutex> &lk);
+  void schedule_write();
+  void compact_if_needed();
+  void read_channel_records(PersistencyChannelRecord *channels);
+  bool append_journal();
+  bool compact_persistency_file();
 };
 
 /*
  * Definition of read_persistency_file function
  */
-bool read_persistency_file(std::string file_path, LightStates &light_states, std::timed_mutex &light_states_lock);
+bool read_persistency_file(std::string file_path, LightStates &light_states, std::timed_mutex &light_states_lock, int fps);
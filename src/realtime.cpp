@@ -0,0 +1,160 @@
+/*
+ * Filename: realtime.cpp
+ * Description: realtime scheduling, CPU pinning and memory locking helpers
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "realtime.h"
+
+/*
+ ********** HELPER FUNCTIONS **********
+ */
+
+/*
+ * Converts a realtime policy name to a scheduling policy
+ * Parameters:
+ *  - std::string policy: REALTIME_POLICY_*
+ * Returns: SCHED_FIFO, SCHED_RR or SCHED_OTHER
+ */
+static int get_sched_policy(std::string policy)
+{
+   if (policy == REALTIME_POLICY_FIFO)
+      return SCHED_FIFO;
+   if (policy == REALTIME_POLICY_RR)
+      return SCHED_RR;
+   return SCHED_OTHER;
+}
+
+/*
+ * Converts a scheduling policy to a readable name
+ * Parameters:
+ *  - int sched_policy: SCHED_* policy
+ * Returns: name of the policy
+ */
+static std::string get_sched_policy_name(int sched_policy)
+{
+   switch (sched_policy)
+   {
+   case SCHED_FIFO:
+      return "SCHED_FIFO";
+   case SCHED_RR:
+      return "SCHED_RR";
+   case SCHED_OTHER:
+      return "SCHED_OTHER";
+   default:
+      return "policy " + std::to_string(sched_policy);
+   }
+}
+
+/*
+ * Reads the amount of locked memory of the process
+ * Returns: the VmLck line of /proc/self/status, empty if not found
+ */
+static std::string get_locked_memory()
+{
+   std::ifstream file("/proc/self/status");
+   std::string line;
+
+   while (getline(file, line))
+      if (line.compare(0, 6, "VmLck:") == 0 && line.find_first_not_of(" \t", 6) != std::string::npos)
+         return line.substr(line.find_first_not_of(" \t", 6));
+
+   return "";
+}
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Locks all current and future memory of the process, so that
+ * realtime threads never wait for a page to be loaded
+ * Returns: true if succesful
+ */
+bool lock_process_memory()
+{
+   if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+   {
+      logger("[RT] Unable to lock memory: " + std::string(strerror(errno)), LOG_WARN, false);
+      return false;
+   }
+
+   logger("[RT] Memory locked (" + get_locked_memory() + ")", LOG_SUCC, false);
+   return true;
+}
+
+/*
+ * Touches the stack of the calling thread, so that its pages are
+ * already mapped when the thread needs them
+ */
+void prefault_stack()
+{
+   unsigned char stack[REALTIME_STACK_PREFAULT_SIZE];
+
+   memset(stack, 0, sizeof(stack));
+
+   // Keep the compiler from removing the memset
+   __asm__ __volatile__("" : : "r"(stack) : "memory");
+}
+
+/*
+ * Applies scheduling settings to the calling thread, then checks that
+ * they took effect and reports the result
+ * Parameters:
+ *  - std::string thread_name: name of the thread used in the report
+ *  - const RealtimeSettings &settings: settings to apply
+ * Returns: true if all settings took effect
+ */
+bool setup_realtime_thread(std::string thread_name, const RealtimeSettings &settings)
+{
+   struct sched_param param;
+   int sched_policy = get_sched_policy(settings.policy);
+   int current_policy = -1, error;
+   cpu_set_t cpus;
+   bool success = true;
+
+   // Nothing to do
+   if (sched_policy == SCHED_OTHER && settings.cpu < 0)
+      return true;
+
+   // Scheduling policy
+   if (sched_policy != SCHED_OTHER)
+   {
+      param.sched_priority = settings.priority;
+      if ((error = pthread_setschedparam(pthread_self(), sched_policy, &param)) != 0)
+         logger("[RT] Unable to set " + get_sched_policy_name(sched_policy) + " on " + thread_name + " thread: " + strerror(error), LOG_WARN, false);
+   }
+
+   // CPU pinning
+   if (settings.cpu >= 0)
+   {
+      CPU_ZERO(&cpus);
+      CPU_SET(settings.cpu, &cpus);
+      if ((error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) != 0)
+         logger("[RT] Unable to pin " + thread_name + " thread to CPU " + std::to_string(settings.cpu) + ": " + strerror(error), LOG_WARN, false);
+   }
+
+   // Check what the thread actually got
+   param.sched_priority = 0;
+   if (pthread_getschedparam(pthread_self(), &current_policy, &param) != 0 ||
+       current_policy != sched_policy || (sched_policy != SCHED_OTHER && param.sched_priority != settings.priority))
+      success = false;
+
+   CPU_ZERO(&cpus);
+   if (pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0 ||
+       (settings.cpu >= 0 && (!CPU_ISSET(settings.cpu, &cpus) || CPU_COUNT(&cpus) != 1)))
+      success = false;
+
+   if (success)
+      logger("[RT] " + thread_name + " thread running with " + get_sched_policy_name(current_policy) +
+                 (sched_policy != SCHED_OTHER ? " priority " + std::to_string(param.sched_priority) : "") +
+                 (settings.cpu >= 0 ? " on CPU " + std::to_string(settings.cpu) : ""),
+             LOG_SUCC, false);
+   else
+      logger("[RT] " + thread_name + " thread settings did not take effect, running with " + get_sched_policy_name(current_policy) +
+                 " priority " + std::to_string(param.sched_priority) + " on " + std::to_string(CPU_COUNT(&cpus)) + " CPUs",
+             LOG_WARN, false);
+
+   return success;
+}
@@ -0,0 +1,33 @@
+/*
+ * Filename: realtime.h
+ * Description: realtime scheduling, CPU pinning and memory locking helpers
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "configreader.h"
+#include "logger.h"
+
+#define REALTIME_STACK_PREFAULT_SIZE (256 * 1024) // bytes of stack touched by realtime threads
+
+// Scheduling settings of a thread
+struct RealtimeSettings
+{
+   std::string policy = REALTIME_POLICY_NONE; // REALTIME_POLICY_*
+   int priority = 0;                          // 1-99, used with fifo and rr
+   int cpu = -1;                              // CPU to pin the thread to, -1 to not pin it
+};
+
+bool lock_process_memory();
+void prefault_stack();
+bool setup_realtime_thread(std::string thread_name, const RealtimeSettings &settings);
@@ -0,0 +1,226 @@
+/*
+ * Filename: scenestore.cpp
+ * Description: implementation of the SceneStore class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "scenestore.h" // Include definition of class to be implemented
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Configure the scene store
+ * Parameters:
+ *  - std::string file_path: path of the scenes file
+ */
+void SceneStore::configure(std::string file_path)
+{
+   this->file_path = file_path;
+}
+
+/*
+ * Reads the saved scenes from the scenes file
+ * Returns: false if the file exists but couldn't be read
+ */
+bool SceneStore::load()
+{
+   ScenesFileHeader header;
+   std::vector<SceneRecord> records;
+   struct stat file_stat;
+   int fd;
+
+   scenes.clear();
+
+   if ((fd = open(file_path.c_str(), O_RDONLY)) < 0)
+   {
+      if (errno != ENOENT)
+      {
+         logger("[SCENES] Unable to open scenes file " + file_path + "!", LOG_ERR, false);
+         return false;
+      }
+
+      LOGGER_DEBUG("[SCENES] No scenes file, starting with no scenes", LOG_INFO);
+      return true;
+   }
+
+   if (fstat(fd, &file_stat) < 0 || (size_t)file_stat.st_size < sizeof(header) ||
+       read(fd, &header, sizeof(header)) != sizeof(header) ||
+       header.magic != SCENES_FILE_MAGIC || header.version != SCENES_FILE_VERSION ||
+       header.scenes > SCENES_MAX || header.payload_size != header.scenes * sizeof(SceneRecord) ||
+       (size_t)file_stat.st_size != sizeof(header) + header.payload_size)
+   {
+      logger("[SCENES] Scenes file " + file_path + " is not valid!", LOG_ERR, false);
+      close(fd);
+      return false;
+   }
+
+   records.resize(header.scenes);
+   if (header.scenes > 0 && read(fd, records.data(), header.payload_size) != (ssize_t)header.payload_size)
+   {
+      logger("[SCENES] Unable to read scenes file " + file_path + "!", LOG_ERR, false);
+      close(fd);
+      return false;
+   }
+   close(fd);
+
+   if (header.checksum != persistency_crc32(records.data(), header.payload_size))
+   {
+      logger("[SCENES] Scenes file " + file_path + " is corrupted!", LOG_ERR, false);
+      return false;
+   }
+
+   for (size_t i = 0; i < records.size(); i++)
+   {
+      Scene &scene = scenes[std::string(records[i].name, strnlen(records[i].name, sizeof(records[i].name)))];
+
+      for (int channel = 0; channel < 512; channel++)
+      {
+         scene.state[channel] = records[i].state[channel / 8] & (1 << (channel % 8));
+         scene.brightness[channel] = records[i].brightness[channel];
+      }
+   }
+
+   logger("[SCENES] Loaded " + std::to_string(scenes.size()) + " scenes", LOG_INFO, false);
+   return true;
+}
+
+/*
+ * Saves a scene, replacing the one with the same name if any
+ * Parameters:
+ *  - const std::string &name: name of the scene, must be valid
+ *  - const Scene &scene: outward states to save
+ * Returns: true if the scene was saved and written to the scenes file
+ */
+bool SceneStore::save(const std::string &name, const Scene &scene)
+{
+   std::map<std::string, Scene>::iterator existing = scenes.find(name);
+   Scene previous;
+
+   if (existing == scenes.end())
+   {
+      if (scenes.size() >= SCENES_MAX)
+      {
+         LOGGER_DEBUG("[SCENES] Maximum amount of scenes reached!", LOG_WARN);
+         return false;
+      }
+
+      scenes[name] = scene;
+      if (write_file())
+         return true;
+
+      scenes.erase(name);
+      return false;
+   }
+
+   previous = existing->second;
+   existing->second = scene;
+   if (write_file())
+      return true;
+
+   // Keep memory in line with the file
+   existing->second = previous;
+   return false;
+}
+
+/*
+ * Deletes a scene
+ * Parameters:
+ *  - const std::string &name: name of the scene
+ * Returns: false if the scene doesn't exist or the scenes file couldn't be written
+ */
+bool SceneStore::remove(const std::string &name)
+{
+   std::map<std::string, Scene>::iterator existing = scenes.find(name);
+   Scene previous;
+
+   if (existing == scenes.end())
+      return false;
+
+   previous = existing->second;
+   scenes.erase(existing);
+   if (write_file())
+      return true;
+
+   scenes[name] = previous;
+   return false;
+}
+
+/*
+ * Looks up a scene
+ * Parameters:
+ *  - const std::string &name: name of the scene
+ * Returns: the scene, NULL if it doesn't exist
+ */
+const Scene *SceneStore::find(const std::string &name)
+{
+   std::map<std::string, Scene>::iterator existing = scenes.find(name);
+
+   return existing == scenes.end() ? NULL : &existing->second;
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+/*
+ * Writes all scenes to the scenes file
+ * Returns: true if succesful
+ */
+bool SceneStore::write_file()
+{
+   std::vector<uint8_t> data(sizeof(ScenesFileHeader) + scenes.size() * sizeof(SceneRecord), 0);
+   ScenesFileHeader *header = (ScenesFileHeader *)data.data();
+   SceneRecord *records = (SceneRecord *)(data.data() + sizeof(ScenesFileHeader));
+   int i = 0;
+
+   for (std::map<std::string, Scene>::iterator scene = scenes.begin(); scene != scenes.end(); scene++, i++)
+   {
+      memcpy(records[i].name, scene->first.c_str(), scene->first.length());
+
+      for (int channel = 0; channel < 512; channel++)
+      {
+         if (scene->second.state[channel])
+            records[i].state[channel / 8] |= 1 << (channel % 8);
+         records[i].brightness[channel] = scene->second.brightness[channel];
+      }
+   }
+
+   header->magic = SCENES_FILE_MAGIC;
+   header->version = SCENES_FILE_VERSION;
+   header->scenes = scenes.size();
+   header->payload_size = scenes.size() * sizeof(SceneRecord);
+   header->checksum = persistency_crc32(records, header->payload_size);
+
+   if (!write_file_atomically(file_path, data.data(), data.size()))
+   {
+      logger("[SCENES] Unable to write scenes file " + file_path + "!", LOG_ERR, false);
+      return false;
+   }
+
+   return true;
+}
+
+/*
+ ********** HELPER FUNCTIONS **********
+ */
+
+/*
+ * Checks if a string can be used as a scene name
+ * Parameters:
+ *  - const std::string &name: scene name
+ * Returns: true if it only contains letters, digits, '-' and '_'
+ */
+bool is_valid_scene_name(const std::string &name)
+{
+   if (name.empty() || name.length() > SCENE_NAME_MAX_LENGTH)
+      return false;
+
+   for (size_t i = 0; i < name.length(); i++)
+      if (!isalnum((unsigned char)name[i]) && name[i] != '-' && name[i] != '_')
+         return false;
+
+   return true;
+}
@@ -0,0 +1,84 @@
+/*
+ * Filename: scenestore.h
+ * Description: interface for the SceneStore class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <cctype>
+#include <errno.h>
+
+// POSIX file I/O
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "persistency.h"
+#include "logger.h"
+
+// Binary scenes file
+#define SCENES_FILE_MAGIC 0x43535A4C // "LZSC" in little endian
+#define SCENES_FILE_VERSION 1
+#define SCENE_NAME_MAX_LENGTH 31
+#define SCENES_MAX 256
+
+// Header at the beginning of the scenes file. All fields are
+// stored in host byte order
+struct ScenesFileHeader
+{
+   uint32_t magic;
+   uint16_t version;
+   uint16_t scenes;       // Amount of scene records following the header
+   uint32_t payload_size; // Bytes following the header
+   uint32_t checksum;     // CRC-32 of the payload
+};
+
+// Scene as stored in the scenes file
+struct SceneRecord
+{
+   char name[SCENE_NAME_MAX_LENGTH + 1]; // Zero padded
+   uint8_t state[64];                    // One bit per channel
+   uint8_t brightness[512];
+};
+
+// Outward states of all channels captured by a scene
+struct Scene
+{
+   bool state[512];
+   int brightness[512];
+};
+
+bool is_valid_scene_name(const std::string &name);
+
+/*
+ * Definition of the SceneStore class
+ *
+ * Keeps the saved scenes in memory, so that recalling one never touches
+ * the disk, and writes them to the scenes file every time one is saved
+ * or deleted. Must only be used by the TCPServer
+ */
+class SceneStore
+{
+public:
+   // Methods
+   void configure(std::string file_path);
+   bool load();
+   bool save(const std::string &name, const Scene &scene);
+   bool remove(const std::string &name);
+   const Scene *find(const std::string &name);
+
+private:
+   std::string file_path;
+   std::map<std::string, Scene> scenes;
+
+   // Internal functions
+   bool write_file();
+};
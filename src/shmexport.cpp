@@ -0,0 +1,131 @@
+/*
+ * Filename: shmexport.cpp
+ * Description: implementation of the ShmExporter class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "shmexport.h" // Include definition of class to be implemented
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Creates or reuses the shared memory segment. Readers keep their
+ * mapping across engine restarts and handovers
+ * Returns: true if succesful
+ */
+bool ShmExporter::start()
+{
+   int fd;
+   void *mapping;
+
+   if ((fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644)) < 0)
+   {
+      logger("[SHM] Unable to open shared memory segment " + name + "!", LOG_ERR, false);
+      return false;
+   }
+
+   // Readers only map the size of the segment they know
+   fchmod(fd, 0644);
+   if (ftruncate(fd, sizeof(LumizeShmSegment)) < 0 ||
+       (mapping = mmap(NULL, sizeof(LumizeShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+   {
+      logger("[SHM] Unable to map shared memory segment " + name + "!", LOG_ERR, false);
+      close(fd);
+      return false;
+   }
+
+   close(fd);
+   segment = (LumizeShmSegment *)mapping;
+
+   // New segment, or left behind by an incompatible version
+   if (segment->magic != LUMIZE_SHM_MAGIC || segment->version != LUMIZE_SHM_VERSION)
+   {
+      memset((void *)segment, 0, sizeof(LumizeShmSegment));
+      segment->magic = LUMIZE_SHM_MAGIC;
+      segment->version = LUMIZE_SHM_VERSION;
+   }
+
+   // A previous engine could have died while writing a frame
+   if (segment->sequence.load(std::memory_order_relaxed) % 2 != 0)
+      segment->sequence.fetch_add(1, std::memory_order_release);
+
+   segment->pid.store(getpid(), std::memory_order_relaxed);
+
+   logger("[SHM] Exporting live universe to /dev/shm" + name, LOG_SUCC, false);
+   return true;
+}
+
+/*
+ * Stops exporting. The segment is left in place for readers, marked
+ * as not being written anymore unless a new process took it over
+ */
+void ShmExporter::stop()
+{
+   int32_t pid = getpid();
+
+   if (!segment)
+      return;
+
+   segment->pid.compare_exchange_strong(pid, 0);
+
+   munmap((void *)segment, sizeof(LumizeShmSegment));
+   segment = NULL;
+}
+
+/*
+ * Configure the exporter
+ * Parameters:
+ *  - std::string name: name of the shared memory segment
+ */
+void ShmExporter::configure(std::string name)
+{
+   this->name = name;
+}
+
+/*
+ * Give ShmExporter access to the published outward states
+ * Parameters:
+ *  - StateSnapshot &state_snapshot: reference to state snapshot
+ */
+void ShmExporter::set_state_snapshot(StateSnapshot &state_snapshot)
+{
+   this->state_snapshot = &state_snapshot;
+}
+
+/*
+ * Publishes a frame. Must only be called by the rendering thread
+ * Parameters:
+ *  - const unsigned char *dmx_frame: values of the 512 channels
+ *  - int channels: channels sent to the FTDI chip
+ *  - int fps: frames per second the frame was rendered at
+ */
+void ShmExporter::publish(const unsigned char *dmx_frame, int channels, int fps)
+{
+   uint32_t sequence;
+
+   if (!segment)
+      return;
+
+   // Take outward states only when the TCPServer changed them
+   if (state_snapshot->get_generation() != states_generation)
+      states_generation = state_snapshot->read(states);
+
+   // Mark frame as being written
+   sequence = segment->sequence.load(std::memory_order_relaxed);
+   segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+
+   segment->frame.channels = channels;
+   segment->frame.fps = fps;
+   segment->frame.frame_count++;
+   segment->frame.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+   memcpy(segment->frame.dmx, dmx_frame, 512);
+   memcpy(segment->frame.outward_state, states.state, 512);
+   memcpy(segment->frame.outward_brightness, states.brightness, 512);
+
+   // Frame is consistent again
+   segment->sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,49 @@
+/*
+ * Filename: shmexport.h
+ * Description: interface for the ShmExporter class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// POSIX shared memory
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "lumizeshm.h"
+#include "statesnapshot.h"
+#include "logger.h"
+
+/*
+ * Definition of the ShmExporter class
+ *
+ * Publishes every rendered DMX frame and the outward states into a
+ * POSIX shared memory segment, for local readers using lumizeshm.h
+ */
+class ShmExporter
+{
+public:
+   // Methods
+   bool start();
+   void stop();
+   void configure(std::string name);
+   void set_state_snapshot(StateSnapshot &state_snapshot);
+   void publish(const unsigned char *dmx_frame, int channels, int fps);
+
+private:
+   std::string name;
+   LumizeShmSegment *segment = NULL;
+
+   // Outward states published by the TCPServer
+   StateSnapshot *state_snapshot;
+   OutwardStates states;
+   unsigned long states_generation = 0;
+};
@@ -0,0 +1,377 @@
+/*
+ * Filename: sourcemerger.cpp
+ * Description: implementation of the SourceMerger class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "sourcemerger.h" // Include definition of class to be implemented
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Configure the source merger. Must only be called by the rendering
+ * thread, or before it's started
+ * Parameters:
+ *  - int fps: frames per second of the LightRenderer
+ *  - const std::array<bool, 512> *ltp_channels: channels merged latest takes precedence
+ *  - int main_priority: priority of the main source
+ */
+void SourceMerger::configure(int fps, const std::array<bool, 512> *ltp_channels, int main_priority)
+{
+   // Fades in progress keep their duration
+   if (this->fps != 0 && fps != this->fps)
+      for (int i = 0; i < SOURCES_MAX; i++)
+         for (int j = 0; j < 512; j++)
+            layers[i].fade_delta[j] = layers[i].fade_delta[j] * this->fps / fps;
+
+   this->fps = fps;
+   this->ltp_channels = ltp_channels;
+   this->main_priority = main_priority;
+}
+
+/*
+ * Opens a named source, creating it if it doesn't exist
+ * Parameters:
+ *  - const std::string &name: name of the source, must be valid
+ *  - bool has_priority: change the priority of an existing source
+ *  - int priority: priority of the source, 0 to SOURCE_PRIORITY_MAX
+ * Returns: id of the source, -1 if SOURCES_MAX sources already exist
+ */
+int SourceMerger::open_source(const std::string &name, bool has_priority, int priority)
+{
+   std::map<std::string, int>::iterator existing = source_ids.find(name);
+   SourceCommand command;
+   bool is_free[SOURCES_MAX];
+
+   command.type = SOURCE_COMMAND_OPEN;
+   command.priority = has_priority ? priority : SOURCE_DEFAULT_PRIORITY;
+
+   if (existing != source_ids.end())
+   {
+      if (has_priority)
+      {
+         command.source = existing->second;
+         queue(command);
+      }
+
+      return existing->second;
+   }
+
+   if (source_ids.size() >= SOURCES_MAX)
+      return -1;
+
+   // Take the first free id
+   std::fill(is_free, is_free + SOURCES_MAX, true);
+   for (existing = source_ids.begin(); existing != source_ids.end(); existing++)
+      is_free[existing->second] = false;
+
+   command.source = std::find(is_free, is_free + SOURCES_MAX, true) - is_free;
+   source_ids[name] = command.source;
+   std::fill(brightness[command.source], brightness[command.source] + 512, 255.0);
+   queue(command);
+
+   return command.source;
+}
+
+/*
+ * Removes a named source, its channels go back to the other sources
+ * Parameters:
+ *  - const std::string &name: name of the source
+ * Returns: id the source had, -1 if it doesn't exist
+ */
+int SourceMerger::remove_source(const std::string &name)
+{
+   std::map<std::string, int>::iterator existing = source_ids.find(name);
+   SourceCommand command;
+
+   if (existing == source_ids.end())
+      return -1;
+
+   command.type = SOURCE_COMMAND_REMOVE;
+   command.source = existing->second;
+   source_ids.erase(existing);
+   queue(command);
+
+   return command.source;
+}
+
+/*
+ * Queues fades on the layer of a source. The LightRenderer starts all
+ * of them on the next frame
+ * Parameters:
+ *  - int source: id of the source
+ *  - int count: number of channels
+ *  - const int *channels: channels to fade
+ *  - const LightCommand *commands: command for each channel
+ */
+void SourceMerger::push_fades(int source, int count, const int *channels, const LightCommand *commands)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   for (int i = 0; i < count; i++)
+   {
+      SourceCommand command;
+
+      command.type = SOURCE_COMMAND_FADE;
+      command.source = source;
+      command.channel = channels[i];
+      command.command = commands[i];
+      pending.push_back(command);
+
+      if (commands[i].type == LIGHT_COMMAND_ON)
+         brightness[source][channels[i]] = commands[i].brightness;
+   }
+
+   has_pending.store(true, std::memory_order_release);
+}
+
+/*
+ * Makes a source stop contributing to channels
+ * Parameters:
+ *  - int source: id of the source
+ *  - int count: number of channels
+ *  - const int *channels: channels to release
+ */
+void SourceMerger::release(int source, int count, const int *channels)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   for (int i = 0; i < count; i++)
+   {
+      SourceCommand command;
+
+      command.type = SOURCE_COMMAND_RELEASE;
+      command.source = source;
+      command.channel = channels[i];
+      pending.push_back(command);
+   }
+
+   has_pending.store(true, std::memory_order_release);
+}
+
+/*
+ * Gets the brightness a source last turned a channel on to
+ * Parameters:
+ *  - int source: id of the source
+ *  - int channel: channel
+ * Returns: brightness between 0 and 255
+ */
+double SourceMerger::get_brightness(int source, int channel)
+{
+   return brightness[source][channel];
+}
+
+/*
+ * Records a change of the main source, for LTP channels. Must only be
+ * called by the rendering thread
+ * Parameters:
+ *  - int channel: channel that changed
+ */
+void SourceMerger::mark_main_changed(int channel)
+{
+   main_stamp[channel] = ++clock;
+}
+
+/*
+ * Renders the named sources and merges them into the fade layer. Must
+ * only be called by the rendering thread, once per frame
+ * Parameters:
+ *  - double *levels: fade layer value of each of the 512 channels, replaced with the merged values
+ */
+void SourceMerger::render(double *levels)
+{
+   // Only take the lock when the TCPServer changed something
+   if (has_pending.load(std::memory_order_acquire))
+      apply_pending(levels);
+
+   // Fade layer is the output as is
+   if (used_layers == 0)
+   {
+      merged_valid = false;
+      return;
+   }
+
+   // Main source wins everywhere until a source beats it
+   std::fill(merge_priority, merge_priority + 512, main_priority);
+   memcpy(merge_stamp, main_stamp, sizeof(merge_stamp));
+
+   for (int i = 0; i < SOURCES_MAX; i++)
+   {
+      if (!layers[i].used)
+         continue;
+
+      advance_fades(layers[i]);
+      merge_layer(layers[i], levels);
+   }
+
+   // New fades of sources start from what is being output
+   memcpy(merged, levels, sizeof(merged));
+   merged_valid = true;
+}
+
+/*
+ * Give SourceMerger access to the metrics registry and register its metrics
+ * Parameters:
+ *  - MetricsRegistry &metrics: reference to metrics registry
+ */
+void SourceMerger::set_metrics(MetricsRegistry &metrics)
+{
+   sources_gauge = &metrics.add_gauge("lumize_sources_active", "Named sources merged with the main source");
+}
+
+/*
+ ********** PRIVATE FUNCTIONS **********
+ */
+
+/*
+ * Queues a change for the rendering thread
+ * Parameters:
+ *  - const SourceCommand &command: change to queue
+ */
+void SourceMerger::queue(const SourceCommand &command)
+{
+   std::lock_guard<std::mutex> lk(lock);
+
+   pending.push_back(command);
+   has_pending.store(true, std::memory_order_release);
+}
+
+/*
+ * Applies the changes requested since last frame, in order
+ * Parameters:
+ *  - const double *levels: fade layer of the current frame
+ */
+void SourceMerger::apply_pending(const double *levels)
+{
+   // Keep the lock only for the swap, the vectors keep their capacity
+   {
+      std::lock_guard<std::mutex> lk(lock);
+
+      applying.swap(pending);
+      has_pending.store(false, std::memory_order_relaxed);
+   }
+
+   for (size_t i = 0; i < applying.size(); i++)
+   {
+      const SourceCommand &command = applying[i];
+      SourceLayer &layer = layers[command.source];
+      const int channel = command.channel;
+
+      switch (command.type)
+      {
+      case SOURCE_COMMAND_OPEN:
+         if (!layer.used)
+         {
+            layer.used = true;
+            std::fill(layer.active, layer.active + 512, false);
+            std::fill(layer.fade_delta, layer.fade_delta + 512, 0.0);
+            used_layers++;
+         }
+         layer.priority = command.priority;
+         break;
+
+      case SOURCE_COMMAND_REMOVE:
+         layer.used = false;
+         used_layers--;
+         break;
+
+      case SOURCE_COMMAND_FADE:
+         // A channel the source didn't contribute to starts from the output
+         if (!layer.active[channel])
+            layer.level[channel] = merged_valid ? merged[channel] : levels[channel];
+
+         layer.active[channel] = true;
+         layer.stamp[channel] = ++clock;
+         layer.fade_start[channel] = layer.level[channel];
+         layer.fade_end[channel] = command.command.type == LIGHT_COMMAND_ON ? command.command.brightness : 0;
+         layer.fade_progress[channel] = 0;
+         layer.fade_delta[channel] = 1000.0 / (fps * command.command.transition);
+         break;
+
+      case SOURCE_COMMAND_RELEASE:
+         layer.active[channel] = false;
+         layer.fade_delta[channel] = 0;
+         break;
+      }
+   }
+
+   applying.clear();
+   sources_gauge->set(used_layers);
+}
+
+/*
+ * Advances the fades of a source layer by one frame
+ * Parameters:
+ *  - SourceLayer &layer: layer to advance
+ */
+void SourceMerger::advance_fades(SourceLayer &layer)
+{
+   for (int i = 0; i < 512; i++)
+   {
+      // No fade active
+      if (layer.fade_delta[i] == 0)
+         continue;
+
+      layer.fade_progress[i] += layer.fade_delta[i];
+
+      // Fade is finished
+      if (layer.fade_progress[i] > 1)
+      {
+         layer.fade_delta[i] = 0;
+         layer.level[i] = layer.fade_end[i];
+      }
+      else
+         layer.level[i] = (layer.fade_end[i] - layer.fade_start[i]) * ease_in_out_sine(layer.fade_progress[i]) + layer.fade_start[i];
+   }
+}
+
+/*
+ * Merges a source layer into the output. Branchless pass over contiguous
+ * arrays, so that the compiler can vectorize it
+ * Parameters:
+ *  - const SourceLayer &layer: layer to merge
+ *  - double *levels: output merged so far, updated in place
+ */
+void SourceMerger::merge_layer(const SourceLayer &layer, double *levels)
+{
+   const bool *ltp = ltp_channels->data();
+   const int priority = layer.priority;
+
+   for (int i = 0; i < 512; i++)
+   {
+      const bool higher = priority > merge_priority[i];
+      const bool same = priority == merge_priority[i];
+      const bool later = layer.stamp[i] > merge_stamp[i];
+      const bool brighter = layer.level[i] > levels[i];
+      const bool wins = layer.active[i] & (higher | (same & (ltp[i] ? later : brighter)));
+
+      levels[i] = wins ? layer.level[i] : levels[i];
+      merge_priority[i] = wins ? priority : merge_priority[i];
+      merge_stamp[i] = wins ? layer.stamp[i] : merge_stamp[i];
+   }
+}
+
+/*
+ ********** HELPER FUNCTIONS **********
+ */
+
+/*
+ * Checks if a string can be used as a source name
+ * Parameters:
+ *  - const std::string &name: source name
+ * Returns: true if it starts with a letter and only contains letters, digits, '-' and '_'
+ */
+bool is_valid_source_name(const std::string &name)
+{
+   if (name.empty() || name.length() > SOURCE_NAME_MAX_LENGTH || !isalpha((unsigned char)name[0]))
+      return false;
+
+   for (size_t i = 0; i < name.length(); i++)
+      if (!isalnum((unsigned char)name[i]) && name[i] != '-' && name[i] != '_')
+         return false;
+
+   return true;
+}
@@ -0,0 +1,120 @@
+/*
+ * Filename: sourcemerger.h
+ * Description: interface for the SourceMerger class
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+#include "lightstates.h"
+#include "commandqueue.h"
+#include "metrics.h"
+
+#define SOURCES_MAX 16 // Named sources that can exist at the same time
+#define SOURCE_NAME_MAX_LENGTH 31
+#define SOURCE_PRIORITY_MAX 255
+#define SOURCE_DEFAULT_PRIORITY 100
+#define SOURCE_MAIN_NAME "main" // Layer of the light states, always present
+
+// Changes to a source layer, applied by the rendering thread
+#define SOURCE_COMMAND_OPEN 0    // Create the source or change its priority
+#define SOURCE_COMMAND_REMOVE 1  // Release all channels and free the source
+#define SOURCE_COMMAND_FADE 2    // Start the fade in command on the channel
+#define SOURCE_COMMAND_RELEASE 3 // Stop contributing to the channel
+
+struct SourceCommand
+{
+   int type; // SOURCE_COMMAND_*
+   int source;
+   int channel;
+   int priority;
+   LightCommand command;
+};
+
+bool is_valid_source_name(const std::string &name);
+
+/*
+ * Definition of the SourceMerger class
+ *
+ * Every named source renders its own fades into a separate layer. Each
+ * frame the LightRenderer merges them with the fade layer of the light
+ * states, the main source: on every channel the highest priority source
+ * wins, sources of the same priority are merged highest takes precedence
+ * or, on LTP channels, latest takes precedence. Sources are opened and
+ * given commands by the TCPServer only
+ */
+class SourceMerger
+{
+public:
+   // Methods
+   void configure(int fps, const std::array<bool, 512> *ltp_channels, int main_priority);
+   int open_source(const std::string &name, bool has_priority, int priority);
+   int remove_source(const std::string &name);
+   void push_fades(int source, int count, const int *channels, const LightCommand *commands);
+   void release(int source, int count, const int *channels);
+   double get_brightness(int source, int channel);
+   void mark_main_changed(int channel);
+   void render(double *levels);
+   void set_metrics(MetricsRegistry &metrics);
+
+private:
+   // Sources known to the TCPServer
+   std::map<std::string, int> source_ids;
+   double brightness[SOURCES_MAX][512]; // Last brightness each source turned channels on to
+
+   // Changes requested since last frame, taken by the rendering thread
+   std::mutex lock;
+   std::vector<SourceCommand> pending, applying;
+   std::atomic<bool> has_pending{false};
+
+   // Source layers, only used by the rendering thread
+   struct SourceLayer
+   {
+      bool used = false;
+      int priority;
+      bool active[512]; // Source contributes to the channel
+      uint32_t stamp[512]; // Clock value of the last change, for LTP
+      double level[512];
+      double fade_start[512];
+      double fade_end[512];
+      double fade_progress[512];
+      double fade_delta[512];
+   };
+   SourceLayer layers[SOURCES_MAX];
+   int used_layers = 0;
+   uint32_t clock = 0;            // Orders changes of all sources
+   uint32_t main_stamp[512] = {}; // Clock value of the last change of the main source
+
+   // Winner of each channel while merging
+   int merge_priority[512];
+   uint32_t merge_stamp[512];
+   double merged[512];        // Output of the last merged frame
+   bool merged_valid = false; // Sources were merged in the last frame
+
+   // Config
+   int fps = 0;
+   const std::array<bool, 512> *ltp_channels;
+   int main_priority;
+
+   // Metrics
+   Gauge *sources_gauge;
+
+   // Internal functions
+   void queue(const SourceCommand &command);
+   void apply_pending(const double *levels);
+   void advance_fades(SourceLayer &layer);
+   void merge_layer(const SourceLayer &layer, double *levels);
+};
@@ -0,0 +1,65 @@
+/*
+ * Filename: statesnapshot.cpp
+ * Description: implementation of the StateSnapshot and FadeSnapshot classes
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#include "statesnapshot.h" // Include definition of class to be implemented
+
+/*
+ ********** PUBLIC FUNCTIONS **********
+ */
+
+/*
+ * Publishes the current outward-facing states. Must only be called
+ * by the thread that writes them
+ * Parameters:
+ *  - const LightStates &light_states: reference to light states struct
+ */
+void StateSnapshot::publish(const LightStates &light_states)
+{
+   OutwardStates states;
+
+   for (int i = 0; i < 512; i++)
+   {
+      states.state[i] = light_states.outward_state[i];
+      states.brightness[i] = light_states.outward_brightness[i];
+      states.brightness_fine[i] = light_states.outward_brightness_fine[i];
+   }
+
+   DoubleBuffer<OutwardStates>::publish(states);
+}
+
+/*
+ * Publishes the current fade states. Must be called with light_states_lock held
+ * Parameters:
+ *  - const LightStates &light_states: reference to light states struct
+ */
+void FadeSnapshot::publish(const LightStates &light_states)
+{
+   FadeStates states;
+   std::chrono::system_clock::time_point system_now = std::chrono::system_clock::now();
+   std::chrono::steady_clock::time_point steady_now = std::chrono::steady_clock::now();
+
+   memset(&states, 0, sizeof(states));
+
+   for (int i = 0; i < 512; i++)
+   {
+      ChannelFade &fade = states.channels[i];
+
+      fade.fading = light_states.fade_delta[i] != 0;
+      fade.fade_start = std::lround(light_states.fade_start[i] * 257);
+      fade.fade_end = std::lround(light_states.fade_end[i] * 257);
+      fade.fade_duration = light_states.fade_duration[i];
+      fade.fade_start_time = std::chrono::duration_cast<std::chrono::milliseconds>(light_states.fade_start_time[i].time_since_epoch()).count();
+      fade.pushbutton_fade_up = light_states.pushbutton_fade_up[i];
+
+      // Pushbutton end time is kept on the steady clock
+      fade.pushbutton_fade_end_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                          (system_now - (steady_now - light_states.pushbutton_fade_end_time[i])).time_since_epoch())
+                                          .count();
+   }
+
+   DoubleBuffer<FadeStates>::publish(states);
+}
@@ -0,0 +1,159 @@
+/*
+ * Filename: statesnapshot.h
+ * Description: interface for the StateSnapshot and FadeSnapshot classes
+ * Author: Sergio Carmine <me@sergiocarmi.net>
+ * Date of Creation: 18/10/2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include "lightstates.h"
+
+// Consistent copy of the outward-facing states
+struct OutwardStates
+{
+   uint8_t state[512];
+   uint8_t brightness[512];
+   uint16_t brightness_fine[512]; // 0-65535
+};
+
+// Fade and pushbutton state of a single channel. Times are
+// wall clock milliseconds, so they stay meaningful across restarts
+struct ChannelFade
+{
+   bool fading;
+   uint16_t fade_start; // 0-65535
+   uint16_t fade_end;   // 0-65535
+   bool pushbutton_fade_up;
+   uint32_t fade_duration;           // ms
+   int64_t fade_start_time;          // ms since epoch
+   int64_t pushbutton_fade_end_time; // ms since epoch
+};
+
+// Consistent copy of the fade states
+struct FadeStates
+{
+   ChannelFade channels[512];
+};
+
+/*
+ * Definition of the DoubleBuffer class template
+ *
+ * Double buffer for a single writer and any number of readers. The
+ * writer publishes into the buffer readers aren't looking at and then
+ * flips the generation. Readers copy the current buffer without taking
+ * any lock, retrying only if the writer reused that buffer while they
+ * were copying it. T must be trivially copyable.
+ */
+template <typename T>
+class DoubleBuffer
+{
+public:
+   // Constructor
+   DoubleBuffer()
+   {
+      for (int i = 0; i < 2; i++)
+      {
+         buffers[i].sequence = 0;
+         memset(&buffers[i].data, 0, sizeof(T));
+      }
+
+      generation = 0;
+   }
+
+   /*
+    * Publishes a new copy of the data. Must only be called by one thread
+    * Parameters:
+    *  - const T &data: data to publish
+    */
+   void publish(const T &data)
+   {
+      unsigned long next_generation = generation.load(std::memory_order_relaxed) + 1;
+      Buffer &buffer = buffers[next_generation % 2];
+      unsigned long sequence = buffer.sequence.load(std::memory_order_relaxed);
+
+      // Mark buffer as being written
+      buffer.sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      memcpy(&buffer.data, &data, sizeof(T));
+
+      // Done writing, make it the current buffer
+      buffer.sequence.store(sequence + 2, std::memory_order_release);
+      generation.store(next_generation, std::memory_order_release);
+   }
+
+   /*
+    * Copies the latest published data
+    * Parameters:
+    *  - T &data: where to store the copy
+    * Returns: generation of the copy
+    */
+   unsigned long read(T &data)
+   {
+      while (true)
+      {
+         unsigned long current_generation = generation.load(std::memory_order_acquire);
+         Buffer &buffer = buffers[current_generation % 2];
+         unsigned long sequence = buffer.sequence.load(std::memory_order_acquire);
+
+         // The writer already moved on to this buffer
+         if (sequence % 2)
+            continue;
+
+         memcpy(&data, &buffer.data, sizeof(T));
+
+         // Check that the buffer wasn't rewritten while copying
+         std::atomic_thread_fence(std::memory_order_acquire);
+         if (buffer.sequence.load(std::memory_order_relaxed) == sequence)
+            return current_generation;
+      }
+   }
+
+   /*
+    * Returns: generation of the latest published data, can be used to
+    * check for changes without copying it
+    */
+   unsigned long get_generation()
+   {
+      return generation.load(std::memory_order_acquire);
+   }
+
+private:
+   struct Buffer
+   {
+      std::atomic<unsigned long> sequence; // Odd while being written
+      T data;
+   };
+
+   Buffer buffers[2];
+   std::atomic<unsigned long> generation; // Buffer readers should use is generation % 2
+};
+
+/*
+ * Definition of the StateSnapshot class
+ *
+ * Outward-facing states, published by the TCPServer
+ */
+class StateSnapshot : public DoubleBuffer<OutwardStates>
+{
+public:
+   void publish(const LightStates &light_states);
+};
+
+/*
+ * Definition of the FadeSnapshot class
+ *
+ * Fade and pushbutton states, published by the LightRenderer
+ * when a fade starts or ends
+ */
+class FadeSnapshot : public DoubleBuffer<FadeStates>
+{
+public:
+   void publish(const LightStates &light_states);
+};
@@ -13,6 +13,9 @@
 TCPServer::TCPServer()
 {
    init_client_sockets_array();
+
+   for (int i = 0; i < 512; i++)
+      channel_changed[i] = false;
 }
 
 /*
@@ -25,50 +28,41 @@ TCPServer::TCPServer()
  */
 bool TCPServer::start()
 {
-   int opt = 1;
-
-   logger("[TCP] Starting server...", LOG_INFO, true);
+   LOGGER_DEBUG("[TCP] Starting server...", LOG_INFO);
 
-   // Create master socket
-   if ((master_socket = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+   // Kept open when restarted after a failed handover, as wake() can be
+   // called at any time by the LightRenderer
+   if (wake_pipe[0] < 0)
    {
-      logger("[TCP] Error on socket() system call!", LOG_ERR, false);
-      return false;
-   }
+      if (pipe2(wake_pipe, O_NONBLOCK | O_CLOEXEC) < 0)
+      {
+         logger("[TCP] Error on pipe2() system call!", LOG_ERR, false);
+         return false;
+      }
 
-   // Allow multiple incoming connections
-   if (setsockopt(master_socket, SOL_SOCKET, SO_REUSEADDR,
-                  (char *)&opt, sizeof(opt)) < 0)
-   {
-      logger("[TCP] Error setting socket options!", LOG_ERR, false);
-      return false;
+      wake_fd.store(wake_pipe[1], std::memory_order_release);
    }
 
-   // Type of address to bind to
-   address.sin_family = AF_INET;
-   address.sin_addr.s_addr = INADDR_ANY;
-   address.sin_port = htons(port);
+   running = true;
 
-   // Bind master socket to localhost and correct port
-   if (bind(master_socket, (struct sockaddr *)&address,
-            sizeof(address)) < 0)
+   // Listening socket is already set up
+   if (adopted)
    {
-      logger("[TCP] Error binding port to socket!", LOG_ERR, false);
-      return false;
+      start_main_loop();
+
+      logger("[TCP] Took over listening on port " + std::to_string(port), LOG_SUCC, false);
+      return true;
    }
 
-   // Start listening for connections
-   if (listen(master_socket, MAX_CONNECT_QUEUE) < 0)
-   {
-      logger("[TCP] Error starting listen()!", LOG_ERR, false);
+   // Create master socket and start listening for connections
+   if ((master_socket = open_master_socket(port)) < 0)
       return false;
-   }
 
    // Get length of host address
    addrlen = sizeof(address);
 
    // Start handling connections and messages
-   tcp_thread = std::thread(&TCPServer::main_loop, this);
+   start_main_loop();
 
    logger("[TCP] Listening on port " + std::to_string(port), LOG_SUCC, false);
    return true;
@@ -79,11 +73,79 @@ bool TCPServer::start()
  */
 void TCPServer::stop()
 {
-   // Stop listener thread
-   running = false;
+   stop_main_loop();
+
+   // Close all connections
+   for (int i = 0; i < max_clients; i++)
+      if (client_socket[i] > 0)
+         disconnect_client(i);
+
+   close(master_socket);
+
+   // The LightRenderer must already be stopped, so nothing can wake() us
+   wake_fd.store(-1, std::memory_order_release);
+   close(wake_pipe[0]);
+   close(wake_pipe[1]);
+   wake_pipe[0] = wake_pipe[1] = -1;
+
+   if (input_timer >= 0)
+   {
+      close(input_timer);
+      input_timer = -1;
+   }
+}
+
+/*
+ * Stops handling connections and messages without closing any socket,
+ * so they can be handed over to another process. Can be undone by
+ * calling start() again
+ * Parameters:
+ *  - int *fds: array of 1 + MAX_CLIENTS where to store the listening
+ *    socket followed by the client sockets
+ * Returns: amount of file descriptors stored
+ */
+int TCPServer::detach(int *fds)
+{
+   int fd_count = 0;
+
+   stop_main_loop();
+
+   // Send what we can of the pending responses
+   flush_all_client_outputs();
+
+   fds[fd_count++] = master_socket;
+   for (int i = 0; i < max_clients; i++)
+      if (client_socket[i] > 0)
+         fds[fd_count++] = client_socket[i];
+
+   adopted = true;
+
+   return fd_count;
+}
+
+/*
+ * Takes over sockets handed over by another process. Must be called before start()
+ * Parameters:
+ *  - const int *fds: listening socket followed by the client sockets
+ *  - int fd_count: amount of file descriptors
+ */
+void TCPServer::adopt_sockets(const int *fds, int fd_count)
+{
+   master_socket = fds[0];
+   addrlen = sizeof(address);
+
+   for (int i = 1; i < fd_count; i++)
+   {
+      if (!add_client_to_client_sockets(fds[i]))
+      {
+         close(fds[i]);
+         continue;
+      }
 
-   // Wait for listener thread to stop
-   tcp_thread.join();
+      connected_clients_gauge->increment();
+   }
+
+   adopted = true;
 }
 
 /*
@@ -115,13 +177,195 @@ void TCPServer::configure(int port, int fps, int default_transition, int directi
 }
 
 /*
- * Give TCPServer access to persistency_writer_cv
+ * Give TCPServer access to the ConfigWatcher, to apply config changes
+ * Parameters:
+ *  - ConfigWatcher &config_watcher: reference to config watcher
+ */
+void TCPServer::set_config_watcher(ConfigWatcher &config_watcher)
+{
+   this->config_watcher = &config_watcher;
+   config = config_watcher.get_config();
+   config_generation = config_watcher.get_generation();
+}
+
+/*
+ * Wakes up the main loop, so that it applies a new config or fired cues.
+ * Called from the LightRenderer thread, so it never blocks: a full pipe
+ * already has a wake up pending
+ */
+void TCPServer::wake()
+{
+   int fd = wake_fd.load(std::memory_order_acquire);
+
+   // Not started yet
+   if (fd < 0)
+      return;
+
+   if (write(fd, "c", 1) < 0 && errno != EAGAIN)
+      LOGGER_DEBUG("[TCP] Error waking up main loop", LOG_WARN);
+}
+
+/*
+ * Handle sockets on an event loop instead of a thread. Must be called before start()
+ * Parameters:
+ *  - EventLoop &event_loop: event loop of the single thread runtime
+ */
+void TCPServer::set_event_loop(EventLoop &event_loop)
+{
+   this->event_loop = &event_loop;
+}
+
+/*
+ * Handles activity on a socket, does on the event loop what a
+ * main_loop() iteration does
+ * Parameters:
+ *  - int fd: file descriptor with events
+ *  - uint32_t events: EPOLL* events
+ */
+void TCPServer::handle_event(int fd, uint32_t events)
+{
+   char wake_buffer[16];
+   int i;
+
+   if (fd == wake_pipe[0])
+   {
+      if (read(wake_pipe[0], wake_buffer, sizeof(wake_buffer)) < 0)
+         LOGGER_DEBUG("[TCP] Error reading wake up pipe", LOG_WARN);
+   }
+   else if (fd == input_timer)
+      read_timer(input_timer);
+   else if (fd == master_socket)
+      accept_connection();
+   else if ((i = get_client_index(fd)) >= 0 && (events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+      handle_action_from_client(fd, i);
+
+   parse_idle_client_inputs();
+   apply_fired_cues();
+   publish_state_changes();
+   flush_all_client_outputs();
+   apply_config_changes();
+   watch_client_outputs();
+
+   // Wake up when the next message without a newline is due, 0 disarms the timer
+   int input_timeout = get_client_input_timeout();
+   if (input_timer >= 0)
+      arm_timer(input_timer, input_timeout >= 0 ? std::max(input_timeout, 1) * 1000L : 0, false);
+}
+
+/*
+ * Give TCPServer access to the PersistencyWriter
+ * Parameters:
+ *  - PersistencyWriter &persistency_writer: reference to persistency writer
+ */
+void TCPServer::set_persistency_writer(PersistencyWriter &persistency_writer)
+{
+   this->persistency_writer = &persistency_writer;
+}
+
+/*
+ * Give TCPServer access to the snapshot of outward states it publishes
+ * Parameters:
+ *  - StateSnapshot &state_snapshot: reference to state snapshot
+ */
+void TCPServer::set_state_snapshot(StateSnapshot &state_snapshot)
+{
+   this->state_snapshot = &state_snapshot;
+}
+
+/*
+ * Give TCPServer access to the queue of commands for the LightRenderer
+ * Parameters:
+ *  - CommandQueue &command_queue: reference to command queue
+ */
+void TCPServer::set_command_queue(CommandQueue &command_queue)
+{
+   this->command_queue = &command_queue;
+}
+
+/*
+ * Give TCPServer access to the saved scenes
+ * Parameters:
+ *  - SceneStore &scene_store: reference to scene store
+ */
+void TCPServer::set_scene_store(SceneStore &scene_store)
+{
+   this->scene_store = &scene_store;
+}
+
+/*
+ * Give TCPServer access to the EffectsEngine, to start and stop effects
+ * Parameters:
+ *  - EffectsEngine &effects: reference to effects engine
+ */
+void TCPServer::set_effects_engine(EffectsEngine &effects)
+{
+   this->effects = &effects;
+}
+
+/*
+ * Give TCPServer access to the SourceMerger, to give commands to named sources
+ * Parameters:
+ *  - SourceMerger &sources: reference to source merger
+ */
+void TCPServer::set_source_merger(SourceMerger &sources)
+{
+   this->sources = &sources;
+}
+
+/*
+ * Give TCPServer access to the MasterControls, to set masters
+ * Parameters:
+ *  - MasterControls &masters: reference to master controls
+ */
+void TCPServer::set_master_controls(MasterControls &masters)
+{
+   this->masters = &masters;
+}
+
+/*
+ * Give TCPServer access to the ColorFixtures, to set fixture colors
+ * Parameters:
+ *  - ColorFixtures &fixtures: reference to color fixtures
+ */
+void TCPServer::set_color_fixtures(ColorFixtures &fixtures)
+{
+   this->fixtures = &fixtures;
+}
+
+/*
+ * Give TCPServer access to the CueSequencer, to load and control cue lists
+ * Parameters:
+ *  - CueSequencer &sequencer: reference to cue sequencer
+ */
+void TCPServer::set_cue_sequencer(CueSequencer &sequencer)
+{
+   this->sequencer = &sequencer;
+}
+
+/*
+ * Give TCPServer access to the command latency statistics
+ * Parameters:
+ *  - LatencyStats &latency_stats: reference to latency statistics
+ */
+void TCPServer::set_latency_stats(LatencyStats &latency_stats)
+{
+   this->latency_stats = &latency_stats;
+}
+
+/*
+ * Give TCPServer access to the metrics registry and register its metrics
  * Parameters:
- *  - std::condition_variable &persistency_writer_cv: reference to persistency writer cv
+ *  - MetricsRegistry &metrics: reference to metrics registry
  */
-void TCPServer::set_persistency_writer_cv(std::condition_variable &persistency_writer_cv)
+void TCPServer::set_metrics(MetricsRegistry &metrics)
 {
-   this->persistency_writer_cv = &persistency_writer_cv;
+   const char *commands[] = {TCP_COMMANDS, "unknown"};
+
+   for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+      command_counters[commands[i]] = &metrics.add_counter("lumize_commands_total", "Commands received by type", "type=\"" + std::string(commands[i]) + "\"");
+
+   parse_errors_counter = &metrics.add_counter("lumize_command_errors_total", "Commands rejected because they couldn't be parsed");
+   connected_clients_gauge = &metrics.add_gauge("lumize_connected_clients", "TCP clients currently connected");
 }
 
 /*
@@ -134,7 +378,104 @@ void TCPServer::set_persistency_writer_cv(std::condition_variable &persistency_w
 void TCPServer::init_client_sockets_array()
 {
    for (int i = 0; i < max_clients; i++)
+   {
       client_socket[i] = 0;
+      client_output_size[i] = 0;
+      client_output_offset[i] = 0;
+      client_source[i] = -1;
+   }
+}
+
+/*
+ * Creates a listening socket
+ * Parameters:
+ *  - int port: TCP port to bind to
+ * Returns: the socket, -1 if unsuccesful
+ */
+int TCPServer::open_master_socket(int port)
+{
+   int socketfd, opt = 1;
+   struct sockaddr_in address;
+
+   // Create socket
+   if ((socketfd = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+   {
+      logger("[TCP] Error on socket() system call!", LOG_ERR, false);
+      return -1;
+   }
+
+   // Allow multiple incoming connections
+   if (setsockopt(socketfd, SOL_SOCKET, SO_REUSEADDR,
+                  (char *)&opt, sizeof(opt)) < 0)
+   {
+      logger("[TCP] Error setting socket options!", LOG_ERR, false);
+      close(socketfd);
+      return -1;
+   }
+
+   // Type of address to bind to
+   address.sin_family = AF_INET;
+   address.sin_addr.s_addr = INADDR_ANY;
+   address.sin_port = htons(port);
+
+   // Bind socket to localhost and correct port
+   if (bind(socketfd, (struct sockaddr *)&address,
+            sizeof(address)) < 0)
+   {
+      logger("[TCP] Error binding port to socket!", LOG_ERR, false);
+      close(socketfd);
+      return -1;
+   }
+
+   // Start listening for connections
+   if (listen(socketfd, MAX_CONNECT_QUEUE) < 0)
+   {
+      logger("[TCP] Error starting listen()!", LOG_ERR, false);
+      close(socketfd);
+      return -1;
+   }
+
+   return socketfd;
+}
+
+/*
+ * Applies the config published by the ConfigWatcher since the last
+ * iteration. Connected clients are kept when the port changes
+ */
+void TCPServer::apply_config_changes()
+{
+   unsigned long generation = config_watcher->get_generation();
+   int socketfd, new_port = port;
+
+   if (generation == config_generation)
+      return;
+
+   config_generation = generation;
+
+   // Groups are looked up in the new config from now on
+   config = config_watcher->get_config();
+
+   // Only stop listening on the old port once the new one is open
+   if (config->port != port)
+   {
+      if ((socketfd = open_master_socket(config->port)) < 0)
+         logger("[TCP] Unable to listen on port " + std::to_string(config->port) + ", still listening on port " + std::to_string(port), LOG_ERR, false);
+      else
+      {
+         if (event_loop)
+         {
+            event_loop->remove(master_socket);
+            event_loop->add(socketfd, EPOLLIN, this);
+         }
+
+         close(master_socket);
+         master_socket = socketfd;
+         new_port = config->port;
+         logger("[TCP] Listening on port " + std::to_string(config->port), LOG_SUCC, false);
+      }
+   }
+
+   configure(new_port, config->fps, config->default_transition, config->pushbutton_fade_reset_delay);
 }
 
 /*
@@ -142,28 +483,50 @@ void TCPServer::init_client_sockets_array()
  */
 void TCPServer::main_loop()
 {
+   char wake_buffer[16];
+
    while (running)
    {
-      // Clear socket set
+      // Clear socket sets
       FD_ZERO(&readfds);
+      FD_ZERO(&writefds);
 
-      // Add master socket to socket set
+      // Add master socket and wake up pipe to socket set
       FD_SET(master_socket, &readfds);
-      max_sd = master_socket;
+      FD_SET(wake_pipe[0], &readfds);
+      max_sd = std::max(master_socket, wake_pipe[0]);
 
       // Add client sockets to set
       add_client_sockets_to_set();
 
-      // Wait for activity on any of the sockets
-      activity = select(max_sd + 1, &readfds, NULL, NULL, NULL);
+      // Wait for activity on any of the sockets, or until a message
+      // without a newline is due
+      struct timeval input_timeout, *timeout = NULL;
+      int input_timeout_ms = get_client_input_timeout();
+      if (input_timeout_ms >= 0)
+      {
+         input_timeout.tv_sec = input_timeout_ms / 1000;
+         input_timeout.tv_usec = (input_timeout_ms % 1000) * 1000;
+         timeout = &input_timeout;
+      }
+
+      activity = select(max_sd + 1, &readfds, &writefds, NULL, timeout);
+
+      // Server is being stopped
+      if (!running)
+         break;
 
       // Check for error on select()
       if (activity < 0 && errno != EINTR)
       {
-         logger("[TCP] Error on select()", LOG_WARN, true);
+         LOGGER_DEBUG("[TCP] Error on select()", LOG_WARN);
          continue;
       }
 
+      // Woken up to apply a new config
+      if (FD_ISSET(wake_pipe[0], &readfds) && read(wake_pipe[0], wake_buffer, sizeof(wake_buffer)) < 0)
+         LOGGER_DEBUG("[TCP] Error reading wake up pipe", LOG_WARN);
+
       // If the master socket has an action
       if (FD_ISSET(master_socket, &readfds))
       {
@@ -176,85 +539,396 @@ void TCPServer::main_loop()
          sd = client_socket[i];
 
          // If a client socket has an action
-         if (FD_ISSET(sd, &readfds))
+         if (sd > 0 && FD_ISSET(sd, &readfds))
          {
             handle_action_from_client(sd, i);
          }
       }
-   }
-}
 
-/*
- * Adds client socket file descriptors to socket set
- */
-void TCPServer::add_client_sockets_to_set()
-{
-   for (int i = 0; i < max_clients; i++)
-   {
-      // Get socket descriptor
-      sd = client_socket[i];
+      // Messages of clients that don't send newlines
+      parse_idle_client_inputs();
 
-      // If descriptor is valid, add to set
-      if (sd > 0)
-         FD_SET(sd, &readfds);
+      // Cues fired by the LightRenderer change outward states too
+      apply_fired_cues();
 
-      // Keep track of biggest socket descriptor
-      if (sd > max_sd)
-         max_sd = sd;
+      // Make the states changed in this iteration visible to background readers
+      publish_state_changes();
+
+      // Send all responses generated in this iteration
+      flush_all_client_outputs();
+
+      // Apply config changes once the sockets of this iteration have been handled
+      apply_config_changes();
    }
 }
 
 /*
- * Accepts new connection from client and sends
- * welcome message
+ * Starts handling connections and messages, on the event loop if there is one
  */
-void TCPServer::accept_connection()
+void TCPServer::start_main_loop()
 {
-   if ((new_socket = accept(master_socket, (struct sockaddr *)&address, (socklen_t *)&addrlen)) < 0)
+   if (!event_loop)
    {
-      logger("[TCP] Error accepting client", LOG_WARN, true);
+      tcp_thread = std::thread(&TCPServer::main_loop, this);
       return;
    }
 
-   std::string address_string(inet_ntoa(address.sin_addr));
-   logger("[TCP] New connection from " + address_string, LOG_INFO, true);
-
-   // Add socket to array of client sockets
-   if (!add_client_to_client_sockets(new_socket))
-   {
-      // If there wasn't space in the clients array
-      // close the connection
-      close(new_socket);
+   // Handles the messages of clients that don't send newlines
+   if (input_timer < 0 && (input_timer = create_timer()) < 0)
+      logger("[TCP] Error on timerfd_create() system call!", LOG_ERR, false);
+   else
+      event_loop->add(input_timer, EPOLLIN, this);
 
-      logger("[TCP] Client " + address_string + " rejected: too many clients", LOG_WARN, true);
+   event_loop->add(wake_pipe[0], EPOLLIN, this);
+   event_loop->add(master_socket, EPOLLIN, this);
 
-      return;
+   // Clients taken over or kept after a failed handover
+   for (int i = 0; i < max_clients; i++)
+   {
+      client_output_watched[i] = false;
+      if (client_socket[i] > 0)
+         event_loop->add(client_socket[i], EPOLLIN, this);
    }
 
-   logger("[TCP] Client " + address_string + " accepted!", LOG_SUCC, true);
-
-   // Send welcome message
-   send_string(new_socket, client_welcome_message);
+   watch_client_outputs();
 }
 
 /*
- * Sends a string through a socket
+ * Watches for writability the clients that have responses waiting to be sent
  */
-bool TCPServer::send_string(int socketfd, std::string message)
+void TCPServer::watch_client_outputs()
 {
+   for (int i = 0; i < max_clients; i++)
+      if (client_socket[i] > 0 && client_output_watched[i] != (client_output_size[i] > 0))
+      {
+         client_output_watched[i] = client_output_size[i] > 0;
+         event_loop->modify(client_socket[i], client_output_watched[i] ? EPOLLIN | EPOLLOUT : EPOLLIN);
+      }
+}
 
-   // Convert string to char array
-   const char *message_char = message.c_str();
+/*
+ * Stops the main loop and waits for it to exit, or stops watching the
+ * sockets on the event loop
+ */
+void TCPServer::stop_main_loop()
+{
+   running = false;
+
+   if (event_loop)
+   {
+      if (input_timer >= 0)
+         event_loop->remove(input_timer);
+      event_loop->remove(wake_pipe[0]);
+      event_loop->remove(master_socket);
+      for (int i = 0; i < max_clients; i++)
+         if (client_socket[i] > 0)
+            event_loop->remove(client_socket[i]);
+   }
+   else
+   {
+      // Wake up select() in the listener thread
+      if (write(wake_pipe[1], "x", 1) < 0 && errno != EAGAIN)
+         LOGGER_DEBUG("[TCP] Error waking up main loop", LOG_WARN);
+
+      // Wait for listener thread to stop
+      tcp_thread.join();
+   }
+}
+
+/*
+ * Adds client socket file descriptors to socket set
+ */
+void TCPServer::add_client_sockets_to_set()
+{
+   for (int i = 0; i < max_clients; i++)
+   {
+      // Get socket descriptor
+      sd = client_socket[i];
+
+      // If descriptor is valid, add to set
+      if (sd > 0)
+      {
+         FD_SET(sd, &readfds);
+
+         // Wait for writability only if there's something to send
+         if (client_output_size[i] > 0)
+            FD_SET(sd, &writefds);
+      }
+
+      // Keep track of biggest socket descriptor
+      if (sd > max_sd)
+         max_sd = sd;
+   }
+}
+
+/*
+ * Accepts new connection from client and sends
+ * welcome message
+ */
+void TCPServer::accept_connection()
+{
+   if ((new_socket = accept(master_socket, (struct sockaddr *)&address, (socklen_t *)&addrlen)) < 0)
+   {
+      LOGGER_DEBUG("[TCP] Error accepting client", LOG_WARN);
+      return;
+   }
+
+   std::string address_string(inet_ntoa(address.sin_addr));
+   LOGGER_DEBUG("[TCP] New connection from " + address_string, LOG_INFO);
+
+   // Responses are buffered, so the socket must never block the event loop
+   if (!set_socket_non_blocking(new_socket))
+   {
+      close(new_socket);
+      LOGGER_DEBUG("[TCP] Client " + address_string + " rejected: unable to set non-blocking mode", LOG_WARN);
+      return;
+   }
+
+   // Add socket to array of client sockets
+   if (!add_client_to_client_sockets(new_socket))
+   {
+      // If there wasn't space in the clients array
+      // close the connection
+      close(new_socket);
+
+      LOGGER_DEBUG("[TCP] Client " + address_string + " rejected: too many clients", LOG_WARN);
+
+      return;
+   }
+
+   LOGGER_DEBUG("[TCP] Client " + address_string + " accepted!", LOG_SUCC);
+   connected_clients_gauge->increment();
+
+   if (event_loop)
+   {
+      client_output_watched[get_client_index(new_socket)] = false;
+      event_loop->add(new_socket, EPOLLIN, this);
+   }
+
+   // Send welcome message
+   send_string(new_socket, client_welcome_message);
+}
+
+/*
+ * Queues a string to be sent through a socket. The actual write happens
+ * when the event loop flushes the client's output buffer
+ * Parameters:
+ *  - int socketfd: client socket file descriptor
+ *  - std::string message: message to send
+ * Returns: true if the message was queued
+ */
+bool TCPServer::send_string(int socketfd, std::string message)
+{
+   int i = get_client_index(socketfd);
+
+   // Client has already been disconnected
+   if (i < 0)
+      return false;
+
+   client_output_size[i] += message.length();
+   client_output_queue[i].push_back(std::move(message));
 
-   // Send message
-   if (send(socketfd, message_char, strlen(message_char), 0) < 0)
+   // Drop clients that aren't reading their responses
+   if (client_output_size[i] > CLIENT_OUTPUT_HIGH_WATER_MARK)
    {
+      LOGGER_DEBUG("[TCP] Client output buffer full, disconnecting slow client", LOG_WARN);
+      disconnect_client(i);
       return false;
    }
 
    return true;
 }
 
+/*
+ * Sends an error message to a client
+ * Parameters:
+ *  - int client_fd: client socket file descriptor
+ *  - std::string error: error type
+ */
+void TCPServer::send_error(int client_fd, std::string error)
+{
+   parse_errors_counter->increment();
+
+   send_string(client_fd, "error," + error + "\n");
+}
+
+/*
+ * Finds the position of a socket in the client sockets array
+ * Parameters:
+ *  - int socketfd: client socket file descriptor
+ * Returns: position in client_socket, -1 if not found
+ */
+int TCPServer::get_client_index(int socketfd)
+{
+   for (int i = 0; i < max_clients; i++)
+      if (client_socket[i] == socketfd)
+         return i;
+
+   return -1;
+}
+
+/*
+ * Sends as much of a client's queued output as the socket accepts,
+ * coalescing all queued responses into a single writev()
+ * Parameters:
+ *  - int i: position of the client in client_socket
+ */
+void TCPServer::flush_client_output(int i)
+{
+   struct iovec iov[MAX_WRITEV_CHUNKS];
+   int iovcnt = 0;
+   ssize_t written;
+
+   // Build vector of queued responses
+   for (std::deque<std::string>::iterator it = client_output_queue[i].begin();
+        it != client_output_queue[i].end() && iovcnt < MAX_WRITEV_CHUNKS; ++it, iovcnt++)
+   {
+      // Part of the first response could have already been sent
+      size_t offset = iovcnt == 0 ? client_output_offset[i] : 0;
+
+      iov[iovcnt].iov_base = (void *)(it->data() + offset);
+      iov[iovcnt].iov_len = it->length() - offset;
+   }
+
+   if ((written = writev(client_socket[i], iov, iovcnt)) < 0)
+   {
+      // Socket buffer is full, retry when it becomes writable
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+         return;
+
+      LOGGER_DEBUG("[TCP] Error sending data to client, disconnecting", LOG_WARN);
+      disconnect_client(i);
+      return;
+   }
+
+   client_output_size[i] -= written;
+
+   // Remove fully sent responses from the queue
+   written += client_output_offset[i];
+   while (!client_output_queue[i].empty() && (size_t)written >= client_output_queue[i].front().length())
+   {
+      written -= client_output_queue[i].front().length();
+      client_output_queue[i].pop_front();
+   }
+   client_output_offset[i] = written;
+}
+
+/*
+ * Records that the outward state of a channel was changed
+ * Parameters:
+ *  - int channel: changed channel
+ */
+void TCPServer::mark_channel_changed(int channel)
+{
+   channel_changed[channel] = true;
+   states_changed = true;
+}
+
+/*
+ * Updates the outward states of the channels faded by the cues the
+ * LightRenderer fired since the last call
+ */
+void TCPServer::apply_fired_cues()
+{
+   sequencer->take_fired(fired_cues);
+
+   for (size_t i = 0; i < fired_cues.size(); i++)
+   {
+      const CueEvent &event = fired_cues[i].list->events[fired_cues[i].event];
+
+      for (size_t j = 0; j < event.channels.size(); j++)
+      {
+         const int channel = event.channels[j];
+         const LightCommand &command = event.commands[j];
+
+         // Channels turned off keep their brightness, unless recalled from a scene
+         light_states->outward_state[channel] = command.type == LIGHT_COMMAND_ON;
+         if (command.type == LIGHT_COMMAND_ON || event.sets_brightness)
+            set_outward_brightness(*light_states, channel, command.brightness);
+         mark_channel_changed(channel);
+      }
+   }
+
+   fired_cues.clear();
+}
+
+/*
+ * Publishes the outward states changed since the last call, then
+ * tells the PersistencyWriter which channels changed. Publishing first
+ * makes sure the writer never reads a snapshot older than the change
+ */
+void TCPServer::publish_state_changes()
+{
+   if (!states_changed)
+      return;
+
+   state_snapshot->publish(*light_states);
+
+   for (int i = 0; i < 512; i++)
+   {
+      if (!channel_changed[i])
+         continue;
+
+      persistency_writer->mark_dirty(i);
+      channel_changed[i] = false;
+   }
+
+   states_changed = false;
+}
+
+/*
+ * Flushes the output buffers of all clients with pending data
+ */
+void TCPServer::flush_all_client_outputs()
+{
+   for (int i = 0; i < max_clients; i++)
+      if (client_socket[i] > 0 && client_output_size[i] > 0)
+         flush_client_output(i);
+}
+
+/*
+ * Closes a client connection and frees up its spot
+ * Parameters:
+ *  - int i: position of the client in client_socket
+ */
+void TCPServer::disconnect_client(int i)
+{
+   if (event_loop)
+      event_loop->remove(client_socket[i]);
+
+   // Close connection
+   close(client_socket[i]);
+
+   // Discard pending input and output
+   client_input_buffer[i].clear();
+   client_input_discarding[i] = false;
+   client_input_framed[i] = false;
+   client_output_queue[i].clear();
+   client_output_size[i] = 0;
+   client_output_offset[i] = 0;
+
+   // Free up spot in client sockets array
+   client_socket[i] = 0;
+   client_source[i] = -1;
+   connected_clients_gauge->decrement();
+}
+
+/*
+ * Sets the O_NONBLOCK flag on a socket
+ * Parameters:
+ *  - int socketfd: socket file descriptor
+ * Returns: true if succesful
+ */
+bool TCPServer::set_socket_non_blocking(int socketfd)
+{
+   int flags = fcntl(socketfd, F_GETFL, 0);
+
+   if (flags < 0)
+      return false;
+
+   return fcntl(socketfd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
 /*
  * Stores new socket in array of managed sockets
  * Parameters:
@@ -270,6 +944,7 @@ bool TCPServer::add_client_to_client_sockets(int socketfd)
       if (client_socket[i] == 0)
       {
          client_socket[i] = socketfd;
+         client_source[i] = -1;
          found = true;
          break;
       }
@@ -293,28 +968,152 @@ void TCPServer::handle_action_from_client(int socketfd, int i)
       // Get info of disconnected client
       getpeername(socketfd, (struct sockaddr *)&address, (socklen_t *)&addrlen);
       std::string address_string(inet_ntoa(address.sin_addr));
-      logger("[TCP] Client " + address_string + " disconnected", LOG_INFO, true);
+      LOGGER_DEBUG("[TCP] Client " + address_string + " disconnected", LOG_INFO);
 
-      // Close connection
-      close(socketfd);
+      disconnect_client(i);
+   }
+   else if (valread < 0)
+   {
+      // Spurious wakeup on non-blocking socket
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+         return;
 
-      // Free up spot in client sockets array
-      client_socket[i] = 0;
+      LOGGER_DEBUG("[TCP] Error reading from client, disconnecting", LOG_WARN);
+      disconnect_client(i);
    }
    else
    {
       // Client has sent some data
       buffer[valread] = '\0'; // Terminate buffer string
-      std::string message = buffer;
+
+      // Stamp commands with the time they arrived
+      message_received_time = std::chrono::steady_clock::now();
+
+      // Prepend what was left over from the previous read
+      std::string data = client_input_buffer[i] + buffer;
+      client_input_buffer[i].clear();
+
+      if (data.find('\n') != std::string::npos)
+         client_input_framed[i] = true;
+
+      // Skip the rest of a message that was too long, up to its newline
+      if (client_input_discarding[i])
+      {
+         size_t end = data.find('\n');
+
+         if (end == std::string::npos)
+            return;
+
+         data.erase(0, end + 1);
+         client_input_discarding[i] = false;
+      }
+
+      // A single read can contain multiple pipelined messages
+      std::vector<std::string> messages = split_string(data, '\n');
+
+      // Messages end with a newline, whatever follows the last one
+      // is incomplete: keep it until the next read. Clients that never
+      // sent a newline get it handled once idle for CLIENT_INPUT_IDLE_TIMEOUT
+      if (!data.empty() && data.back() != '\n' && !messages.empty())
+      {
+         client_input_buffer[i] = messages.back();
+         client_input_time[i] = message_received_time;
+         messages.pop_back();
+
+         // Don't let a client without newlines grow the buffer forever
+         if (client_input_buffer[i].length() > CLIENT_INPUT_MAX_LENGTH)
+         {
+            LOGGER_DEBUG("[TCP] Message too long, discarded", LOG_WARN);
+            client_input_buffer[i].clear();
+
+            // Without newlines there is no end of the message to skip to
+            client_input_discarding[i] = client_input_framed[i];
+         }
+      }
+
+      parse_client_messages(messages, socketfd);
+   }
+}
+
+/*
+ * Parses the messages received from a client in a single read
+ * Parameters:
+ *  - std::vector<std::string> &messages: messages without their newline
+ *  - int socketfd: client socket file descriptor
+ */
+void TCPServer::parse_client_messages(std::vector<std::string> &messages, int socketfd)
+{
+   for (size_t j = 0; j < messages.size(); j++)
+   {
+      std::string &message = messages[j];
+
+      // Client was disconnected by a response over the high water mark,
+      // the rest of its messages must not change anything
+      if (get_client_index(socketfd) < 0)
+         break;
 
       // Remove whitespace characters from string
       message.erase(std::remove_if(message.begin(), message.end(), ::isspace), message.end());
 
+      if (message.empty())
+         continue;
+
       // Parse incoming message
       parse_message(message, socketfd);
    }
 }
 
+/*
+ * Handles as complete the messages without a newline of the clients that
+ * have been idle for CLIENT_INPUT_IDLE_TIMEOUT. Clients written for older
+ * versions don't end their messages with one, clients that sent a newline
+ * once always wait for it
+ */
+void TCPServer::parse_idle_client_inputs()
+{
+   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+   for (int i = 0; i < max_clients; i++)
+   {
+      if (client_socket[i] <= 0 || client_input_framed[i] || client_input_buffer[i].empty() ||
+          now - client_input_time[i] < std::chrono::milliseconds(CLIENT_INPUT_IDLE_TIMEOUT))
+         continue;
+
+      std::vector<std::string> messages(1, client_input_buffer[i]);
+      client_input_buffer[i].clear();
+
+      // Latency is measured from when the message was read
+      message_received_time = client_input_time[i];
+
+      parse_client_messages(messages, client_socket[i]);
+   }
+}
+
+/*
+ * Gets the time until the first message without a newline is handled
+ * Returns: time left in milliseconds, -1 if no message is waiting
+ */
+int TCPServer::get_client_input_timeout()
+{
+   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+   int timeout = -1;
+
+   for (int i = 0; i < max_clients; i++)
+   {
+      if (client_socket[i] <= 0 || client_input_framed[i] || client_input_buffer[i].empty())
+         continue;
+
+      // Rounded up, so the message is due once the timeout expires
+      long left_us = std::chrono::duration_cast<std::chrono::microseconds>(client_input_time[i] - now).count() + CLIENT_INPUT_IDLE_TIMEOUT * 1000L;
+      int left_ms = std::max(0L, (left_us + 999) / 1000);
+
+      if (timeout < 0 || left_ms < timeout)
+         timeout = left_ms;
+   }
+
+   return timeout;
+}
+
 /*
  * Parses incoming message
  * Parameters:
@@ -332,6 +1131,13 @@ void TCPServer::parse_message(std::string message, int client_fd)
 
    std::string command = message_split[0];
 
+   // Count commands by type
+   std::map<std::string, Counter *>::iterator command_counter = command_counters.find(command);
+   if (command_counter != command_counters.end())
+      command_counter->second->increment();
+   else
+      command_counters["unknown"]->increment();
+
    // Recognize commands
    if (command == "conncheck")
       connection_check_message(client_fd);
@@ -345,11 +1151,57 @@ void TCPServer::parse_message(std::string message, int client_fd)
       pushbutton_fade_start_message(message_split, client_fd);
    else if (command == "pfend")
       pushbutton_fade_end_message(message_split, client_fd);
+   else if (command == "lstat")
+      latency_stats_request_message(client_fd);
+   else if (command == "scene_save")
+      scene_save_message(message_split, client_fd);
+   else if (command == "scene_recall")
+      scene_recall_message(message_split, client_fd);
+   else if (command == "scene_delete")
+      scene_delete_message(message_split, client_fd);
+   else if (command == "fxstart")
+      effect_start_message(message_split, client_fd);
+   else if (command == "fxstop")
+      effect_stop_message(message_split, client_fd);
+   else if (command == "source")
+      source_message(message_split, client_fd);
+   else if (command == "release")
+      release_message(message_split, client_fd);
+   else if (command == "source_delete")
+      source_delete_message(message_split, client_fd);
+   else if (command == "gm")
+      grand_master_message(message_split, client_fd);
+   else if (command == "sm")
+      submaster_message(message_split, client_fd);
+   else if (command == "blackout")
+      blackout_message(message_split, client_fd);
+   else if (command == "freeze")
+      freeze_message(message_split, client_fd);
+   else if (command == "mreq")
+      master_status_request_message(client_fd);
+   else if (command == "color")
+      color_message(message_split, client_fd);
+   else if (command == "cue_load")
+      cue_load_message(message_split, client_fd);
+   else if (command == "cue_add")
+      cue_add_message(message_split, client_fd);
+   else if (command == "cue_delete")
+      cue_delete_message(message_split, client_fd);
+   else if (command == "cue_go")
+      cue_go_message(message_split, client_fd);
+   else if (command == "cue_pause")
+      cue_pause_message(message_split, client_fd);
+   else if (command == "cue_stop")
+      cue_stop_message(message_split, client_fd);
+   else if (command == "cue_seek")
+      cue_seek_message(message_split, client_fd);
+   else if (command == "cue_req")
+      cue_status_request_message(message_split, client_fd);
    else
    {
       // Send error message to client
-      send_string(client_fd, "error,unknown_message\n");
-      logger("[TCP] Received: Unknown message type", LOG_WARN, true);
+      send_error(client_fd, "unknown_message");
+      LOGGER_DEBUG("[TCP] Received: Unknown message type", LOG_WARN);
    }
 }
 
@@ -380,7 +1232,7 @@ std::vector<std::string> TCPServer::split_string(std::string input, char seperat
  */
 void TCPServer::connection_check_message(int client_fd)
 {
-   logger("[TCP] Connection Check message", LOG_INFO, true);
+   LOGGER_DEBUG("[TCP] Connection Check message", LOG_INFO);
 
    // Send OK message to client
    send_string(client_fd, "ok\n");
@@ -394,52 +1246,42 @@ void TCPServer::connection_check_message(int client_fd)
  */
 void TCPServer::status_request_message(std::vector<std::string> split_message, int client_fd)
 {
-   int channel;
-
-   // Check if there are is at least space for the required fields
-   if (split_message.size() < 2)
-   {
-      logger("[TCP] Status Request message, no channel given!", LOG_WARN, true);
+   CommandTarget target;
+   bool state = false;
+   int brightness = 0;
 
-      // Send error message to client
-      send_string(client_fd, "error,no_channel_given\n");
+   // Get channel or group the command applies to
+   if (!parse_target(split_message, client_fd, "Status Request message", target))
       return;
-   }
 
-   // Convert channel number string to int
-   try
+   std::string message;
+
+   // A group is on if any of its channels is on, at the highest
+   // brightness of the channels that are on
+   for (int i = 0; i < target.count; i++)
    {
-      channel = std::stoi(split_message[1]);
+      int channel = target.channels[i];
 
-      // Check that channel value is acceptable
-      if (channel < 0 || channel > 511)
+      if (light_states->outward_state[channel] && !state)
       {
-         // Send error message to client
-         send_string(client_fd, "error,channel_out_of_range\n");
-         logger("[TCP] Status Request message, channel number out of range!", LOG_WARN, true);
-         return;
+         state = true;
+         brightness = 0;
       }
-   }
-   catch (const std::exception &e)
-   {
-      // Send error message to client
-      send_string(client_fd, "error,bad_channel\n");
-      logger("[TCP] Status Request message, bad channel!", LOG_WARN, true);
-      return;
-   }
 
-   std::string message;
+      if (light_states->outward_state[channel] == state)
+         brightness = std::max(brightness, light_states->outward_brightness[channel]);
+   }
 
    // light_states_lock->lock();
 
    // Start with response message type
    message.append("sres");
    message.append(",");
-   message.append(std::to_string(channel));
+   message.append(target.name);
    message.append(",");
-   message.append(std::to_string(light_states->outward_state[channel]));
+   message.append(std::to_string(state));
    message.append("-");
-   message.append(std::to_string(light_states->outward_brightness[channel]));
+   message.append(std::to_string(brightness));
 
    // light_states_lock->unlock();
 
@@ -455,49 +1297,35 @@ void TCPServer::status_request_message(std::vector<std::string> split_message, i
 
    send_string(client_fd, message);
 
-   logger("[TCP] Status Request message, channel: " + std::to_string(channel), LOG_INFO, true);
+   LOGGER_DEBUG("[TCP] Status Request message, channel: " + target.name, LOG_INFO);
 }
 
 /*
- * Handles a turn off message from the client
+ * Handles a latency statistics request message from the client and sends correct response
  * parameters:
- *  - std::vector<std::string> split_message: complete message to get parameters
+ *  - int client_fd: client socket file descriptor
  */
-void TCPServer::turn_off_message(std::vector<std::string> split_message, int client_fd)
+void TCPServer::latency_stats_request_message(int client_fd)
 {
-   bool has_transition = false;
-   int channel, transition;
+   LOGGER_DEBUG("[TCP] Latency Statistics Request message", LOG_INFO);
 
-   // Check if there are is at least space for the required fields
-   if (split_message.size() < 2)
-   {
-      logger("[TCP] OFF Command, no channel given!", LOG_WARN, true);
-      // Send error message to client
-      send_string(client_fd, "error,no_channel_given\n");
-      return;
-   }
+   send_string(client_fd, "lres," + latency_stats_string(*latency_stats) + "\n");
+}
 
-   // Convert channel number string to int
-   try
-   {
-      channel = std::stoi(split_message[1]);
+/*
+ * Handles a turn off message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::turn_off_message(std::vector<std::string> split_message, int client_fd)
+{
+   bool has_transition = false;
+   int transition, source;
+   CommandTarget target;
 
-      // Check that channel value is acceptable
-      if (channel < 0 || channel > 511)
-      {
-         logger("[TCP] OFF Command, channel number out of range!", LOG_WARN, true);
-         // Send error message to client
-         send_string(client_fd, "error,channel_out_of_range\n");
-         return;
-      }
-   }
-   catch (const std::exception &e)
-   {
-      logger("[TCP] OFF Command, bad channel!", LOG_WARN, true);
-      // Send error message to client
-      send_string(client_fd, "error,bad_channel\n");
+   // Get channel or group the command applies to
+   if (!parse_target(split_message, client_fd, "OFF Command", target))
       return;
-   }
 
    // Parse parameters
    for (long unsigned int i = 2; i < split_message.size(); i++)
@@ -518,17 +1346,17 @@ void TCPServer::turn_off_message(std::vector<std::string> split_message, int cli
                // Check that transition value is acceptable
                if (transition < 0)
                {
-                  logger("[TCP] OFF Command, transition value out of range!", LOG_WARN, true);
+                  LOGGER_DEBUG("[TCP] OFF Command, transition value out of range!", LOG_WARN);
                   // Send error message to client
-                  send_string(client_fd, "error,transition_out_of_range\n");
+                  send_error(client_fd, "transition_out_of_range");
                   return;
                }
             }
             catch (const std::exception &e)
             {
-               logger("[TCP] OFF Command, bad transition!", LOG_WARN, true);
+               LOGGER_DEBUG("[TCP] OFF Command, bad transition!", LOG_WARN);
                // Send error message to client
-               send_string(client_fd, "error,bad_transition\n");
+               send_error(client_fd, "bad_transition");
                return;
             }
             has_transition = true;
@@ -538,12 +1366,15 @@ void TCPServer::turn_off_message(std::vector<std::string> split_message, int cli
 
    // Actually act on the light status arrays
    if (has_transition)
-      logger("[TCP] OFF Command, channel: " + std::to_string(channel) + ", transition: " + std::to_string(transition) + "ms", LOG_INFO, true);
+      LOGGER_DEBUG("[TCP] OFF Command, channel: " + target.name + ", transition: " + std::to_string(transition) + "ms", LOG_INFO);
    else
-      logger("[TCP] OFF Command, channel: " + std::to_string(channel), LOG_INFO, true);
+      LOGGER_DEBUG("[TCP] OFF Command, channel: " + target.name, LOG_INFO);
 
-   // Perform turn off fade
-   start_off_fade(channel, has_transition, transition);
+   // Perform turn off fade, on the main source unless the client chose another one
+   if ((source = get_client_source(client_fd)) >= 0)
+      start_source_fade(source, target, LIGHT_COMMAND_OFF, false, has_transition, 0, transition);
+   else
+      start_off_fade(target, has_transition, transition);
 
    // Send OK message to client
    send_string(client_fd, "ok\n");
@@ -557,38 +1388,13 @@ void TCPServer::turn_off_message(std::vector<std::string> split_message, int cli
 void TCPServer::turn_on_message(std::vector<std::string> split_message, int client_fd)
 {
    bool has_transition = false, has_brightness = false;
-   int channel, transition, brightness;
+   int transition, source;
+   double brightness;
+   CommandTarget target;
 
-   // Check if there are is at least space for the required fields
-   if (split_message.size() < 2)
-   {
-      logger("[TCP] ON Command, no channel given!", LOG_WARN, true);
-      // Send error message to client
-      send_string(client_fd, "error,no_channel_given\n");
-      return;
-   }
-
-   // Convert channel number string to int
-   try
-   {
-      channel = std::stoi(split_message[1]);
-
-      // Check that channel value is acceptable
-      if (channel < 0 || channel > 511)
-      {
-         logger("[TCP] ON Command, channel number out of range!", LOG_WARN, true);
-         // Send error message to client
-         send_string(client_fd, "error,channel_out_of_range\n");
-         return;
-      }
-   }
-   catch (const std::exception &e)
-   {
-      logger("[TCP] ON Command, bad channel!", LOG_WARN, true);
-      // Send error message to client
-      send_string(client_fd, "error,bad_channel\n");
+   // Get channel or group the command applies to
+   if (!parse_target(split_message, client_fd, "ON Command", target))
       return;
-   }
 
    // Parse parameters
    for (long unsigned int i = 2; i < split_message.size(); i++)
@@ -610,19 +1416,52 @@ void TCPServer::turn_on_message(std::vector<std::string> split_message, int clie
                // Check that brightness value is acceptable
                if (brightness < 0 || brightness > 255)
                {
-                  logger("[TCP] ON Command, brightness value out of range!", LOG_WARN, true);
+                  LOGGER_DEBUG("[TCP] ON Command, brightness value out of range!", LOG_WARN);
+                  // Send error message to client
+                  send_error(client_fd, "brightness_out_of_range");
+                  return;
+               }
+            }
+            catch (const std::exception &e)
+            {
+               LOGGER_DEBUG("[TCP] ON Command, bad brightness!", LOG_WARN);
+               // Send error message to client
+               send_error(client_fd, "bad_brightness");
+               return;
+            }
+            has_brightness = true;
+         }
+      }
+
+      // Parameter is 16-bit brightness
+      else if (split_message[i].at(0) == 'B')
+      {
+         if (!has_brightness)
+         {
+            int brightness_fine;
+
+            // Check and store brightness
+            try
+            {
+               brightness_fine = std::stoi(split_message[i].substr(1));
+
+               // Check that brightness value is acceptable
+               if (brightness_fine < 0 || brightness_fine > 65535)
+               {
+                  LOGGER_DEBUG("[TCP] ON Command, brightness value out of range!", LOG_WARN);
                   // Send error message to client
-                  send_string(client_fd, "error,brightness_out_of_range\n");
+                  send_error(client_fd, "brightness_out_of_range");
                   return;
                }
             }
             catch (const std::exception &e)
             {
-               logger("[TCP] ON Command, bad brightness!", LOG_WARN, true);
+               LOGGER_DEBUG("[TCP] ON Command, bad brightness!", LOG_WARN);
                // Send error message to client
-               send_string(client_fd, "error,bad_brightness\n");
+               send_error(client_fd, "bad_brightness");
                return;
             }
+            brightness = brightness_fine / 257.0;
             has_brightness = true;
          }
       }
@@ -639,17 +1478,17 @@ void TCPServer::turn_on_message(std::vector<std::string> split_message, int clie
                // Check that transition value is acceptable
                if (transition < 0)
                {
-                  logger("[TCP] ON Command, transition value out of range!", LOG_WARN, true);
+                  LOGGER_DEBUG("[TCP] ON Command, transition value out of range!", LOG_WARN);
                   // Send error message to client
-                  send_string(client_fd, "error,transition_out_of_range\n");
+                  send_error(client_fd, "transition_out_of_range");
                   return;
                }
             }
             catch (const std::exception &e)
             {
-               logger("[TCP] ON Command, bad transition!", LOG_WARN, true);
+               LOGGER_DEBUG("[TCP] ON Command, bad transition!", LOG_WARN);
                // Send error message to client
-               send_string(client_fd, "error,bad_transition\n");
+               send_error(client_fd, "bad_transition");
                return;
             }
             has_transition = true;
@@ -660,19 +1499,22 @@ void TCPServer::turn_on_message(std::vector<std::string> split_message, int clie
    if (has_brightness)
    {
       if (has_transition)
-         logger("[TCP] ON Command, channel: " + std::to_string(channel) + ", brightness: " + std::to_string(brightness) + ", transition: " + std::to_string(transition) + "ms", LOG_INFO, true);
+         LOGGER_DEBUG("[TCP] ON Command, channel: " + target.name + ", brightness: " + std::to_string(brightness) + ", transition: " + std::to_string(transition) + "ms", LOG_INFO);
       else
-         logger("[TCP] ON Command, channel: " + std::to_string(channel) + ", brightness: " + std::to_string(brightness), LOG_INFO, true);
+         LOGGER_DEBUG("[TCP] ON Command, channel: " + target.name + ", brightness: " + std::to_string(brightness), LOG_INFO);
    }
    else
    {
       if (has_transition)
-         logger("[TCP] ON Command, channel: " + std::to_string(channel) + ", transition: " + std::to_string(transition) + "ms", LOG_INFO, true);
+         LOGGER_DEBUG("[TCP] ON Command, channel: " + target.name + ", transition: " + std::to_string(transition) + "ms", LOG_INFO);
       else
-         logger("[TCP] ON Command, channel: " + std::to_string(channel), LOG_INFO, true);
+         LOGGER_DEBUG("[TCP] ON Command, channel: " + target.name, LOG_INFO);
    }
 
-   start_on_fade(channel, has_brightness, has_transition, brightness, transition);
+   if ((source = get_client_source(client_fd)) >= 0)
+      start_source_fade(source, target, LIGHT_COMMAND_ON, has_brightness, has_transition, brightness, transition);
+   else
+      start_on_fade(target, has_brightness, has_transition, brightness, transition);
 
    // Send OK message to client
    send_string(client_fd, "ok\n");
@@ -685,42 +1527,15 @@ void TCPServer::turn_on_message(std::vector<std::string> split_message, int clie
  */
 void TCPServer::pushbutton_fade_end_message(std::vector<std::string> split_message, int client_fd)
 {
-   int channel;
-
-   // Check if there are is at least space for the required fields
-   if (split_message.size() < 2)
-   {
-      logger("[TCP] Pushbutton Fade End Command, no channel given!", LOG_WARN, true);
-      // Send error message to client
-      send_string(client_fd, "error,no_channel_given\n");
-      return;
-   }
-
-   // Convert channel number string to int
-   try
-   {
-      channel = std::stoi(split_message[1]);
+   CommandTarget target;
 
-      // Check that channel value is acceptable
-      if (channel < 0 || channel > 511)
-      {
-         logger("[TCP] Pushbutton Fade End Command, channel number out of range!", LOG_WARN, true);
-         // Send error message to client
-         send_string(client_fd, "error,channel_out_of_range\n");
-         return;
-      }
-   }
-   catch (const std::exception &e)
-   {
-      logger("[TCP] Pushbutton Fade End Command, bad channel!", LOG_WARN, true);
-      // Send error message to client
-      send_string(client_fd, "error,bad_channel\n");
+   // Get channel or group the command applies to
+   if (!parse_target(split_message, client_fd, "Pushbutton Fade End Command", target))
       return;
-   }
 
-   logger("[TCP] Pushbutton Fade End Command, channel: " + std::to_string(channel), LOG_INFO, true);
+   LOGGER_DEBUG("[TCP] Pushbutton Fade End Command, channel: " + target.name, LOG_INFO);
 
-   end_pushbutton_fade(channel);
+   end_pushbutton_fade(target);
 
    // Send OK message to client
    send_string(client_fd, "ok\n");
@@ -734,39 +1549,13 @@ void TCPServer::pushbutton_fade_end_message(std::vector<std::string> split_messa
 void TCPServer::pushbutton_fade_start_message(std::vector<std::string> split_message, int client_fd)
 {
    bool has_direction = false;
-   int channel, tmp_direction;
+   int tmp_direction;
    bool is_direction_up;
+   CommandTarget target;
 
-   // Check if there are is at least space for the required fields
-   if (split_message.size() < 2)
-   {
-      logger("[TCP] Pushbutton Fade Start Command, no channel given!", LOG_WARN, true);
-      // Send else message to client
-      send_string(client_fd, "error,no_channel_given\n");
-      return;
-   }
-
-   // Convert channel number string to int
-   try
-   {
-      channel = std::stoi(split_message[1]);
-
-      // Check that channel value is acceptable
-      if (channel < 0 || channel > 511)
-      {
-         logger("[TCP] Pushbutton Fade Start Command, channel number out of range!", LOG_WARN, true);
-         // Send else message to client
-         send_string(client_fd, "error,channel_out_of_range\n");
-         return;
-      }
-   }
-   catch (const std::exception &e)
-   {
-      logger("[TCP] Pushbutton Fade Start Command, bad channel!", LOG_WARN, true);
-      // Send else message to client
-      send_string(client_fd, "error,bad_channel\n");
+   // Get channel or group the command applies to
+   if (!parse_target(split_message, client_fd, "Pushbutton Fade Start Command", target))
       return;
-   }
 
    // Parse parameters
    for (long unsigned int i = 2; i < split_message.size(); i++)
@@ -791,17 +1580,17 @@ void TCPServer::pushbutton_fade_start_message(std::vector<std::string> split_mes
                   is_direction_up = false;
                else
                {
-                  logger("[TCP] Pushbutton Fade Start Command, direction value can only be 0 or 1!", LOG_WARN, true);
+                  LOGGER_DEBUG("[TCP] Pushbutton Fade Start Command, direction value can only be 0 or 1!", LOG_WARN);
                   // Send else message to client
-                  send_string(client_fd, "error,direction_not_valid\n");
+                  send_error(client_fd, "direction_not_valid");
                   return;
                }
             }
             catch (const std::exception &e)
             {
-               logger("[TCP] Pushbutton Fade Start Command, bad direction!", LOG_WARN, true);
+               LOGGER_DEBUG("[TCP] Pushbutton Fade Start Command, bad direction!", LOG_WARN);
                // Send else message to client
-               send_string(client_fd, "error,bad_direction\n");
+               send_error(client_fd, "bad_direction");
                return;
             }
             has_direction = true;
@@ -810,139 +1599,1726 @@ void TCPServer::pushbutton_fade_start_message(std::vector<std::string> split_mes
    }
 
    if (has_direction)
-      logger("[TCP] Pushbutton Fade Start Command, channel: " + std::to_string(channel) + ", direction: " + (is_direction_up ? "up" : "down"), LOG_INFO, true);
+      LOGGER_DEBUG("[TCP] Pushbutton Fade Start Command, channel: " + target.name + ", direction: " + (is_direction_up ? "up" : "down"), LOG_INFO);
    else
-      logger("[TCP] Pushbutton Fade Start Command, channel: " + std::to_string(channel), LOG_INFO, true);
+      LOGGER_DEBUG("[TCP] Pushbutton Fade Start Command, channel: " + target.name, LOG_INFO);
 
    // Start pushbutton fade
-   start_pushbutton_fade(channel, has_direction, is_direction_up);
+   start_pushbutton_fade(target, has_direction, is_direction_up);
 
    // Send OK message to client
    send_string(client_fd, "ok\n");
 }
 
-void TCPServer::start_on_fade(int channel, bool has_brightness, bool has_transition, int brightness, int transition)
+/*
+ * Handles a scene save message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::scene_save_message(std::vector<std::string> split_message, int client_fd)
 {
-   // Acquire lock on light states
-   light_states_lock->lock();
-
-   // If brightness was not provided in the message, turn on to previous known brightness
-   if (!has_brightness)
-      brightness = light_states->outward_brightness[channel];
-
-   // If transition was not provided, use default transition
-   if (!has_transition)
-      transition = default_transition;
+   std::string name;
+   Scene scene;
 
-   // Set fade variables
-   light_states->fade_progress[channel] = 0;
-   light_states->fade_delta[channel] = 1000.0 / (fps * transition);         // 1 / FPS * transition if transition was in seconds
-   light_states->fade_start[channel] = light_states->fade_current[channel]; // Start where last fade ended
-   light_states->fade_end[channel] = brightness;
+   if (!parse_scene_name(split_message, client_fd, "Scene Save", name))
+      return;
 
-   // Set outward facing states
-   light_states->outward_state[channel] = true;
-   light_states->outward_brightness[channel] = brightness;
+   // Capture outward states, only ever written by this thread
+   for (int i = 0; i < 512; i++)
+   {
+      scene.state[i] = light_states->outward_state[i];
+      scene.brightness[i] = light_states->outward_brightness[i];
+   }
 
-   // Free lock
-   light_states_lock->unlock();
+   if (!scene_store->save(name, scene))
+   {
+      send_error(client_fd, "scene_save_failed");
+      return;
+   }
 
-   logger("[LIGHT] Starting fade, channel: " + std::to_string(channel) + ", start: " + std::to_string(light_states->fade_start[channel]) + ", end: " + std::to_string(light_states->fade_end[channel]) + ", delta: " + std::to_string(light_states->fade_delta[channel]), LOG_INFO, true);
+   LOGGER_DEBUG("[TCP] Scene Save Command, scene: " + name, LOG_INFO);
 
-   // Notify persistency writer of change
-   persistency_writer_cv->notify_all();
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
 }
 
-void TCPServer::start_off_fade(int channel, bool has_transition, int transition)
+/*
+ * Handles a scene recall message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::scene_recall_message(std::vector<std::string> split_message, int client_fd)
 {
-   // Acquire lock on light states
-   light_states_lock->lock();
+   bool has_transition = false;
+   int transition, started;
+   std::string name;
+   const Scene *scene;
 
-   // If transition was not provided, use default transition
-   if (!has_transition)
-      transition = default_transition;
+   if (!parse_scene_name(split_message, client_fd, "Scene Recall", name))
+      return;
+
+   // Parse parameters
+   for (long unsigned int i = 2; i < split_message.size(); i++)
+   {
+      // Check that the parameter isn't empty
+      if (split_message[i].length() < 1)
+         continue;
 
-   // Set transition variables
-   light_states->fade_progress[channel] = 0;
-   light_states->fade_delta[channel] = 1000.0 / (fps * transition);         // 1 / FPS * transition if transition was in seconds
-   light_states->fade_start[channel] = light_states->fade_current[channel]; // Start where last fade ended
-   light_states->fade_end[channel] = 0;
+      // Parameter is transition
+      if (split_message[i].at(0) == 't')
+      {
+         if (!has_transition)
+         {
+            // Check and store transition
+            try
+            {
+               transition = std::stoi(split_message[i].substr(1));
+               // Check that transition value is acceptable
+               if (transition < 0)
+               {
+                  LOGGER_DEBUG("[TCP] Scene Recall Command, transition value out of range!", LOG_WARN);
+                  // Send error message to client
+                  send_error(client_fd, "transition_out_of_range");
+                  return;
+               }
+            }
+            catch (const std::exception &e)
+            {
+               LOGGER_DEBUG("[TCP] Scene Recall Command, bad transition!", LOG_WARN);
+               // Send error message to client
+               send_error(client_fd, "bad_transition");
+               return;
+            }
+            has_transition = true;
+         }
+      }
+   }
 
-   // Set outward facing states
-   light_states->outward_state[channel] = false;
+   if (!(scene = scene_store->find(name)))
+   {
+      LOGGER_DEBUG("[TCP] Scene Recall Command, unknown scene " + name + "!", LOG_WARN);
+      send_error(client_fd, "unknown_scene");
+      return;
+   }
 
-   // Free lock
-   light_states_lock->unlock();
+   // Recall outside of the log message, which is only built with debug logging on
+   started = recall_scene(*scene, has_transition, transition);
 
-   logger("[LIGHT] Starting fade, channel: " + std::to_string(channel) + ", start: " + std::to_string(light_states->fade_start[channel]) + ", end: " + std::to_string(light_states->fade_end[channel]) + ", delta: " + std::to_string(light_states->fade_delta[channel]), LOG_INFO, true);
+   LOGGER_DEBUG("[TCP] Scene Recall Command, scene: " + name + ", fades started: " + std::to_string(started), LOG_INFO);
 
-   // Notify persistency writer of change
-   persistency_writer_cv->notify_all();
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
 }
 
-void TCPServer::start_pushbutton_fade(int channel, bool has_direction, bool is_direction_up)
+/*
+ * Handles a scene delete message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::scene_delete_message(std::vector<std::string> split_message, int client_fd)
 {
-   // Acquire lock on light states
-   light_states_lock->lock();
+   std::string name;
+
+   if (!parse_scene_name(split_message, client_fd, "Scene Delete", name))
+      return;
 
-   if (!light_states->pushbutton_fade[channel])
+   if (!scene_store->find(name))
    {
-      // Set transition variables
-      light_states->pushbutton_fade[channel] = true;
-      light_states->pushbutton_fade_up[channel] = get_pushbutton_fade_direction(channel, has_direction, is_direction_up);
-      light_states->pushbutton_fade_current[channel] = light_states->fade_current[channel];
-      light_states->pushbutton_fade_pause_counter[channel] = 0;
-      logger("[LIGHT] Starting pushbuton fade, channel: " + std::to_string(channel) + ", direction: " + (light_states->pushbutton_fade_up[channel] ? "up" : "down"), LOG_INFO, true);
+      LOGGER_DEBUG("[TCP] Scene Delete Command, unknown scene " + name + "!", LOG_WARN);
+      send_error(client_fd, "unknown_scene");
+      return;
+   }
+
+   if (!scene_store->remove(name))
+   {
+      send_error(client_fd, "scene_delete_failed");
+      return;
    }
-   else
 
-      logger("[LIGHT] Pushbutton fade already started: channel: " + std::to_string(channel) + ", direction: " + (light_states->pushbutton_fade_up[channel] ? "up" : "down"), LOG_INFO, true);
+   LOGGER_DEBUG("[TCP] Scene Delete Command, scene: " + name, LOG_INFO);
 
-   // Free lock
-   light_states_lock->unlock();
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
 }
 
-bool TCPServer::get_pushbutton_fade_direction(int channel, bool has_direction, bool is_direction_up)
+/*
+ * Gets the scene name of a scene message, sending an error to the client if it's not valid
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ *  - int client_fd: client socket file descriptor
+ *  - std::string command_name: command name for log messages
+ *  - std::string &name: where to store the scene name
+ * Returns: true if the scene name is valid
+ */
+bool TCPServer::parse_scene_name(std::vector<std::string> split_message, int client_fd, std::string command_name, std::string &name)
 {
-   // If the message contained a direction, use that
-   if (has_direction)
-      return is_direction_up;
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 2)
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, no scene given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_scene_given");
+      return false;
+   }
 
-   // Check if last fade was before or after reset delay
-   int seconds_since_last_fade = std::chrono::duration_cast<std::chrono::seconds>(
-                                     std::chrono::steady_clock::now() - light_states->pushbutton_fade_end_time[channel])
-                                     .count();
-   if (seconds_since_last_fade < direction_reset_delay)
-      // Invert last direction
-      return !light_states->pushbutton_fade_up[channel];
-   else
-   // Choose direction based on current brightness
+   name = split_message[1];
+
+   if (!is_valid_scene_name(name))
    {
-      return light_states->fade_current[channel] < 128;
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, bad scene name!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "bad_scene_name");
+      return false;
    }
 
    return true;
 }
 
-void TCPServer::end_pushbutton_fade(int channel)
+/*
+ * Handles an effect start message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::effect_start_message(std::vector<std::string> split_message, int client_fd)
 {
-   // Acquire lock on light states
-   light_states_lock->lock();
+   EffectParameters parameters;
+   int id;
 
-   // Set transition variables
-   light_states->pushbutton_fade[channel] = false;
-   light_states->pushbutton_fade_end_time[channel] = std::chrono::steady_clock::now(); // Store last time fade was ended
-   light_states->fade_current[channel] = light_states->pushbutton_fade_current[channel];
+   if (!parse_effect_id(split_message, client_fd, "Effect Start", id) || !parse_effect_parameters(split_message, client_fd, "Effect Start", parameters))
+      return;
 
-   // Change outward states
-   light_states->outward_brightness[channel] = light_states->fade_current[channel];
-   light_states->outward_state[channel] = true;
+   LOGGER_DEBUG("[TCP] Effect Start Command, effect: " + std::to_string(id) + ", type: " + split_message[2] + ", channels: " + std::to_string(parameters.first) + "-" + std::to_string(parameters.first + parameters.count - 1), LOG_INFO);
 
-   // Free lock
-   light_states_lock->unlock();
+   effects->start_effect(id, parameters);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles an effect stop message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::effect_stop_message(std::vector<std::string> split_message, int client_fd)
+{
+   int id;
+
+   if (!parse_effect_id(split_message, client_fd, "Effect Stop", id))
+      return;
+
+   LOGGER_DEBUG("[TCP] Effect Stop Command, effect: " + std::to_string(id), LOG_INFO);
+
+   effects->stop_effect(id);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Gets the effect id of an effect message, sending an error to the client if it's not valid
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ *  - int client_fd: client socket file descriptor
+ *  - std::string command_name: command name for log messages
+ *  - int &id: where to store the effect id
+ * Returns: true if the effect id is valid
+ */
+bool TCPServer::parse_effect_id(std::vector<std::string> split_message, int client_fd, std::string command_name, int &id)
+{
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 2)
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, no effect given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_effect_given");
+      return false;
+   }
+
+   // Convert effect id string to int
+   try
+   {
+      id = std::stoi(split_message[1]);
+
+      // Check that effect id is acceptable
+      if (id < 0 || id >= EFFECTS_MAX)
+      {
+         LOGGER_DEBUG("[TCP] " + command_name + " Command, effect out of range!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, "effect_out_of_range");
+         return false;
+      }
+   }
+   catch (const std::exception &e)
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, bad effect!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "bad_effect");
+      return false;
+   }
+
+   return true;
+}
+
+/*
+ * Gets the type, channel range and parameters of an effect start message, sending an error to the client if they're not valid
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ *  - int client_fd: client socket file descriptor
+ *  - std::string command_name: command name for log messages
+ *  - EffectParameters &parameters: where to store the effect parameters
+ * Returns: true if the parameters are valid
+ */
+bool TCPServer::parse_effect_parameters(std::vector<std::string> split_message, int client_fd, std::string command_name, EffectParameters &parameters)
+{
+   std::vector<std::string> range_split;
+   bool has_width = false;
+   int last;
+
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 4)
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, no effect type or channel range given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_effect_range_given");
+      return false;
+   }
+
+   if ((parameters.type = effect_type_from_name(split_message[2])) < 0)
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, unknown effect type!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "unknown_effect_type");
+      return false;
+   }
+
+   // Convert channel range string to ints
+   range_split = split_string(split_message[3], '-');
+   try
+   {
+      if (range_split.size() < 1 || range_split.size() > 2)
+         throw std::invalid_argument("range");
+
+      parameters.first = std::stoi(range_split[0]);
+      last = std::stoi(range_split.back());
+
+      // Check that range is acceptable
+      if (parameters.first < 0 || last > 511 || parameters.first > last)
+      {
+         LOGGER_DEBUG("[TCP] " + command_name + " Command, channel range out of range!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, "range_out_of_range");
+         return false;
+      }
+   }
+   catch (const std::exception &e)
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, bad channel range!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "bad_range");
+      return false;
+   }
+   parameters.count = last - parameters.first + 1;
+
+   // Default parameters
+   parameters.period = 1000;
+   parameters.low = 0;
+   parameters.high = 255;
+   parameters.width = 1;
+   parameters.blend = EFFECT_BLEND_HTP;
+
+   // Parse parameters
+   for (long unsigned int i = 4; i < split_message.size(); i++)
+   {
+      int value, min, max, *target;
+      std::string name;
+
+      // Check that the parameter isn't empty
+      if (split_message[i].length() < 1)
+         continue;
+
+      switch (split_message[i].at(0))
+      {
+      case 'p':
+         name = "period";
+         target = &parameters.period;
+         min = 1;
+         max = 3600000;
+         break;
+      case 'l':
+         name = "low";
+         target = &parameters.low;
+         min = 0;
+         max = 255;
+         break;
+      case 'h':
+         name = "high";
+         target = &parameters.high;
+         min = 0;
+         max = 255;
+         break;
+      case 'w':
+         name = "width";
+         target = &parameters.width;
+         min = 1;
+         max = 512;
+         has_width = true;
+         break;
+      case 'm':
+         name = "blend";
+         target = &parameters.blend;
+         min = EFFECT_BLEND_HTP;
+         max = EFFECT_BLEND_MULTIPLY;
+         break;
+      default:
+         continue;
+      }
+
+      // Check and store value
+      try
+      {
+         value = std::stoi(split_message[i].substr(1));
+      }
+      catch (const std::exception &e)
+      {
+         LOGGER_DEBUG("[TCP] " + command_name + " Command, bad " + name + "!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, "bad_" + name);
+         return false;
+      }
+
+      // Check that value is acceptable
+      if (value < min || value > max)
+      {
+         LOGGER_DEBUG("[TCP] " + command_name + " Command, " + name + " value out of range!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, name + "_out_of_range");
+         return false;
+      }
+
+      *target = value;
+   }
+
+   // A wave spans the whole range unless told otherwise
+   if (parameters.type == EFFECT_WAVE && !has_width)
+      parameters.width = parameters.count;
+
+   return true;
+}
+
+/*
+ * Handles a source message from the client. Following on and off
+ * commands of the client go to the named source
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::source_message(std::vector<std::string> split_message, int client_fd)
+{
+   bool has_priority = false;
+   int priority, source;
+   std::string name;
+
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 2)
+   {
+      LOGGER_DEBUG("[TCP] Source Command, no source given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_source_given");
+      return;
+   }
+
+   name = split_message[1];
+
+   // Back to the light states
+   if (name == SOURCE_MAIN_NAME)
+   {
+      LOGGER_DEBUG("[TCP] Source Command, source: " + name, LOG_INFO);
+      set_client_source(client_fd, -1);
+      send_string(client_fd, "ok\n");
+      return;
+   }
+
+   if (!is_valid_source_name(name))
+   {
+      LOGGER_DEBUG("[TCP] Source Command, bad source name!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "bad_source_name");
+      return;
+   }
+
+   // Parse parameters
+   for (long unsigned int i = 2; i < split_message.size(); i++)
+   {
+      // Check that the parameter isn't empty
+      if (split_message[i].length() < 1)
+         continue;
+
+      // Parameter is priority
+      if (split_message[i].at(0) == 'p' && !has_priority)
+      {
+         // Check and store priority
+         try
+         {
+            priority = std::stoi(split_message[i].substr(1));
+
+            // Check that priority value is acceptable
+            if (priority < 0 || priority > SOURCE_PRIORITY_MAX)
+            {
+               LOGGER_DEBUG("[TCP] Source Command, priority value out of range!", LOG_WARN);
+               // Send error message to client
+               send_error(client_fd, "priority_out_of_range");
+               return;
+            }
+         }
+         catch (const std::exception &e)
+         {
+            LOGGER_DEBUG("[TCP] Source Command, bad priority!", LOG_WARN);
+            // Send error message to client
+            send_error(client_fd, "bad_priority");
+            return;
+         }
+         has_priority = true;
+      }
+   }
+
+   if ((source = sources->open_source(name, has_priority, priority)) < 0)
+   {
+      LOGGER_DEBUG("[TCP] Source Command, maximum amount of sources reached!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "too_many_sources");
+      return;
+   }
+
+   LOGGER_DEBUG("[TCP] Source Command, source: " + name, LOG_INFO);
+
+   set_client_source(client_fd, source);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a release message from the client. The source of the client
+ * stops contributing to the channels
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::release_message(std::vector<std::string> split_message, int client_fd)
+{
+   CommandTarget target;
+   int source;
+
+   // Get channel or group the command applies to
+   if (!parse_target(split_message, client_fd, "Release Command", target))
+      return;
+
+   // Main source always covers all channels
+   if ((source = get_client_source(client_fd)) < 0)
+   {
+      LOGGER_DEBUG("[TCP] Release Command, client has no source!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_source");
+      return;
+   }
+
+   LOGGER_DEBUG("[TCP] Release Command, channel: " + target.name, LOG_INFO);
+
+   sources->release(source, target.count, target.channels);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a source delete message from the client. Clients using the
+ * source go back to the main source
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::source_delete_message(std::vector<std::string> split_message, int client_fd)
+{
+   int source;
+
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 2)
+   {
+      LOGGER_DEBUG("[TCP] Source Delete Command, no source given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_source_given");
+      return;
+   }
+
+   if ((source = sources->remove_source(split_message[1])) < 0)
+   {
+      LOGGER_DEBUG("[TCP] Source Delete Command, unknown source " + split_message[1] + "!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "unknown_source");
+      return;
+   }
+
+   for (int i = 0; i < max_clients; i++)
+      if (client_source[i] == source)
+         client_source[i] = -1;
+
+   LOGGER_DEBUG("[TCP] Source Delete Command, source: " + split_message[1], LOG_INFO);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Gets the named source a client gives commands to
+ * parameters:
+ *  - int client_fd: client socket file descriptor
+ * Returns: id of the source, -1 for the main source
+ */
+int TCPServer::get_client_source(int client_fd)
+{
+   int i = get_client_index(client_fd);
+
+   return i < 0 ? -1 : client_source[i];
+}
+
+/*
+ * Sets the named source a client gives commands to
+ * parameters:
+ *  - int client_fd: client socket file descriptor
+ *  - int source: source id, -1 for the main source
+ */
+void TCPServer::set_client_source(int client_fd, int source)
+{
+   int i = get_client_index(client_fd);
+
+   if (i >= 0)
+      client_source[i] = source;
+}
+
+/*
+ * Handles a grand master message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::grand_master_message(std::vector<std::string> split_message, int client_fd)
+{
+   MasterChange change;
+   bool has_level;
+   int level;
+
+   change.type = MASTER_GRAND;
+   change.transition = default_transition;
+   if (!parse_master_parameters(split_message, 1, client_fd, "Grand Master", has_level, level, change.transition))
+      return;
+
+   if (!has_level)
+   {
+      LOGGER_DEBUG("[TCP] Grand Master Command, no brightness given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_brightness_given");
+      return;
+   }
+   change.level = level;
+
+   LOGGER_DEBUG("[TCP] Grand Master Command, brightness: " + std::to_string(level) + ", transition: " + std::to_string(change.transition) + "ms", LOG_INFO);
+
+   masters->set_master(change);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a submaster message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::submaster_message(std::vector<std::string> split_message, int client_fd)
+{
+   MasterChange change;
+   bool has_level;
+   int level;
+
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 2)
+   {
+      LOGGER_DEBUG("[TCP] Submaster Command, no group given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_group_given");
+      return;
+   }
+
+   if (config->groups.find(split_message[1]) == config->groups.end())
+   {
+      LOGGER_DEBUG("[TCP] Submaster Command, unknown group " + split_message[1] + "!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "unknown_group");
+      return;
+   }
+
+   change.type = MASTER_SUB;
+   change.group = split_message[1];
+   change.transition = default_transition;
+   if (!parse_master_parameters(split_message, 2, client_fd, "Submaster", has_level, level, change.transition))
+      return;
+
+   if (!has_level)
+   {
+      LOGGER_DEBUG("[TCP] Submaster Command, no brightness given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_brightness_given");
+      return;
+   }
+   change.level = level;
+
+   LOGGER_DEBUG("[TCP] Submaster Command, group: " + change.group + ", brightness: " + std::to_string(level) + ", transition: " + std::to_string(change.transition) + "ms", LOG_INFO);
+
+   masters->set_master(change);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a blackout message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::blackout_message(std::vector<std::string> split_message, int client_fd)
+{
+   MasterChange change;
+   bool is_on, has_level;
+   int level;
+
+   if (!parse_toggle(split_message, client_fd, "Blackout", is_on))
+      return;
+
+   // Blackout is immediate unless a transition is given
+   change.type = MASTER_BLACKOUT;
+   change.transition = 0;
+   if (!parse_master_parameters(split_message, 2, client_fd, "Blackout", has_level, level, change.transition))
+      return;
+   change.level = is_on ? 0 : 255;
+
+   LOGGER_DEBUG("[TCP] Blackout Command, state: " + std::to_string(is_on) + ", transition: " + std::to_string(change.transition) + "ms", LOG_INFO);
+
+   masters->set_master(change);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a freeze message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::freeze_message(std::vector<std::string> split_message, int client_fd)
+{
+   bool is_on;
+
+   if (!parse_toggle(split_message, client_fd, "Freeze", is_on))
+      return;
+
+   LOGGER_DEBUG("[TCP] Freeze Command, state: " + std::to_string(is_on), LOG_INFO);
+
+   masters->set_frozen(is_on);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a master status request message from the client and sends correct response
+ * parameters:
+ *  - int client_fd: client socket file descriptor
+ */
+void TCPServer::master_status_request_message(int client_fd)
+{
+   std::string message;
+
+   message.append("mres,");
+   message.append(std::to_string(std::lround(masters->get_grand_master())));
+   message.append(",");
+   message.append(std::to_string(masters->is_blackout()));
+   message.append(",");
+   message.append(std::to_string(masters->is_frozen()));
+   message.append("\n");
+
+   send_string(client_fd, message);
+}
+
+/*
+ * Handles a color message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::color_message(std::vector<std::string> split_message, int client_fd)
+{
+   std::map<std::string, FixtureDefinition>::const_iterator fixture;
+   const std::string parameters = "hskbt";
+   const std::string names[] = {"hue", "saturation", "temperature", "brightness", "transition"};
+   bool has_value[5] = {};
+   int values[5];
+   double levels[4];
+   ColorChange change;
+
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 2)
+   {
+      LOGGER_DEBUG("[TCP] Color Command, no fixture given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_fixture_given");
+      return;
+   }
+
+   if ((fixture = config->fixtures.find(split_message[1])) == config->fixtures.end())
+   {
+      LOGGER_DEBUG("[TCP] Color Command, unknown fixture " + split_message[1] + "!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "unknown_fixture");
+      return;
+   }
+
+   const FixtureDefinition &definition = fixture->second;
+
+   // Lowest and highest value of each parameter
+   const int ranges[5][2] = {{0, 360}, {0, 100}, {definition.warm_temperature, definition.cool_temperature}, {0, 255}, {0, INT32_MAX}};
+
+   // Defaults: fully saturated red, warm white, full brightness
+   values[0] = 0;
+   values[1] = 100;
+   values[2] = definition.warm_temperature;
+   values[3] = 255;
+   values[4] = default_transition;
+
+   // Parse parameters
+   for (long unsigned int i = 2; i < split_message.size(); i++)
+   {
+      size_t parameter;
+
+      // Check that the parameter isn't empty
+      if (split_message[i].length() < 1 || (parameter = parameters.find(split_message[i].at(0))) == std::string::npos || has_value[parameter])
+         continue;
+
+      // Check and store value
+      try
+      {
+         values[parameter] = std::stoi(split_message[i].substr(1));
+      }
+      catch (const std::exception &e)
+      {
+         LOGGER_DEBUG("[TCP] Color Command, bad " + names[parameter] + "!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, "bad_" + names[parameter]);
+         return;
+      }
+
+      if (values[parameter] < ranges[parameter][0] || values[parameter] > ranges[parameter][1])
+      {
+         LOGGER_DEBUG("[TCP] Color Command, " + names[parameter] + " value out of range!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, names[parameter] + "_out_of_range");
+         return;
+      }
+
+      has_value[parameter] = true;
+   }
+
+   // Hue and saturation only make sense for colors, temperature for whites
+   if ((definition.type == FIXTURE_TYPE_CCT && (has_value[0] || has_value[1])) || (definition.type != FIXTURE_TYPE_CCT && has_value[2]))
+   {
+      LOGGER_DEBUG("[TCP] Color Command, parameter not supported by fixture " + fixture->first + "!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "unsupported_parameter");
+      return;
+   }
+
+   change.fixture = fixture->first;
+   change.transition = values[4];
+   if (definition.type == FIXTURE_TYPE_CCT)
+      temperature_to_fixture_color(values[2], values[3], change.color);
+   else
+      hsv_to_fixture_color(values[0], values[1], values[3], change.color);
+
+   LOGGER_DEBUG("[TCP] Color Command, fixture: " + change.fixture + ", transition: " + std::to_string(change.transition) + "ms", LOG_INFO);
+
+   // Set outward facing states of the channels to where the fade ends
+   fixture_color_to_levels(definition, change.color, levels);
+   for (int i = 0; i < definition.channel_count; i++)
+   {
+      const int channel = definition.channel + i;
+
+      // Channels left at 0 are off and keep their last brightness
+      light_states->outward_state[channel] = levels[i] >= 0.5;
+      if (light_states->outward_state[channel])
+         set_outward_brightness(*light_states, channel, levels[i]);
+      mark_channel_changed(channel);
+   }
+
+   // Queue fade, the LightRenderer will start it on the next frame
+   fixtures->set_color(change);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a cue load message from the client. The cue list is read from
+ * its file in the cue lists path, replacing the loaded one with the same name
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::cue_load_message(std::vector<std::string> split_message, int client_fd)
+{
+   std::shared_ptr<CueList> list = std::make_shared<CueList>();
+   std::string name, line;
+   std::ifstream file;
+   int line_number = 0, previous_time = 0;
+
+   if (!parse_cue_list_name(split_message, client_fd, "Cue Load", name))
+      return;
+
+   file.open(config->cue_lists_path + "/" + name + CUE_LIST_FILE_EXTENSION);
+   if (!file.is_open())
+   {
+      LOGGER_DEBUG("[TCP] Cue Load Command, cue list " + name + " not found!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "cue_list_not_found");
+      return;
+   }
+
+   while (std::getline(file, line))
+   {
+      CueEvent event;
+
+      line_number++;
+
+      // Whitespace is ignored, like in the config file
+      line.erase(std::remove_if(line.begin(), line.end(), [](char c) { return isspace((unsigned char)c); }), line.end());
+
+      // Skip empty lines and comments
+      if (line.empty() || line[0] == '#')
+         continue;
+
+      if (list->events.size() >= CUE_EVENTS_MAX)
+      {
+         LOGGER_DEBUG("[TCP] Cue Load Command, cue list " + name + " has too many events!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, "cue_list_too_long");
+         return;
+      }
+
+      if (!parse_cue_event(split_string(line, ','), client_fd, previous_time, event))
+      {
+         logger("[TCP] Cue list " + name + ", line " + std::to_string(line_number) + " is not valid!", LOG_WARN, false);
+         return;
+      }
+
+      previous_time = event.time;
+      list->events.push_back(event);
+   }
+
+   // Events can be written in any order, those at the same time fire in file order
+   std::stable_sort(list->events.begin(), list->events.end(), [](const CueEvent &a, const CueEvent &b) { return a.time < b.time; });
+   list->length = list->events.empty() ? 0 : list->events.back().time;
+
+   if (!sequencer->set_list(name, list))
+   {
+      LOGGER_DEBUG("[TCP] Cue Load Command, too many cue lists!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "too_many_cue_lists");
+      return;
+   }
+
+   LOGGER_DEBUG("[TCP] Cue Load Command, cue list: " + name + ", events: " + std::to_string(list->events.size()), LOG_INFO);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a cue add message from the client. The event is added to the
+ * cue list, which is created if it isn't loaded
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::cue_add_message(std::vector<std::string> split_message, int client_fd)
+{
+   std::shared_ptr<const CueList> existing;
+   std::shared_ptr<CueList> list;
+   CueEvent event;
+   std::string name;
+
+   if (!parse_cue_list_name(split_message, client_fd, "Cue Add", name))
+      return;
+
+   // Loaded cue lists are never changed, the rendering thread may be playing them
+   existing = sequencer->find_list(name);
+   list = existing ? std::make_shared<CueList>(*existing) : std::make_shared<CueList>();
+
+   if (list->events.size() >= CUE_EVENTS_MAX)
+   {
+      LOGGER_DEBUG("[TCP] Cue Add Command, cue list " + name + " has too many events!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "cue_list_too_long");
+      return;
+   }
+
+   // Relative times follow the last event of the cue list
+   if (!parse_cue_event(std::vector<std::string>(split_message.begin() + 2, split_message.end()), client_fd, list->length, event))
+      return;
+
+   list->events.insert(std::upper_bound(list->events.begin(), list->events.end(), event, [](const CueEvent &a, const CueEvent &b) { return a.time < b.time; }), event);
+   list->length = list->events.back().time;
+
+   if (!sequencer->set_list(name, list))
+   {
+      LOGGER_DEBUG("[TCP] Cue Add Command, too many cue lists!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "too_many_cue_lists");
+      return;
+   }
+
+   LOGGER_DEBUG("[TCP] Cue Add Command, cue list: " + name + ", time: " + std::to_string(event.time) + "ms", LOG_INFO);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a cue delete message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::cue_delete_message(std::vector<std::string> split_message, int client_fd)
+{
+   std::string name;
+
+   if (!parse_cue_list_name(split_message, client_fd, "Cue Delete", name))
+      return;
+
+   if (!sequencer->remove_list(name))
+   {
+      LOGGER_DEBUG("[TCP] Cue Delete Command, unknown cue list " + name + "!", LOG_WARN);
+      send_error(client_fd, "unknown_cue_list");
+      return;
+   }
+
+   LOGGER_DEBUG("[TCP] Cue Delete Command, cue list: " + name, LOG_INFO);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a cue go message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::cue_go_message(std::vector<std::string> split_message, int client_fd)
+{
+   std::string name;
+
+   if (!parse_cue_list_name(split_message, client_fd, "Cue Go", name))
+      return;
+
+   if (!sequencer->go(name))
+   {
+      LOGGER_DEBUG("[TCP] Cue Go Command, unknown cue list " + name + "!", LOG_WARN);
+      send_error(client_fd, "unknown_cue_list");
+      return;
+   }
+
+   LOGGER_DEBUG("[TCP] Cue Go Command, cue list: " + name, LOG_INFO);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a cue pause message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::cue_pause_message(std::vector<std::string> split_message, int client_fd)
+{
+   std::string name;
+
+   if (!parse_cue_list_name(split_message, client_fd, "Cue Pause", name))
+      return;
+
+   if (!sequencer->pause(name))
+   {
+      LOGGER_DEBUG("[TCP] Cue Pause Command, unknown cue list " + name + "!", LOG_WARN);
+      send_error(client_fd, "unknown_cue_list");
+      return;
+   }
+
+   LOGGER_DEBUG("[TCP] Cue Pause Command, cue list: " + name, LOG_INFO);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a cue stop message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::cue_stop_message(std::vector<std::string> split_message, int client_fd)
+{
+   std::string name;
+
+   if (!parse_cue_list_name(split_message, client_fd, "Cue Stop", name))
+      return;
+
+   if (!sequencer->stop(name))
+   {
+      LOGGER_DEBUG("[TCP] Cue Stop Command, unknown cue list " + name + "!", LOG_WARN);
+      send_error(client_fd, "unknown_cue_list");
+      return;
+   }
+
+   LOGGER_DEBUG("[TCP] Cue Stop Command, cue list: " + name, LOG_INFO);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a cue seek message from the client
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::cue_seek_message(std::vector<std::string> split_message, int client_fd)
+{
+   std::string name;
+   int position;
+
+   if (!parse_cue_list_name(split_message, client_fd, "Cue Seek", name))
+      return;
+
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 3)
+   {
+      LOGGER_DEBUG("[TCP] Cue Seek Command, no position given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_position_given");
+      return;
+   }
+
+   // Convert position string to int
+   try
+   {
+      position = std::stoi(split_message[2]);
+
+      // Check that position is acceptable
+      if (position < 0)
+      {
+         LOGGER_DEBUG("[TCP] Cue Seek Command, position out of range!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, "position_out_of_range");
+         return;
+      }
+   }
+   catch (const std::exception &e)
+   {
+      LOGGER_DEBUG("[TCP] Cue Seek Command, bad position!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "bad_position");
+      return;
+   }
+
+   if (!sequencer->seek(name, position))
+   {
+      LOGGER_DEBUG("[TCP] Cue Seek Command, unknown cue list " + name + "!", LOG_WARN);
+      send_error(client_fd, "unknown_cue_list");
+      return;
+   }
+
+   LOGGER_DEBUG("[TCP] Cue Seek Command, cue list: " + name + ", position: " + std::to_string(position) + "ms", LOG_INFO);
+
+   // Send OK message to client
+   send_string(client_fd, "ok\n");
+}
+
+/*
+ * Handles a cue status request message from the client and sends correct response
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ */
+void TCPServer::cue_status_request_message(std::vector<std::string> split_message, int client_fd)
+{
+   std::string name, message;
+   int state, position;
+
+   if (!parse_cue_list_name(split_message, client_fd, "Cue Status Request", name))
+      return;
+
+   if (!sequencer->get_status(name, state, position))
+   {
+      LOGGER_DEBUG("[TCP] Cue Status Request Command, unknown cue list " + name + "!", LOG_WARN);
+      send_error(client_fd, "unknown_cue_list");
+      return;
+   }
+
+   message.append("cue_res,");
+   message.append(name);
+   message.append(",");
+   message.append(std::to_string(state));
+   message.append(",");
+   message.append(std::to_string(position));
+   message.append(",");
+   message.append(std::to_string(sequencer->find_list(name)->length));
+   message.append("\n");
+
+   send_string(client_fd, message);
+}
+
+/*
+ * Gets the cue list name of a cue message, sending an error to the client if it's not valid
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ *  - int client_fd: client socket file descriptor
+ *  - std::string command_name: command name for log messages
+ *  - std::string &name: where to store the cue list name
+ * Returns: true if the cue list name is valid
+ */
+bool TCPServer::parse_cue_list_name(std::vector<std::string> split_message, int client_fd, std::string command_name, std::string &name)
+{
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 2)
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, no cue list given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_cue_list_given");
+      return false;
+   }
+
+   name = split_message[1];
+
+   if (!is_valid_cue_list_name(name))
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, bad cue list name!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "bad_cue_list_name");
+      return false;
+   }
+
+   return true;
+}
+
+/*
+ * Compiles an event of a cue list, sending an error to the client if it's not valid.
+ * Channels and scenes are resolved now, so the rendering thread only has to queue commands
+ * parameters:
+ *  - std::vector<std::string> split_message: time followed by the event command and its parameters
+ *  - int client_fd: client socket file descriptor
+ *  - int previous_time: time relative times are added to, in ms
+ *  - CueEvent &event: where to store the event
+ * Returns: true if the event is valid
+ */
+bool TCPServer::parse_cue_event(std::vector<std::string> split_message, int client_fd, int previous_time, CueEvent &event)
+{
+   std::vector<std::string> command;
+   CommandTarget target;
+   LightCommand light_command;
+   bool has_level;
+   int level;
+   std::string name;
+   const Scene *scene;
+   long long time;
+
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 2 || split_message[1].empty())
+   {
+      LOGGER_DEBUG("[TCP] Cue Event, no event given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_cue_event_given");
+      return false;
+   }
+
+   // Convert time string to int, relative to the previous event if it starts with '+'
+   try
+   {
+      const bool is_relative = !split_message[0].empty() && split_message[0][0] == '+';
+
+      time = std::stoi(split_message[0].substr(is_relative));
+      if (is_relative)
+         time += previous_time;
+
+      // Check that time is acceptable
+      if (time < 0 || time > INT32_MAX || (is_relative && split_message[0].size() > 1 && split_message[0][1] == '-'))
+      {
+         LOGGER_DEBUG("[TCP] Cue Event, time out of range!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, "time_out_of_range");
+         return false;
+      }
+   }
+   catch (const std::exception &e)
+   {
+      LOGGER_DEBUG("[TCP] Cue Event, bad time!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "bad_time");
+      return false;
+   }
+   event.time = time;
+
+   // Event commands have the same fields as the messages they're named after
+   command.assign(split_message.begin() + 1, split_message.end());
+   event.sets_brightness = false;
+   light_command.transition = default_transition;
+
+   if (command[0] == "on" || command[0] == "off")
+   {
+      if (!parse_target(command, client_fd, "Cue Event", target) || !parse_master_parameters(command, 2, client_fd, "Cue Event", has_level, level, light_command.transition))
+         return false;
+
+      // Cues turn channels on at full brightness unless told otherwise
+      event.type = CUE_EVENT_FADE;
+      light_command.type = command[0] == "on" ? LIGHT_COMMAND_ON : LIGHT_COMMAND_OFF;
+      light_command.brightness = light_command.type == LIGHT_COMMAND_ON ? (has_level ? level : 255) : 0;
+      event.channels.assign(target.channels, target.channels + target.count);
+      event.commands.assign(target.count, light_command);
+   }
+   else if (command[0] == "scene_recall")
+   {
+      if (!parse_scene_name(command, client_fd, "Cue Event", name) || !parse_master_parameters(command, 2, client_fd, "Cue Event", has_level, level, light_command.transition))
+         return false;
+
+      if (!(scene = scene_store->find(name)))
+      {
+         LOGGER_DEBUG("[TCP] Cue Event, unknown scene " + name + "!", LOG_WARN);
+         send_error(client_fd, "unknown_scene");
+         return false;
+      }
+
+      // Channels turned off keep the brightness of the scene, like a recall
+      event.type = CUE_EVENT_FADE;
+      event.sets_brightness = true;
+      for (int i = 0; i < 512; i++)
+      {
+         light_command.type = scene->state[i] ? LIGHT_COMMAND_ON : LIGHT_COMMAND_OFF;
+         light_command.brightness = scene->brightness[i];
+         event.channels.push_back(i);
+         event.commands.push_back(light_command);
+      }
+   }
+   else if (command[0] == "fxstart")
+   {
+      if (!parse_effect_id(command, client_fd, "Cue Event", event.effect) || !parse_effect_parameters(command, client_fd, "Cue Event", event.effect_parameters))
+         return false;
+
+      event.type = CUE_EVENT_EFFECT_START;
+   }
+   else if (command[0] == "fxstop")
+   {
+      if (!parse_effect_id(command, client_fd, "Cue Event", event.effect))
+         return false;
+
+      event.type = CUE_EVENT_EFFECT_STOP;
+   }
+   else
+   {
+      LOGGER_DEBUG("[TCP] Cue Event, unknown event " + command[0] + "!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "unknown_cue_event");
+      return false;
+   }
+
+   return true;
+}
+
+/*
+ * Gets the brightness and transition parameters of a master message, sending an error to the client if they're not valid
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ *  - long unsigned int first: position of the first parameter
+ *  - int client_fd: client socket file descriptor
+ *  - std::string command_name: command name for log messages
+ *  - bool &has_level: set if brightness was given
+ *  - int &level: where to store the brightness
+ *  - int &transition: where to store the transition, left as is if not given
+ * Returns: true if the parameters are valid
+ */
+bool TCPServer::parse_master_parameters(std::vector<std::string> split_message, long unsigned int first, int client_fd, std::string command_name, bool &has_level, int &level, int &transition)
+{
+   bool has_transition = false;
+
+   has_level = false;
+
+   for (long unsigned int i = first; i < split_message.size(); i++)
+   {
+      int value;
+
+      // Check that the parameter isn't empty
+      if (split_message[i].length() < 1 || (split_message[i].at(0) != 'b' && split_message[i].at(0) != 't'))
+         continue;
+
+      // Check and store value
+      try
+      {
+         value = std::stoi(split_message[i].substr(1));
+      }
+      catch (const std::exception &e)
+      {
+         LOGGER_DEBUG("[TCP] " + command_name + " Command, bad parameter!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, split_message[i].at(0) == 'b' ? "bad_brightness" : "bad_transition");
+         return false;
+      }
+
+      // Parameter is brightness
+      if (split_message[i].at(0) == 'b' && !has_level)
+      {
+         if (value < 0 || value > 255)
+         {
+            LOGGER_DEBUG("[TCP] " + command_name + " Command, brightness value out of range!", LOG_WARN);
+            // Send error message to client
+            send_error(client_fd, "brightness_out_of_range");
+            return false;
+         }
+         level = value;
+         has_level = true;
+      }
+
+      // Parameter is transition
+      else if (split_message[i].at(0) == 't' && !has_transition)
+      {
+         if (value < 0)
+         {
+            LOGGER_DEBUG("[TCP] " + command_name + " Command, transition value out of range!", LOG_WARN);
+            // Send error message to client
+            send_error(client_fd, "transition_out_of_range");
+            return false;
+         }
+         transition = value;
+         has_transition = true;
+      }
+   }
+
+   return true;
+}
+
+/*
+ * Gets the on/off state of a toggle message, sending an error to the client if it's not valid
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ *  - int client_fd: client socket file descriptor
+ *  - std::string command_name: command name for log messages
+ *  - bool &value: where to store the state
+ * Returns: true if the state is valid
+ */
+bool TCPServer::parse_toggle(std::vector<std::string> split_message, int client_fd, std::string command_name, bool &value)
+{
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 2)
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, no state given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_state_given");
+      return false;
+   }
+
+   if (split_message[1] != "0" && split_message[1] != "1")
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + " Command, bad state!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "bad_state");
+      return false;
+   }
+
+   value = split_message[1] == "1";
+   return true;
+}
+
+/*
+ * Gets the channel or group a message applies to, sending an error to the client if it's not valid
+ * parameters:
+ *  - std::vector<std::string> split_message: complete message to get parameters
+ *  - int client_fd: client socket file descriptor
+ *  - std::string command_name: command name for log messages
+ *  - CommandTarget &target: where to store the channels
+ * Returns: true if the channel or group is valid
+ */
+bool TCPServer::parse_target(std::vector<std::string> split_message, int client_fd, std::string command_name, CommandTarget &target)
+{
+   std::map<std::string, std::vector<int>>::const_iterator group;
+
+   // Check if there are is at least space for the required fields
+   if (split_message.size() < 2)
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + ", no channel given!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "no_channel_given");
+      return false;
+   }
+
+   target.name = split_message[1];
+
+   // Group names always start with a letter
+   if (target.name.length() > 0 && isalpha((unsigned char)target.name[0]))
+   {
+      if ((group = config->groups.find(target.name)) == config->groups.end())
+      {
+         LOGGER_DEBUG("[TCP] " + command_name + ", unknown group " + target.name + "!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, "unknown_group");
+         return false;
+      }
+
+      target.channels = group->second.data();
+      target.count = group->second.size();
+      return true;
+   }
+
+   // Convert channel number string to int
+   try
+   {
+      target.channel = std::stoi(target.name);
+
+      // Check that channel value is acceptable
+      if (target.channel < 0 || target.channel > 511)
+      {
+         LOGGER_DEBUG("[TCP] " + command_name + ", channel number out of range!", LOG_WARN);
+         // Send error message to client
+         send_error(client_fd, "channel_out_of_range");
+         return false;
+      }
+   }
+   catch (const std::exception &e)
+   {
+      LOGGER_DEBUG("[TCP] " + command_name + ", bad channel!", LOG_WARN);
+      // Send error message to client
+      send_error(client_fd, "bad_channel");
+      return false;
+   }
+
+   // Respond with the channel number as the client would send it
+   target.name = std::to_string(target.channel);
+   target.channels = &target.channel;
+   target.count = 1;
+   return true;
+}
+
+void TCPServer::start_on_fade(const CommandTarget &target, bool has_brightness, bool has_transition, double brightness, int transition)
+{
+   LightCommand commands[512];
+
+   // If transition was not provided, use default transition
+   if (!has_transition)
+      transition = default_transition;
+
+   for (int i = 0; i < target.count; i++)
+   {
+      int channel = target.channels[i];
+
+      // If brightness was not provided in the message, turn on to previous known brightness
+      commands[i].brightness = has_brightness ? brightness : light_states->outward_brightness_fine[channel] / 257.0;
+
+      // Set outward facing states. These are only ever written
+      // by the TCP thread, so they don't need the light states lock
+      light_states->outward_state[channel] = true;
+      set_outward_brightness(*light_states, channel, commands[i].brightness);
+      mark_channel_changed(channel);
+
+      commands[i].type = LIGHT_COMMAND_ON;
+      commands[i].transition = transition;
+      commands[i].received_time = message_received_time;
+   }
+
+   // Queue fades, the LightRenderer will start them on the next frame
+   command_queue->push_batch(target.count, target.channels, commands);
+}
+
+void TCPServer::start_off_fade(const CommandTarget &target, bool has_transition, int transition)
+{
+   LightCommand commands[512];
+
+   // If transition was not provided, use default transition
+   if (!has_transition)
+      transition = default_transition;
+
+   for (int i = 0; i < target.count; i++)
+   {
+      // Set outward facing states
+      light_states->outward_state[target.channels[i]] = false;
+      mark_channel_changed(target.channels[i]);
+
+      commands[i].type = LIGHT_COMMAND_OFF;
+      commands[i].brightness = 0;
+      commands[i].transition = transition;
+      commands[i].received_time = message_received_time;
+   }
+
+   // Queue fades, the LightRenderer will start them on the next frame
+   command_queue->push_batch(target.count, target.channels, commands);
+}
+
+/*
+ * Starts a fade on the layer of a named source. Outward states are
+ * those of the main source and aren't changed
+ * Parameters:
+ *  - int source: id of the source
+ *  - const CommandTarget &target: channels to fade
+ *  - int type: LIGHT_COMMAND_ON or LIGHT_COMMAND_OFF
+ *  - bool has_brightness: brightness was given in the message
+ *  - bool has_transition: transition was given in the message
+ *  - double brightness: brightness between 0 and 255
+ *  - int transition: transition in ms
+ */
+void TCPServer::start_source_fade(int source, const CommandTarget &target, int type, bool has_brightness, bool has_transition, double brightness, int transition)
+{
+   LightCommand commands[512];
+
+   // If transition was not provided, use default transition
+   if (!has_transition)
+      transition = default_transition;
+
+   for (int i = 0; i < target.count; i++)
+   {
+      // If brightness was not provided in the message, turn on to the last brightness of the source
+      if (type == LIGHT_COMMAND_ON)
+         commands[i].brightness = has_brightness ? brightness : sources->get_brightness(source, target.channels[i]);
+      else
+         commands[i].brightness = 0;
+
+      commands[i].type = type;
+      commands[i].transition = transition;
+      commands[i].received_time = message_received_time;
+   }
+
+   sources->push_fades(source, target.count, target.channels, commands);
+}
+
+void TCPServer::start_pushbutton_fade(const CommandTarget &target, bool has_direction, bool is_direction_up)
+{
+   // Acquire lock on light states
+   light_states_lock->lock();
+
+   // Channels of a group all move in the direction of the first one
+   if (!has_direction)
+      is_direction_up = get_pushbutton_fade_direction(target.channels[0], false, false);
+
+   for (int i = 0; i < target.count; i++)
+   {
+      int channel = target.channels[i];
+
+      if (!light_states->pushbutton_fade[channel])
+      {
+         // Set transition variables
+         light_states->pushbutton_fade[channel] = true;
+         light_states->pushbutton_fade_up[channel] = is_direction_up;
+         light_states->pushbutton_fade_current[channel] = light_states->fade_current[channel];
+         light_states->pushbutton_fade_pause_counter[channel] = 0;
+         LOGGER_DEBUG("[LIGHT] Starting pushbuton fade, channel: " + std::to_string(channel) + ", direction: " + (light_states->pushbutton_fade_up[channel] ? "up" : "down"), LOG_INFO);
+      }
+      else
+
+         LOGGER_DEBUG("[LIGHT] Pushbutton fade already started: channel: " + std::to_string(channel) + ", direction: " + (light_states->pushbutton_fade_up[channel] ? "up" : "down"), LOG_INFO);
+   }
+
+   // Free lock
+   light_states_lock->unlock();
+}
+
+bool TCPServer::get_pushbutton_fade_direction(int channel, bool has_direction, bool is_direction_up)
+{
+   // If the message contained a direction, use that
+   if (has_direction)
+      return is_direction_up;
+
+   // Check if last fade was before or after reset delay
+   int seconds_since_last_fade = std::chrono::duration_cast<std::chrono::seconds>(
+                                     std::chrono::steady_clock::now() - light_states->pushbutton_fade_end_time[channel])
+                                     .count();
+   if (seconds_since_last_fade < direction_reset_delay)
+      // Invert last direction
+      return !light_states->pushbutton_fade_up[channel];
+   else
+   // Choose direction based on current brightness
+   {
+      return light_states->fade_current[channel] < 128;
+   }
+
+   return true;
+}
+
+void TCPServer::end_pushbutton_fade(const CommandTarget &target)
+{
+   // Acquire lock on light states
+   light_states_lock->lock();
+
+   for (int i = 0; i < target.count; i++)
+   {
+      int channel = target.channels[i];
+
+      // Set transition variables
+      light_states->pushbutton_fade[channel] = false;
+      light_states->pushbutton_fade_end_time[channel] = std::chrono::steady_clock::now(); // Store last time fade was ended
+      light_states->fade_current[channel] = light_states->pushbutton_fade_current[channel];
+
+      // Change outward states
+      set_outward_brightness(*light_states, channel, light_states->fade_current[channel]);
+      light_states->outward_state[channel] = true;
+
+      LOGGER_DEBUG("[LIGHT] Ending pushbuton fade, channel: " + std::to_string(channel) + ", end brightness: " + std::to_string(light_states->fade_current[channel]), LOG_INFO);
+
+      // Notify persistency writer of change
+      mark_channel_changed(channel);
+   }
+
+   // Free lock
+   light_states_lock->unlock();
+}
+
+/*
+ * Fades all channels to the states of a scene. The commands are queued
+ * at once, so the LightRenderer starts all fades in the same frame
+ * Parameters:
+ *  - const Scene &scene: scene to recall
+ *  - bool has_transition: transition was given in the message
+ *  - int transition: transition in ms
+ * Returns: number of fades started
+ */
+int TCPServer::recall_scene(const Scene &scene, bool has_transition, int transition)
+{
+   int channels[512];
+   LightCommand commands[512];
+   int count = 0;
+   bool was_on;
+
+   // If transition was not provided, use default transition
+   if (!has_transition)
+      transition = default_transition;
+
+   for (int i = 0; i < 512; i++)
+   {
+      // Channel is already at, or fading to, the scene state
+      if (light_states->outward_state[i] == scene.state[i] && light_states->outward_brightness[i] == scene.brightness[i])
+         continue;
+
+      was_on = light_states->outward_state[i];
+
+      // Set outward facing states. Channels turned off keep the
+      // brightness of the scene for the next on command
+      light_states->outward_state[i] = scene.state[i];
+      set_outward_brightness(*light_states, i, scene.brightness[i]);
+      mark_channel_changed(i);
+
+      // Channel stays off, only its brightness changed
+      if (!scene.state[i] && !was_on)
+         continue;
+
+      channels[count] = i;
+      commands[count].type = scene.state[i] ? LIGHT_COMMAND_ON : LIGHT_COMMAND_OFF;
+      commands[count].brightness = scene.state[i] ? scene.brightness[i] : 0;
+      commands[count].transition = transition;
+      commands[count].received_time = message_received_time;
+      count++;
+   }
 
-   logger("[LIGHT] Ending pushbuton fade, channel: " + std::to_string(channel) + ", end brightness: " + std::to_string(light_states->fade_current[channel]), LOG_INFO, true);
+   command_queue->push_batch(count, channels, commands);
 
-   // Notify persistency writer of change
-   persistency_writer_cv->notify_all();
+   return count;
 }
@@ -21,25 +21,61 @@
 #include <sstream>
 #include <mutex>
 #include <condition_variable>
+#include <map>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <atomic>
 
 // Network libraries
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/uio.h>
 
 #include "lightstates.h"
+#include "commandqueue.h"
+#include "latencystats.h"
+#include "metrics.h"
+#include "persistency.h"
+#include "statesnapshot.h"
+#include "configwatcher.h"
+#include "eventloop.h"
+#include "scenestore.h"
+#include "effects.h"
+#include "sourcemerger.h"
+#include "mastercontrols.h"
+#include "colorfixtures.h"
+#include "cuesequencer.h"
 #include "logger.h"
 
 #define DEFAULT_PORT 3141
 #define MAX_CLIENTS 5
 #define MAX_CONNECT_QUEUE 5
 #define CLIENT_WELCOME_MESSAGE "Lumize DMX Engine v2.0\n"
+#define CLIENT_OUTPUT_HIGH_WATER_MARK 16384 // Max bytes queued for a client before it's disconnected
+#define MAX_WRITEV_CHUNKS 64                // Max responses coalesced in a single writev()
+#define CLIENT_INPUT_MAX_LENGTH 1024        // Max length of a message still waiting for its newline
+#define CLIENT_INPUT_IDLE_TIMEOUT 20        // ms a client must be idle for a message without newline to be handled
+
+// Commands counted in the metrics
+#define TCP_COMMANDS "conncheck", "sreq", "on", "off", "pfstart", "pfend", "lstat", "scene_save", "scene_recall", "scene_delete", "fxstart", "fxstop", "source", "release", "source_delete", "gm", "sm", "blackout", "freeze", "mreq", "color", "cue_load", "cue_add", "cue_delete", "cue_go", "cue_pause", "cue_stop", "cue_seek", "cue_req"
+
+// Channels a command applies to, either a single channel or a group
+struct CommandTarget
+{
+   int channel;         // Single channel, when the command doesn't target a group
+   const int *channels; // Channels of the group, or &channel
+   int count;
+   std::string name;    // Channel number or group name as given in the message
+};
 
 /*
  * Definition of the TcpServer class
  */
-class TCPServer
+class TCPServer : public EventHandler
 {
 public:
    // Constructor
@@ -51,7 +87,23 @@ public:
    void set_light_states(LightStates &light_states, std::timed_mutex &light_states_lock);
    void send_state_update();
    void configure(int port, int fps, int default_transition, int direction_reset_delay);
-   void set_persistency_writer_cv(std::condition_variable &persistency_writer_cv);
+   void set_persistency_writer(PersistencyWriter &persistency_writer);
+   void set_state_snapshot(StateSnapshot &state_snapshot);
+   void set_command_queue(CommandQueue &command_queue);
+   void set_scene_store(SceneStore &scene_store);
+   void set_effects_engine(EffectsEngine &effects);
+   void set_source_merger(SourceMerger &sources);
+   void set_master_controls(MasterControls &masters);
+   void set_color_fixtures(ColorFixtures &fixtures);
+   void set_cue_sequencer(CueSequencer &sequencer);
+   void set_latency_stats(LatencyStats &latency_stats);
+   void set_metrics(MetricsRegistry &metrics);
+   void set_config_watcher(ConfigWatcher &config_watcher);
+   void wake();
+   void set_event_loop(EventLoop &event_loop);
+   void handle_event(int fd, uint32_t events);
+   int detach(int *fds);
+   void adopt_sockets(const int *fds, int fd_count);
 
 private:
    int master_socket,
@@ -66,42 +118,151 @@ private:
    struct sockaddr_in address;
    std::string client_welcome_message = CLIENT_WELCOME_MESSAGE;
    bool running = true;
-   char buffer[255];
+   bool adopted = false; // Sockets were taken over from another process
+   int wake_pipe[2] = {-1, -1}; // Used to wake up select() when stopping or when the config changes
+   std::atomic<int> wake_fd{-1};  // Write end of wake_pipe, read by wake() from other threads
+   char buffer[256];
 
-   // Socket description set
-   fd_set readfds;
+   // Socket description sets
+   fd_set readfds, writefds;
+
+   // Per-client incomplete message received after the last newline
+   std::string client_input_buffer[MAX_CLIENTS];
+   bool client_input_discarding[MAX_CLIENTS] = {}; // Skipping the rest of a message that was too long
+   bool client_input_framed[MAX_CLIENTS] = {};     // Client ends its messages with a newline
+   std::chrono::steady_clock::time_point client_input_time[MAX_CLIENTS]; // When the incomplete message was last read
+
+   // Per-client output buffers, flushed when the socket is writable
+   std::deque<std::string> client_output_queue[MAX_CLIENTS];
+   size_t client_output_size[MAX_CLIENTS];   // Bytes waiting to be sent
+   size_t client_output_offset[MAX_CLIENTS]; // Bytes of the first queued response already sent
 
    std::thread tcp_thread;
+   EventLoop *event_loop = NULL;                    // Sockets are handled on the event loop instead of tcp_thread
+   bool client_output_watched[MAX_CLIENTS] = {}; // Client registered for writability on the event loop
+   int input_timer = -1;                            // Wakes up the event loop when a message without newline is due
 
    LightStates *light_states;
    std::timed_mutex *light_states_lock;
 
-   // PersistencyWriter condition variable
-   std::condition_variable *persistency_writer_cv;
+   // Fade commands for the LightRenderer
+   CommandQueue *command_queue;
+   std::chrono::steady_clock::time_point message_received_time; // When the messages being parsed were read
+
+   // Saved scenes
+   SceneStore *scene_store;
+
+   // Effects rendered by the LightRenderer
+   EffectsEngine *effects;
+
+   // Named sources, merged by the LightRenderer
+   SourceMerger *sources;
+   int client_source[MAX_CLIENTS]; // Source commands of each client go to, -1 for the main source
+
+   // Masters applied by the LightRenderer
+   MasterControls *masters;
+
+   // Color fixtures faded by the LightRenderer
+   ColorFixtures *fixtures;
+
+   // Cue lists played by the LightRenderer
+   CueSequencer *sequencer;
+   std::vector<FiredCue> fired_cues; // Fade events taken from the sequencer, keeps its capacity
+
+   // Command latency statistics
+   LatencyStats *latency_stats;
+
+   // Metrics
+   std::map<std::string, Counter *> command_counters;
+   Counter *parse_errors_counter;
+   Gauge *connected_clients_gauge;
+
+   // PersistencyWriter to notify of changed channels
+   PersistencyWriter *persistency_writer;
+
+   // Outward states published for background readers
+   StateSnapshot *state_snapshot;
+   bool channel_changed[512]; // Outward state changed since last publish
+   bool states_changed = false;
 
    // Config
    int port, fps, default_transition, direction_reset_delay;
+   ConfigWatcher *config_watcher;
+   std::shared_ptr<const LumizeConfig> config; // Config in use, groups are looked up here
+   unsigned long config_generation = 0;        // Generation of the config in use
 
    std::vector<std::string> split_string(std::string input, char seperator);
 
    // Internal functions
    void init_client_sockets_array();
+   int open_master_socket(int port);
+   void apply_config_changes();
    void main_loop();
+   void start_main_loop();
+   void stop_main_loop();
+   void watch_client_outputs();
    void add_client_sockets_to_set();
    void accept_connection();
    bool send_string(int socketfd, std::string message);
+   void send_error(int client_fd, std::string error);
+   int get_client_index(int socketfd);
+   void flush_client_output(int i);
+   void mark_channel_changed(int channel);
+   void apply_fired_cues();
+   void publish_state_changes();
+   void flush_all_client_outputs();
+   void disconnect_client(int i);
+   bool set_socket_non_blocking(int socketfd);
    bool add_client_to_client_sockets(int socketfd);
    void handle_action_from_client(int socketfd, int i);
+   void parse_client_messages(std::vector<std::string> &messages, int socketfd);
+   void parse_idle_client_inputs();
+   int get_client_input_timeout();
    void parse_message(std::string message, int client_fd);
    void connection_check_message(int client_fd);
    void status_request_message(std::vector<std::string> split_message, int client_fd);
+   void latency_stats_request_message(int client_fd);
    void turn_off_message(std::vector<std::string> split_message, int client_fd);
    void turn_on_message(std::vector<std::string> split_message, int client_fd);
    void pushbutton_fade_end_message(std::vector<std::string> split_message, int client_fd);
    void pushbutton_fade_start_message(std::vector<std::string> split_message, int client_fd);
-   void start_on_fade(int channel, bool has_brightness, bool has_transition, int brightness, int transition);
-   void start_off_fade(int channel, bool has_transition, int transition);
-   void start_pushbutton_fade(int channel, bool has_direction, bool is_direction_up);
-   void end_pushbutton_fade(int channel);
+   void scene_save_message(std::vector<std::string> split_message, int client_fd);
+   void scene_recall_message(std::vector<std::string> split_message, int client_fd);
+   void scene_delete_message(std::vector<std::string> split_message, int client_fd);
+   bool parse_scene_name(std::vector<std::string> split_message, int client_fd, std::string command_name, std::string &name);
+   void effect_start_message(std::vector<std::string> split_message, int client_fd);
+   void effect_stop_message(std::vector<std::string> split_message, int client_fd);
+   bool parse_effect_id(std::vector<std::string> split_message, int client_fd, std::string command_name, int &id);
+   bool parse_effect_parameters(std::vector<std::string> split_message, int client_fd, std::string command_name, EffectParameters &parameters);
+   void source_message(std::vector<std::string> split_message, int client_fd);
+   void release_message(std::vector<std::string> split_message, int client_fd);
+   void source_delete_message(std::vector<std::string> split_message, int client_fd);
+   int get_client_source(int client_fd);
+   void set_client_source(int client_fd, int source);
+   void grand_master_message(std::vector<std::string> split_message, int client_fd);
+   void submaster_message(std::vector<std::string> split_message, int client_fd);
+   void blackout_message(std::vector<std::string> split_message, int client_fd);
+   void freeze_message(std::vector<std::string> split_message, int client_fd);
+   void master_status_request_message(int client_fd);
+   void color_message(std::vector<std::string> split_message, int client_fd);
+   void cue_load_message(std::vector<std::string> split_message, int client_fd);
+   void cue_add_message(std::vector<std::string> split_message, int client_fd);
+   void cue_delete_message(std::vector<std::string> split_message, int client_fd);
+   void cue_go_message(std::vector<std::string> split_message, int client_fd);
+   void cue_pause_message(std::vector<std::string> split_message, int client_fd);
+   void cue_stop_message(std::vector<std::string> split_message, int client_fd);
+   void cue_seek_message(std::vector<std::string> split_message, int client_fd);
+   void cue_status_request_message(std::vector<std::string> split_message, int client_fd);
+   bool parse_cue_list_name(std::vector<std::string> split_message, int client_fd, std::string command_name, std::string &name);
+   bool parse_cue_event(std::vector<std::string> split_message, int client_fd, int previous_time, CueEvent &event);
+   bool parse_master_parameters(std::vector<std::string> split_message, long unsigned int first, int client_fd, std::string command_name, bool &has_level, int &level, int &transition);
+   bool parse_toggle(std::vector<std::string> split_message, int client_fd, std::string command_name, bool &value);
+   bool parse_target(std::vector<std::string> split_message, int client_fd, std::string command_name, CommandTarget &target);
+   void start_on_fade(const CommandTarget &target, bool has_brightness, bool has_transition, double brightness, int transition);
+   void start_off_fade(const CommandTarget &target, bool has_transition, int transition);
+   void start_source_fade(int source, const CommandTarget &target, int type, bool has_brightness, bool has_transition, double brightness, int transition);
+   void start_pushbutton_fade(const CommandTarget &target, bool has_direction, bool is_direction_up);
+   void end_pushbutton_fade(const CommandTarget &target);
    bool get_pushbutton_fade_direction(int channel, bool has_direction, bool is_direction_up);
+   int recall_scene(const Scene &scene, bool has_transition, int transition);
 };